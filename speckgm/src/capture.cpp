@@ -0,0 +1,395 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     capture.cpp
+** License:  GNU
+**
+** The capture thread runs at the highest priority and never waits for
+** the other threads: the raw samples go to a lock-free ring emptied by
+** the disk writer thread, the spectrum columns go to another lock-free
+** ring read by the GUI timer. A full disk ring is an overrun (the ring
+** holds DISK_RING_TIME seconds so it means the disk is far too slow),
+** a full column ring only drops the column from the view, the samples
+** are written to disk anyway.
+******************************************************************************/
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+    #pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#ifndef __WXMSW__
+	#include <poll.h>
+#endif
+#include "fft.h"
+#include "samplewindow.h"
+#include "capture.h"
+
+const unsigned CAPTURE_BLOCK  = 256;   // samples per read
+const unsigned DISK_RING_TIME = 30;    // seconds of samples the disk may lag
+const unsigned COLUMN_RING    = 256;   // spectrum columns the view may lag
+const unsigned WRITE_CHUNK    = 64*1024;
+const unsigned ALSA_LATENCY   = 100000; // us
+
+AudioInput::AudioInput(): m_stdin(false), m_xruns(0)
+{
+#ifdef HAVE_ALSA
+	m_pcm = NULL;
+#endif
+}
+
+AudioInput::~AudioInput()
+{
+	Close();
+}
+
+bool AudioInput::Open(const wxString& device, unsigned rate)
+{
+	Close();
+	m_xruns = 0;
+
+	if (device == _T("-")) {
+		m_file.Attach(wxFile::fd_stdin);
+		m_stdin = true;
+		return true;
+	}
+
+	if (wxFileExists(device))
+		return m_file.Open(device);
+
+#ifdef HAVE_ALSA
+	if (snd_pcm_open(&m_pcm, device.mb_str(), SND_PCM_STREAM_CAPTURE, 0) < 0) {
+		m_pcm = NULL;
+		return false;
+	}
+	if (snd_pcm_set_params(m_pcm, SND_PCM_FORMAT_S16, SND_PCM_ACCESS_RW_INTERLEAVED,
+		1, rate, 1, ALSA_LATENCY) < 0)
+	{
+		Close();
+		return false;
+	}
+	return true;
+#else
+	(void)rate;
+	return false;
+#endif
+}
+
+void AudioInput::Close()
+{
+#ifdef HAVE_ALSA
+	if (m_pcm) {
+		snd_pcm_close(m_pcm);
+		m_pcm = NULL;
+	}
+#endif
+	if (m_stdin) {
+		m_file.Detach();
+		m_stdin = false;
+	}
+	if (m_file.IsOpened()) m_file.Close();
+}
+
+// waits up to ms for the data, so that the capture can be stopped
+bool AudioInput::Wait(unsigned ms)
+{
+#ifdef HAVE_ALSA
+	if (m_pcm) return snd_pcm_wait(m_pcm, ms) != 0;
+#endif
+#ifndef __WXMSW__
+	struct pollfd fds;
+	fds.fd = m_file.fd();
+	fds.events = POLLIN;
+	fds.revents = 0;
+	return poll(&fds, 1, ms) != 0;
+#else
+	(void)ms;
+	return true;
+#endif
+}
+
+// returns the number of samples read, may be less than count,
+// 0 at the end of the input, negative on error
+int AudioInput::Read(short buf[], unsigned count)
+{
+#ifdef HAVE_ALSA
+	if (m_pcm) {
+		snd_pcm_sframes_t n = snd_pcm_readi(m_pcm, buf, count);
+		if (n == -EPIPE || n == -ESTRPIPE) {
+			++m_xruns;
+			n = snd_pcm_recover(m_pcm, int(n), 1);
+			if (n == 0) n = snd_pcm_readi(m_pcm, buf, count);
+		}
+		return int(n);
+	}
+#endif
+	const ssize_t n = m_file.Read(buf, count*sizeof(short));
+	return (n < 0)? -1: int(n/sizeof(short));
+}
+
+// bytes of any sample format from a file or the standard input,
+// returns the number of bytes read, 0 at the end, negative on error
+int AudioInput::ReadRaw(void* buf, unsigned size)
+{
+#ifdef HAVE_ALSA
+	if (m_pcm) return -1;
+#endif
+	const ssize_t n = m_file.Read(buf, size);
+	return (n < 0)? -1: int(n);
+}
+
+void* CaptureTask::Entry()
+{
+	if (m_writer)
+		m_capture.WriteToDisk();
+	else
+		m_capture.Capture();
+
+	return NULL;
+}
+
+LiveCapture::LiveCapture(): m_rate(0), m_length(0),
+	m_rex(NULL), m_imx(NULL), m_scratch(NULL), m_column(NULL), m_colsize(0),
+	m_capture_task(NULL), m_writer_task(NULL), m_hop(0), m_run(false),
+	m_writing(false), m_capturing(false), m_write_failed(false),
+	m_dropped(0), m_overruns(0)
+{
+}
+
+LiveCapture::~LiveCapture()
+{
+	Stop();
+}
+
+/*
+** device - AudioInput device name;
+** rate   - sample rate for the devices;
+** length - FFT size, window - FFT window type;
+** frame  - window length in the middle of the FFT size, 0 - the whole;
+** hop    - samples between the spectrum columns, up to length;
+** path   - raw 16 bit file for the captured samples.
+*/
+bool LiveCapture::Start(const wxString& device, unsigned rate, unsigned length,
+	unsigned frame, unsigned hop, int window, const wxString& path)
+{
+	Stop();
+
+	if (!m_input.Open(device, rate)) return false;
+
+	if (!m_file.Create(path, true)) {
+		m_input.Close();
+		return false;
+	}
+
+	m_rate   = rate;
+	m_length = length;
+	m_hop    = hop;
+
+	m_rex    = new dsp_sample[m_length+2];
+	m_imx    = new dsp_sample[m_length+2];
+	m_window.Init(window, m_length, frame, 0.0);
+	m_scratch = new dsp_sample[m_window.GetScratch() + 1];
+
+	// position, hop, length/2 dB and up to length samples
+	m_colsize = sizeof(wxFileOffset) + sizeof(unsigned) + (m_length/2 + m_length)*sizeof(float);
+	m_column  = new char[m_colsize];
+
+	m_disk.Init(DISK_RING_TIME*m_rate*sizeof(short));
+	m_columns.Init(COLUMN_RING*m_colsize);
+
+	m_dropped  = 0;
+	m_overruns = 0;
+	m_write_failed = false;
+	m_run = m_writing = m_capturing = true;
+
+	m_writer_task  = new CaptureTask(*this, true);
+	m_capture_task = new CaptureTask(*this, false);
+
+	if (m_writer_task->Create() != wxTHREAD_NO_ERROR ||
+		m_writer_task->Run() != wxTHREAD_NO_ERROR)
+	{
+		delete m_writer_task;
+		m_writer_task = NULL;
+		Stop();
+		return false;
+	}
+
+	if (m_capture_task->Create() != wxTHREAD_NO_ERROR) {
+		delete m_capture_task;
+		m_capture_task = NULL;
+		Stop();
+		return false;
+	}
+	m_capture_task->SetPriority(WXTHREAD_MAX_PRIORITY);
+
+	if (m_capture_task->Run() != wxTHREAD_NO_ERROR) {
+		delete m_capture_task;
+		m_capture_task = NULL;
+		Stop();
+		return false;
+	}
+
+	return true;
+}
+
+// stops the capture, the samples captured so far are written to disk
+void LiveCapture::Stop()
+{
+	m_run = false;
+	if (m_capture_task) {
+		m_capture_task->Wait();
+		delete m_capture_task;
+		m_capture_task = NULL;
+	}
+	m_capturing = false;
+
+	m_writing = false;
+	if (m_writer_task) {
+		m_writer_task->Wait();
+		delete m_writer_task;
+		m_writer_task = NULL;
+	}
+
+	m_input.Close();
+	if (m_file.IsOpened()) m_file.Close();
+
+	delete[] m_rex;    m_rex = NULL;
+	delete[] m_imx;    m_imx = NULL;
+	delete[] m_scratch; m_scratch = NULL;
+	delete[] m_column; m_column = NULL;
+
+	m_disk.Reset();
+	m_columns.Reset();
+}
+
+/*
+** The view side: the next column if any. pos - the frame center in the
+** captured samples, hop - the number of samples[], up to FFT size.
+*/
+bool LiveCapture::GetColumn(wxFileOffset& pos, unsigned& hop, float samples[], float dB[])
+{
+	// a column is put at once, so its header means the whole column
+	if (!m_columns.Get(&pos, sizeof(pos))) return false;
+
+	m_columns.Get(&hop, sizeof(hop));
+	m_columns.Get(dB, (m_length/2)*sizeof(float));
+	m_columns.Get(samples, hop*sizeof(float));
+
+	return true;
+}
+
+void LiveCapture::Capture()
+{
+	const unsigned block = std::max(m_length, CAPTURE_BLOCK);
+
+	short *raw = new short[block];
+	float *samples = new float[block];
+
+	SampleWindow window;
+	window.Init(m_length);
+
+	// the capture starts after a frame of silence
+	std::fill(samples, samples + m_length, 0.0f);
+	window.Load(-int(m_length), samples);
+
+	unsigned since = 0; // samples since the last column
+
+	while (m_run)
+	{
+		if (!m_input.Wait(100)) continue;
+
+		unsigned hop = m_hop;
+		if (hop == 0 || hop > m_length) hop = m_length;
+
+		// the end of the input or an error
+		const int n = m_input.Read(raw, std::max(hop, CAPTURE_BLOCK));
+		if (n <= 0) break;
+
+		if (!m_disk.Put(raw, n*sizeof(short))) ++m_overruns;
+
+		for (int i = 0; i < n; i++)
+			samples[i] = float(raw[i])/32767.0f;
+
+		for (unsigned i = 0; i < unsigned(n); )
+		{
+			if (since >= hop) since = 0; // the hop was decreased
+
+			const unsigned k = std::min(hop - since, unsigned(n) - i);
+
+			window.Push(samples + i, k);
+			since += k;
+			i += k;
+
+			if (since == hop) {
+				PutColumn(window.GetPos() + m_length/2, window.GetData(), hop);
+				since = 0;
+			}
+		}
+	}
+
+	delete[] raw;
+	delete[] samples;
+
+	m_capturing = false;
+}
+
+// FFT of the frame, in the same scale as the file view
+void LiveCapture::PutColumn(wxFileOffset pos, const float frame[], unsigned hop)
+{
+	const unsigned header = sizeof(wxFileOffset) + sizeof(unsigned);
+	const unsigned size = header + (m_length/2 + hop)*sizeof(float);
+
+	if (m_columns.GetFree() < size) {
+		++m_dropped;
+		return;
+	}
+
+	const float k = m_window.GetScale();
+	float *dB = (float*)(m_column + header);
+
+	memcpy(m_column, &pos, sizeof(pos));
+	memcpy(m_column + sizeof(pos), &hop, sizeof(hop));
+
+	// the magnitudes first, converted in place
+	m_window.Spectrum(dB, frame, m_rex, m_imx, m_scratch);
+
+	for (unsigned i = 0; i < m_length/2; i++) {
+		const float v = 20.0f*(float)log10(dB[i]*k);
+		dB[i] = (v < -100.0f)? -100.0f: v;
+	}
+
+	// the samples in the middle of the frame, as the view draws them
+	memcpy(dB + m_length/2, frame + m_length/2 - hop/2, hop*sizeof(float));
+
+	m_columns.Put(m_column, size);
+}
+
+void LiveCapture::WriteToDisk()
+{
+	char *buf = new char[WRITE_CHUNK];
+
+	for (;;)
+	{
+		const unsigned n = m_disk.Read(buf, WRITE_CHUNK);
+
+		if (n) {
+			if (!m_write_failed && m_file.Write(buf, n) != n)
+				m_write_failed = true;
+		}
+		else if (!m_writing) {
+			break;
+		}
+		else {
+			wxThread::Sleep(10);
+		}
+	}
+
+	delete[] buf;
+}
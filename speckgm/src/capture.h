@@ -0,0 +1,118 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     capture.h
+** License:  GNU
+**
+** Live capture: the audio input, the real-time thread doing the FFT of
+** the captured samples and the thread writing them to disk.
+******************************************************************************/
+#ifndef _CAPTURE_H
+#define _CAPTURE_H
+
+#include <wx/thread.h>
+#include <wx/file.h>
+#include "fft.h"
+#include "ringbuffer.h"
+#include "wincache.h"
+
+#ifdef HAVE_ALSA
+	#include <alsa/asoundlib.h>
+#endif
+
+/*
+** 16 bit mono input: "-" is the standard input, an existing file or FIFO
+** is read as raw samples, other names are ALSA devices ("default" goes
+** through PulseAudio where it is installed).
+*/
+class AudioInput
+{
+public:
+	AudioInput();
+	~AudioInput();
+
+	bool Open(const wxString& device, unsigned rate);
+	void Close();
+
+	bool Wait(unsigned ms);
+	int  Read(short buf[], unsigned count);
+	int  ReadRaw(void* buf, unsigned size);
+
+	unsigned GetXruns() const { return m_xruns; }
+
+private:
+	wxFile   m_file;
+	bool     m_stdin;
+#ifdef HAVE_ALSA
+	snd_pcm_t *m_pcm;
+#endif
+	unsigned m_xruns; // device overruns, samples were lost
+};
+
+class LiveCapture;
+
+class CaptureTask: public wxThread
+{
+public:
+	CaptureTask(LiveCapture& capture, bool writer):
+		wxThread(wxTHREAD_JOINABLE), m_capture(capture), m_writer(writer) {}
+
+protected:
+	virtual void* Entry();
+
+private:
+	LiveCapture& m_capture;
+	bool         m_writer; // the disk writer, otherwise the capture
+};
+
+class LiveCapture
+{
+	friend class CaptureTask;
+
+public:
+	LiveCapture();
+	~LiveCapture();
+
+	bool Start(const wxString& device, unsigned rate, unsigned length,
+		unsigned frame, unsigned hop, int window, const wxString& path);
+	void Stop();
+
+	bool IsRunning() const { return m_capturing; }
+	void SetHop(unsigned hop) { m_hop = hop; }
+
+	bool GetColumn(wxFileOffset& pos, unsigned& hop, float samples[], float dB[]);
+
+	unsigned GetDropped() const  { return m_dropped; }
+	unsigned GetOverruns() const { return m_overruns + m_input.GetXruns(); }
+	bool IsWriteFailed() const   { return m_write_failed; }
+
+private:
+	void Capture();
+	void WriteToDisk();
+	void PutColumn(wxFileOffset pos, const float frame[], unsigned hop);
+
+	AudioInput  m_input;
+	wxFile      m_file;    // captured samples
+	RingBuffer  m_disk;    // raw samples to m_file
+	RingBuffer  m_columns; // position, hop, dB and samples to the view
+	unsigned    m_rate;
+	unsigned    m_length;  // FFT size
+	FftWindow   m_window;  // FFT window coefs
+	dsp_sample  *m_rex;    // FFT buffers
+	dsp_sample  *m_imx;
+	dsp_sample  *m_scratch; // of the FFT plan of m_window
+	char        *m_column; // one m_columns element
+	unsigned    m_colsize; // its size
+	CaptureTask *m_capture_task;
+	CaptureTask *m_writer_task;
+
+	volatile unsigned m_hop;
+	volatile bool m_run;       // capture
+	volatile bool m_writing;   // writer
+	volatile bool m_capturing; // the capture thread is running
+	volatile bool m_write_failed;
+	volatile unsigned m_dropped;  // columns not shown
+	volatile unsigned m_overruns; // blocks not written
+};
+
+#endif/*_CAPTURE_H*/
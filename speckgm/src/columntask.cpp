@@ -0,0 +1,187 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     columntask.cpp
+** License:  GNU
+**
+** The caller posts a job - the columns of a scroll or of the whole view,
+** or the frames of a jump to be cached - and goes on with its own engine.
+** The thread reads the columns in order and posts m_ready after every one,
+** so the caller takes a column as soon as it is ready and the two engines
+** run on two cores. A job is always finished before the next one: the
+** columns left are skipped, but still posted.
+******************************************************************************/
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+    #pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <string.h>
+#include <algorithm>
+#include "columntask.h"
+
+ColumnTask::ColumnTask(AnalysisEngine& engine): wxThread(wxTHREAD_JOINABLE),
+	m_engine(engine), m_start(0,1), m_ready(0), m_job(JOB_NONE), m_first(0),
+	m_step(0), m_count(0), m_size(0), m_bins(0), m_got(0), m_posts(0),
+	m_cancel(false), m_run(false)
+{
+}
+
+bool ColumnTask::Start()
+{
+	m_run = true;
+
+	if (wxThread::Create() != wxTHREAD_NO_ERROR) {
+		m_run = false;
+		return false;
+	}
+
+	if (wxThread::Run() != wxTHREAD_NO_ERROR) {
+		m_run = false;
+		return false;
+	}
+
+	return true;
+}
+
+void ColumnTask::Stop()
+{
+	if (!m_run) return;
+
+	Finish();
+
+	m_run = false;
+	m_start.Post();
+	wxThread::Wait();
+}
+
+// the frames first, first+hop, ... of count into the frame cache
+void ColumnTask::Cache(wxFileOffset first, unsigned hop, unsigned count)
+{
+	Post(JOB_CACHE, first, long(hop), count, hop);
+}
+
+/*
+** The columns first, first+step, ... of count, size samples each, as
+** AnalysisEngine::ReadColumn() reads them; the pyramid columns of all of
+** them are prepared at once.
+*/
+void ColumnTask::Read(wxFileOffset first, long step, unsigned count, unsigned size)
+{
+	Post(JOB_READ, first, step, count, size);
+}
+
+/*
+** The next column of the read job into dB[], waits until it is read.
+** Returns the ReadColumn() result, a negative value - no column, dB[] is
+** the spectrum of silence then.
+*/
+int ColumnTask::Get(float dB[])
+{
+	if (m_job != JOB_READ || m_got >= m_posts) {
+		std::fill(dB, dB + m_engine.GetLength()/2, -100.0f);
+		return -1;
+	}
+
+	m_ready.Wait();
+	const unsigned i = m_got++;
+
+	if (m_res[i] < 0)
+		std::fill(dB, dB + m_bins, -100.0f);
+	else
+		memcpy(dB, &m_dB[i*m_bins], m_bins*sizeof(float));
+
+	return m_res[i];
+}
+
+// wait for the job, the columns not taken yet are not read
+void ColumnTask::Finish()
+{
+	m_cancel = true;
+
+	while (m_got < m_posts) {
+		m_ready.Wait();
+		m_got++;
+	}
+
+	m_job = JOB_NONE;
+}
+
+void ColumnTask::Post(int job, wxFileOffset first, long step, unsigned count, unsigned size)
+{
+	Finish();
+
+	m_job    = job;
+	m_first  = first;
+	m_step   = step;
+	m_count  = count;
+	m_size   = size;
+	m_bins   = m_engine.GetLength()/2;
+	m_got    = 0;
+	m_posts  = (job == JOB_READ)? count: 1;
+	m_cancel = false;
+
+	if (job == JOB_READ) {
+		m_dB.resize(size_t(count)*m_bins);
+		m_res.resize(count);
+	}
+
+	if (m_run) {
+		m_start.Post();
+		return;
+	}
+
+	// no thread, the job is done before the caller goes on
+	if (job == JOB_CACHE) DoCache(); else DoRead();
+}
+
+void* ColumnTask::Entry()
+{
+	while (m_run)
+	{
+		// a job or Stop(), nothing to poll meanwhile
+		if (m_start.Wait() != wxSEMA_NO_ERROR)
+			break;
+
+		if (m_job == JOB_CACHE)
+			DoCache();
+		else if (m_job == JOB_READ)
+			DoRead();
+	}
+
+	return NULL;
+}
+
+void ColumnTask::DoCache()
+{
+	m_engine.CacheFrames(m_first, m_size, m_count);
+	m_ready.Post();
+}
+
+void ColumnTask::DoRead()
+{
+	if (m_engine.IsPooled(m_size) && m_count) {
+		const wxFileOffset last = m_first + wxFileOffset(m_count - 1)*m_step;
+		const unsigned half = m_size/2;
+
+		m_engine.Prepare(std::min(m_first, last) - half, std::max(m_first, last) + half);
+	}
+
+	float min[2], max[2];
+
+	for (unsigned i = 0; i < m_count; i++)
+	{
+		if (m_cancel)
+			m_res[i] = -1;
+		else
+			m_res[i] = m_engine.ReadColumn(m_first + wxFileOffset(i)*m_step, m_size,
+				&m_dB[i*m_bins], min, max);
+
+		m_ready.Post();
+	}
+}
@@ -0,0 +1,57 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     columntask.h
+** License:  GNU
+**
+** The view columns of a second analysis engine, read by a thread of their
+** own while the caller reads the same columns of its engine.
+******************************************************************************/
+#ifndef _COLUMNTASK_H
+#define _COLUMNTASK_H
+
+#include <wx/thread.h>
+#include <vector>
+#include "engine.h"
+
+class ColumnTask: public wxThread
+{
+public:
+	ColumnTask(AnalysisEngine& engine);
+
+	bool Start();
+	void Stop();
+
+	void Cache(wxFileOffset first, unsigned hop, unsigned count);
+	void Read(wxFileOffset first, long step, unsigned count, unsigned size);
+	int  Get(float dB[]);
+	void Finish();
+
+protected:
+	virtual void* Entry();
+
+private:
+	enum { JOB_NONE, JOB_CACHE, JOB_READ };
+
+	void Post(int job, wxFileOffset first, long step, unsigned count, unsigned size);
+	void DoCache();
+	void DoRead();
+
+	AnalysisEngine& m_engine;
+	wxSemaphore  m_start;  // posted on a new job or to stop
+	wxSemaphore  m_ready;  // posted on every column read, once per cache job
+	int          m_job;    // JOB_NONE...JOB_READ
+	wxFileOffset m_first;  // first column or frame position, samples
+	long         m_step;   // columns step, negative - backward
+	unsigned     m_count;  // columns or frames of the job
+	unsigned     m_size;   // read-step of the columns
+	unsigned     m_bins;   // values per column
+	unsigned     m_got;    // columns taken by Get()
+	unsigned     m_posts;  // m_ready posts of the job
+	volatile bool m_cancel; // the columns left are not read
+	bool         m_run;
+	std::vector<float> m_dB; // m_count columns
+	std::vector<int>   m_res;
+};
+
+#endif/*_COLUMNTASK_H*/
@@ -0,0 +1,215 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     decimator.cpp
+** License:  GNU
+**
+** The low-pass is a Kaiser-windowed sinc, its transition band is
+** DECIM_TRANSITION of the output rate and ends at the output Nyquist
+** frequency, where the stopband starts DECIM_ATTEN dB down. Only the kept outputs are
+** computed, every one a dot product over a contiguous run of the input,
+** which is the saving of the polyphase form without its reordering. The
+** filter is centered: the output n is at the input n*factor.
+**
+** The last m_taps-1 input samples are kept after every Read(), so a read
+** that continues the previous one, e.g. the frames of a forward scroll,
+** only converts and filters its new samples.
+******************************************************************************/
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+    #pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "fft.h"
+#include "decimator.h"
+
+#define PI 3.1415926535897932384626433832795
+
+const double DECIM_ATTEN = 80.0;      // stopband attenuation, dB
+const double DECIM_TRANSITION = 0.1;  // transition band, of the output rate
+const double DECIM_BETA = 7.857;      // Kaiser beta for DECIM_ATTEN
+
+Decimator::Decimator(): m_factor(1), m_taps(1), m_coefs(NULL), m_next(-1)
+{
+}
+
+Decimator::~Decimator()
+{
+	delete[] m_coefs;
+}
+
+// factor 1 - no filtering, the callers read the input directly
+bool Decimator::Init(unsigned factor)
+{
+	delete[] m_coefs;
+	m_coefs  = NULL;
+	m_factor = factor? factor: 1;
+	m_taps   = 1;
+	m_next   = -1;
+	m_buf.clear();
+
+	if (m_factor == 1) return true;
+
+	// the cutoff is half the band below the output Nyquist frequency, the
+	// stopband starts there and nothing aliases into the spectrum
+	const double fc = (0.5 - DECIM_TRANSITION/2)/m_factor;
+
+	// the Kaiser estimate of the length for the attenuation and the band
+	const double width = DECIM_TRANSITION/m_factor;
+	const unsigned half = unsigned(ceil((DECIM_ATTEN - 7.95)/(2.285*2.0*PI*width)/2.0));
+
+	m_taps  = 2*half + 1;
+	m_coefs = new float[m_taps];
+
+	dsp_window(m_coefs, m_taps, KAISER, DECIM_BETA);
+
+	double sum = 0.0;
+
+	for (unsigned i = 0; i < m_taps; i++)
+	{
+		const double x = double(i) - half;
+		const double h = (i == half)? 2.0*fc: sin(2.0*PI*fc*x)/(PI*x);
+
+		m_coefs[i] = float(h*m_coefs[i]);
+		sum += m_coefs[i];
+	}
+
+	// unity gain at DC
+	for (unsigned i = 0; i < m_taps; i++)
+		m_coefs[i] = float(m_coefs[i]/sum);
+
+	return true;
+}
+
+/*
+** count outputs from pos into dst[], the input is read by input(ctx, ...).
+** The buffer holds the input from pos*factor - half - (factor-1): the
+** history of m_taps-1 samples, then count*factor new ones; the output k
+** is filtered from m_buf[k*factor + factor-1]. Returns false on error.
+*/
+bool Decimator::Read(wxFileOffset pos, float dst[], unsigned count, InputFunc input, void *ctx)
+{
+	if (!count) return true;
+
+	const unsigned hist = m_taps - 1;
+	const unsigned size = count*m_factor;
+	const wxFileOffset first = pos*m_factor - hist/2 - (m_factor - 1);
+
+	if (m_buf.size() < hist + size) m_buf.resize(hist + size);
+
+	// not the continuation of the last read, a new history
+	if (pos != m_next && input(ctx, first, &m_buf[0], hist) < 0) {
+		m_next = -1;
+		return false;
+	}
+
+	if (input(ctx, first + hist, &m_buf[hist], size) < 0) {
+		m_next = -1;
+		return false;
+	}
+
+	Filter(count, dst);
+
+	// the last input is the history of the next outputs
+	memmove(&m_buf[0], &m_buf[size], hist*sizeof(float));
+	m_next = pos + count;
+
+	return true;
+}
+
+void Decimator::Filter(unsigned count, float dst[]) const
+{
+	const float *c = m_coefs;
+
+	for (unsigned k = 0; k < count; k++)
+	{
+		const float *x = &m_buf[k*m_factor + m_factor - 1];
+		float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+		unsigned j = 0;
+
+		// independent sums, the loop is not bound by the adder latency
+		for (; j + 4 <= m_taps; j += 4) {
+			s0 += c[j]*x[j];
+			s1 += c[j+1]*x[j+1];
+			s2 += c[j+2]*x[j+2];
+			s3 += c[j+3]*x[j+3];
+		}
+		for (; j < m_taps; j++) s0 += c[j]*x[j];
+
+		dst[k] = (s0 + s1) + (s2 + s3);
+	}
+}
+
+/*
+** The samples of a raw audio file at the rate reduced by factor, for the
+** tasks that read with their own file handles.
+*/
+SampleReader::SampleReader(ConvertFunc convert, unsigned bps, unsigned factor):
+	m_convert(convert), m_bps(bps)
+{
+	m_decim.Init(factor);
+}
+
+bool SampleReader::Open(const wxString& path)
+{
+	return m_file.Open(path);
+}
+
+// the file length at the reduced rate
+wxFileOffset SampleReader::GetCount() const
+{
+	return m_file.Length()/m_bps/m_decim.GetFactor();
+}
+
+/*
+** count samples from pos into dst[], zeros before the file beginning and
+** after its end. Returns the number of samples from the file, counted
+** from max(pos, 0), or a negative value on error.
+*/
+int SampleReader::Read(wxFileOffset pos, float dst[], unsigned count)
+{
+	if (m_decim.GetFactor() == 1) return ReadInput(pos, dst, count);
+
+	if (!m_decim.Read(pos, dst, count, Input, this)) return -1;
+
+	const wxFileOffset from = std::max(pos, wxFileOffset(0));
+	const wxFileOffset to = std::min(pos + count, GetCount());
+
+	return (to > from)? int(to - from): 0;
+}
+
+int SampleReader::Input(void *ctx, wxFileOffset pos, float dst[], unsigned count)
+{
+	return ((SampleReader*)ctx)->ReadInput(pos, dst, count);
+}
+
+// count samples of the file at its own rate, as Read()
+int SampleReader::ReadInput(wxFileOffset pos, float dst[], unsigned count)
+{
+	const wxFileOffset from = std::max(pos, wxFileOffset(0));
+	const wxFileOffset to = std::min(pos + count, wxFileOffset(m_file.Length()/m_bps));
+
+	std::fill(dst, dst + count, 0.0f);
+
+	if (to <= from) return 0;
+
+	m_raw.resize(size_t(to - from)*m_bps);
+
+	if (m_file.Seek(from*m_bps, wxFromStart) == wxInvalidOffset)
+		return -1;
+
+	const ssize_t res = m_file.Read(&m_raw[0], m_raw.size());
+	if (res < 0) return -1;
+
+	m_convert(dst + (from - pos), &m_raw[0], unsigned(res));
+
+	return int(res/m_bps);
+}
@@ -0,0 +1,65 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     decimator.h
+** License:  GNU
+**
+** Low-pass filtering and decimation of the converted samples by an integer
+** factor, so a file of a high sample rate is analysed at a lower one.
+** Positions are counted in the samples at the reduced rate.
+******************************************************************************/
+#ifndef _DECIMATOR_H
+#define _DECIMATOR_H
+
+#include <vector>
+#include "welch.h"
+
+// count input samples from pos into dst[], zeros outside the input;
+// returns a negative value on error
+typedef int (*InputFunc)(void *ctx, wxFileOffset pos, float dst[], unsigned count);
+
+class Decimator
+{
+public:
+	Decimator();
+	~Decimator();
+
+	bool Init(unsigned factor);
+	void Reset() { m_next = -1; }
+
+	unsigned GetFactor() const { return m_factor; }
+	unsigned GetTaps() const { return m_taps; }
+
+	bool Read(wxFileOffset pos, float dst[], unsigned count, InputFunc input, void *ctx);
+
+private:
+	void Filter(unsigned count, float dst[]) const;
+
+	unsigned m_factor; // input samples per output sample
+	unsigned m_taps;   // low-pass length, odd
+	float    *m_coefs; // the low-pass, symmetric
+	std::vector<float> m_buf; // m_taps-1 history samples + new input
+	wxFileOffset m_next; // output the history leads to, -1 - none
+};
+
+class SampleReader
+{
+public:
+	SampleReader(ConvertFunc convert, unsigned bps, unsigned factor);
+
+	bool Open(const wxString& path);
+	wxFileOffset GetCount() const;
+	int  Read(wxFileOffset pos, float dst[], unsigned count);
+
+private:
+	static int Input(void *ctx, wxFileOffset pos, float dst[], unsigned count);
+	int ReadInput(wxFileOffset pos, float dst[], unsigned count);
+
+	wxFile       m_file;
+	ConvertFunc  m_convert;
+	unsigned     m_bps;     // bytes per sample
+	Decimator    m_decim;
+	std::vector<unsigned char> m_raw;
+};
+
+#endif/*_DECIMATOR_H*/
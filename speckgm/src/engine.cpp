@@ -0,0 +1,784 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     engine.cpp
+** License:  GNU
+**
+** Every public call holds the engine lock for its whole duration, so the
+** frame caches, the sample window and the FFT buffers are never seen half
+** updated. Only the results leave the engine: the frames are copied to
+** the caller's arrays, not handed out as pointers into the caches.
+******************************************************************************/
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+    #pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "fft.h"
+#include "frametask.h"
+#include "engine.h"
+
+const unsigned FRAME_CACHE_SIZE = 1024; // frames kept in FrameCache
+const unsigned BLOCK_CACHE_SIZE = 256;  // 64kB blocks kept in BlockCache
+const unsigned SDFT_RESYNC = 4096;      // samples slid by SlidingDft between FFTs
+
+AnalysisEngine::AnalysisEngine(): m_convert(NULL),
+	m_buffer(NULL), m_block(NULL), m_fbuffer(NULL),
+	m_samples(NULL), m_fbuffer1(NULL), m_fftre(NULL), m_fftim(NULL), m_fftscr(NULL),
+	m_fdB(NULL),
+	m_use_sdft(true), m_fwin(NULL), m_fwintype(RECTANGULAR), m_fwinparam(0.0),
+	m_fwintapers(1), m_reassigned(false), m_prefetch(m_blocks), m_speech_task(NULL),
+	m_format(Signed16bit), m_BiPS(0), m_ByPS(0), m_order(0), m_length(0), m_frame(0)
+{
+}
+
+AnalysisEngine::~AnalysisEngine()
+{
+	Close();
+	m_prefetch.Stop();
+
+	delete[] m_buffer;
+	delete[] m_block;
+	delete[] m_fbuffer;
+	delete[] m_fbuffer1;
+	delete[] m_fftre;
+	delete[] m_fftim;
+	delete[] m_fftscr;
+	delete[] m_fdB;
+}
+
+/*
+** FFT size length (even, any), the window covers frame samples in the
+** middle of it and the rest is zero-padded; frame 0 - the whole length.
+** Called before anything else, again to change the sizes: the spectra
+** analysed so far are dropped, the input stays opened.
+*/
+bool AnalysisEngine::Init(unsigned length, unsigned frame)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	const bool first = (m_block == NULL);
+
+	if (!frame || frame > length) frame = length;
+
+	m_length = length;
+	m_frame  = frame;
+	for (m_order = 0; (1u << m_order) < m_length; m_order++);
+
+	delete[] m_buffer;
+	delete[] m_fbuffer;
+	delete[] m_fbuffer1;
+	delete[] m_fftre;
+	delete[] m_fftim;
+	delete[] m_fftscr;
+	delete[] m_fdB;
+
+	m_buffer   = new unsigned char[m_length * sizeof(float)];
+	m_fbuffer  = new float[m_length];
+	m_fbuffer1 = new float[m_length+2];
+	m_fftre    = new dsp_sample[m_length+2];
+	m_fftim    = new dsp_sample[m_length+2];
+	m_fdB      = new float[m_length/2];
+
+	m_fwin = m_wincache.Get(m_fwintype, m_length, m_frame, m_fwinparam, m_fwintapers,
+		m_reassigned);
+	if (!m_fwin) return false;
+
+	// the windows of a size share the plan, so the scratch fits them all
+	m_fftscr = new dsp_sample[m_fwin->GetScratch() + 1];
+
+	for (unsigned i = 0; i < m_length; i++) m_fbuffer[i] = 0.0f;
+	m_samples = m_fbuffer;
+
+	if (!m_window.Init(m_length) || !m_sdft.Init(m_length, SDFT_RESYNC) ||
+		!m_frames.Init(FRAME_CACHE_SIZE, m_length))
+		return false;
+
+	if (m_file.IsOpened()) {
+		m_pyramid.Open(m_path, m_convert, m_ByPS, m_decim.GetFactor(), m_fwin);
+		m_blocks.Reset();
+	}
+	m_decim.Reset();
+
+	if (!first) return true;
+
+	m_block = new unsigned char[BlockCache::BLOCK_SIZE];
+	SetFormat(Signed16bit);
+
+	return m_blocks.Init(BLOCK_CACHE_SIZE) && m_prefetch.Start();
+}
+
+/*
+** Open a raw audio file, format - Unsigned8bit...Float32bit. The standard
+** input ("-") and named pipes are read as they come by StreamSource, the
+** last history bytes of them are kept. factor > 1 - the input is low-pass
+** filtered and decimated by it before the analysis, for the files of a
+** higher sample rate than the analysed band needs.
+*/
+bool AnalysisEngine::Open(const wxString& path, int format, unsigned history, unsigned factor)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	Drop();
+	SetFormat(format);
+	m_decim.Init(factor);
+
+	if (StreamSource::IsStream(path)) {
+		if (!m_stream.Open(path, history))
+			return false;
+
+		m_path = path;
+		return true;
+	}
+
+	if (!m_file.Open(path))
+		return false;
+
+	m_prefetch.Open(path);
+	m_pyramid.Open(path, m_convert, m_ByPS, m_decim.GetFactor(), m_fwin);
+	m_path = path;
+
+	return true;
+}
+
+void AnalysisEngine::Close()
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	Drop();
+}
+
+// close the input and forget all it was analysed, the lock is held
+void AnalysisEngine::Drop()
+{
+	if (m_file.IsOpened()) m_file.Close();
+	m_stream.Close();
+	m_prefetch.Close();
+	m_pyramid.Close();
+	StopIndex();
+	m_speech.Save();
+	m_speech.Close();
+	m_window.Reset();
+	m_sdft.Reset();
+	m_frames.Reset();
+	m_blocks.Reset();
+	m_decim.Reset();
+}
+
+// the input is rewritten, nothing cached is valid
+void AnalysisEngine::Reset()
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	m_window.Reset();
+	m_sdft.Reset();
+	m_frames.Reset();
+	m_blocks.Reset();
+	m_pyramid.Reset();
+	StopIndex();
+	m_speech.Close();
+	m_decim.Reset();
+}
+
+// the input has grown, the data from the old end in samples was padded
+// with zeros when analysed
+void AnalysisEngine::Truncate(wxFileOffset end)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	const unsigned factor = m_decim.GetFactor();
+
+	m_blocks.Truncate(end*factor*m_ByPS);
+	m_decim.Reset();
+
+	// the filter reached the input after the end
+	if (factor > 1) end -= (m_decim.GetTaps()/2 + factor - 1)/factor;
+
+	m_frames.Truncate(end);
+	m_pyramid.Truncate(end);
+	if (m_window.IsValid() && m_window.GetPos() + m_length > end) {
+		m_window.Reset();
+		m_sdft.Reset();
+	}
+	m_window.SetEnd(-1);
+}
+
+// input length in samples, at the reduced rate
+wxFileOffset AnalysisEngine::GetCount()
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	return InputCount()/m_decim.GetFactor();
+}
+
+// input length in its own samples, the lock is held
+wxFileOffset AnalysisEngine::InputCount()
+{
+	if (m_stream.IsOpened()) return m_stream.Length()/m_ByPS;
+	if (m_file.IsOpened()) return m_file.Length()/m_ByPS;
+	return 0;
+}
+
+// the oldest sample kept of the stream input, 0 for a file
+wxFileOffset AnalysisEngine::GetFirst()
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	if (!m_stream.IsOpened()) return 0;
+
+	const wxFileOffset factor = m_decim.GetFactor();
+	return (m_stream.GetFirst()/m_ByPS + factor - 1)/factor;
+}
+
+/*
+** FFT window RECTANGULAR...DPSS, param - Kaiser beta, Gaussian sigma or
+** DPSS NW, 0 - the default. tapers > 1 - the multitaper spectra of the
+** DPSS tapers of the orders 0..tapers-1, the frames are read once and
+** only the FFT is repeated per taper. The tables are computed once per
+** type and size, switching back and forth only drops the cached spectra.
+*/
+void AnalysisEngine::SetWindow(int type, double param, unsigned tapers)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	const FftWindow *window = m_wincache.Get(type, m_length, m_frame, param, tapers, m_reassigned);
+	if (!window) return;
+
+	m_fwintype   = window->GetType();
+	m_fwinparam  = param;
+	m_fwintapers = tapers;
+	UseWindow(window);
+}
+
+/*
+** The reassigned spectra: the power of every bin moved to its instantaneous
+** frequency within the frame, the harmonics get sharp at small FFT sizes.
+** Single window only, the multitaper one comes back when switched off.
+*/
+void AnalysisEngine::SetReassigned(bool use)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	const FftWindow *window = m_wincache.Get(m_fwintype, m_length, m_frame, m_fwinparam,
+		m_fwintapers, use);
+	if (!window) return;
+
+	m_reassigned = use;
+	UseWindow(window);
+}
+
+// the cached spectra were made with the old window
+void AnalysisEngine::UseWindow(const FftWindow *window)
+{
+	m_fwin = window;
+
+	m_frames.Reset();
+	if (m_pyramid.IsOpened())
+		m_pyramid.Open(m_path, m_convert, m_ByPS, m_decim.GetFactor(), m_fwin);
+}
+
+/*
+** The frame of m_length samples from pos: its samples into samples[]
+** (may be NULL) and m_length/2 dB values into dB[]. Returns the bytes of
+** the file data in the frame, 0 if the input is not opened or a negative
+** value on error.
+*/
+int AnalysisEngine::ReadFrame(wxFileOffset pos, float samples[], float dB[])
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	const int res = Analyse(pos);
+	if (res < 0) return res;
+
+	if (samples) memcpy(samples, m_samples, m_length*sizeof(float));
+	memcpy(dB, m_fdB, (m_length/2)*sizeof(float));
+
+	return res;
+}
+
+/*
+** The view column of step samples centered at pos: its spectrum into dB[]
+** and the extrema of its halves into min[]/max[]. It is the frame at pos
+** or, zoomed out beyond the frame size, the max-pooled pyramid columns of
+** the step. Returns the bytes of the file data in it as ReadFrame().
+*/
+int AnalysisEngine::ReadColumn(wxFileOffset pos, unsigned step,
+	float dB[], float min[2], float max[2])
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	const unsigned half = step/2;
+
+	if (IsPooled(step)) {
+		const wxFileOffset nsamples = InputCount()/m_decim.GetFactor();
+		const wxFileOffset from = std::max(pos - half, wxFileOffset(0));
+		const wxFileOffset to   = std::min(pos + half, nsamples);
+
+		m_pyramid.GetSpectrum(pos - half, pos + half, dB);
+		m_pyramid.GetAmplitude(pos - half, pos, min[0], max[0]);
+		m_pyramid.GetAmplitude(pos, pos + half, min[1], max[1]);
+
+		return (to > from)? int(to - from)*m_ByPS: 0;
+	}
+
+	const int res = Analyse(pos - m_length/2);
+	if (res < 0) return res;
+
+	memcpy(dB, m_fdB, (m_length/2)*sizeof(float));
+
+	// the middle step of the frame, the whole frame at most
+	const unsigned pixel = std::min(half, m_frame/2);
+	const float *buf = m_samples + m_length/2 - pixel;
+
+	for (int i = 0; i < 2; i++, buf += pixel) {
+		min[i] = *std::min_element(buf, buf + pixel);
+		max[i] = *std::max_element(buf, buf + pixel);
+	}
+
+	return res;
+}
+
+// the pyramid columns of the samples from..to at once
+bool AnalysisEngine::Prepare(wxFileOffset from, wxFileOffset to)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	if (!m_pyramid.IsOpened()) return true;
+
+	return m_pyramid.Prepare(from, to, InputCount()/m_decim.GetFactor());
+}
+
+/*
+** Compute the frames first, first+hop, ... of count that are not in the
+** frame cache yet by several threads, the following reads take them from
+** the cache then. Only the last frames the cache can hold are computed.
+** The stream input is only read sequentially, its frames are left to
+** ReadFrame().
+*/
+void AnalysisEngine::CacheFrames(wxFileOffset first, unsigned hop, unsigned count)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	if (!m_file.IsOpened()) return;
+
+	if (count > FRAME_CACHE_SIZE) {
+		first += wxFileOffset(count - FRAME_CACHE_SIZE)*hop;
+		count = FRAME_CACHE_SIZE;
+	}
+
+	// the run of the missing frames
+	unsigned from = 0, to = count;
+	while (from < to && m_frames.Find(first + wxFileOffset(from)*hop)) from++;
+	while (to > from && m_frames.Find(first + wxFileOffset(to-1)*hop)) to--;
+
+	if (to - from < 2) return;
+
+	const unsigned n = to - from;
+	const wxFileOffset pos = first + wxFileOffset(from)*hop;
+
+	float *samples = new float[n*m_length];
+	float *dB = new float[n*(m_length/2)];
+	int *res = new int[n];
+
+	if (ComputeFrames(m_path, m_convert, m_ByPS, m_decim.GetFactor(), *m_fwin,
+		hop, pos, n, samples, dB, res)) {
+		for (unsigned i = 0; i < n; i++)
+			m_frames.Store(pos + wxFileOffset(i)*hop, res[i],
+				samples + i*m_length, dB + i*(m_length/2));
+	}
+
+	delete[] samples;
+	delete[] dB;
+	delete[] res;
+}
+
+// Welch PSD of the samples from..to of the file, returns the frames averaged
+unsigned AnalysisEngine::Welch(wxFileOffset from, wxFileOffset to, float psd[])
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	if (!m_file.IsOpened()) return 0;
+
+	return WelchPsd(m_path, m_convert, m_ByPS, m_decim.GetFactor(), *m_fwin, from, to, psd);
+}
+
+// the next frames will be read from the sample pos, ahead - bytes to read
+// ahead, negative when moving backward
+void AnalysisEngine::Hint(wxFileOffset pos, long ahead)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	if (pos < 0) pos = 0;
+
+	const unsigned factor = m_decim.GetFactor();
+
+	m_prefetch.Hint(pos*factor*m_ByPS, ahead*factor);
+}
+
+/*
+** Index the speech segments of the file by blocks of block samples: the
+** first call starts SpeechTask, which takes the sidecar or reads the whole
+** file once, the next ones only index the data appended since. The
+** sidecar is written when the index is built and when the file is closed.
+** Not for the stream input. The index is kept at the rate of the file.
+*/
+bool AnalysisEngine::IndexSpeech(unsigned block)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	if (!m_file.IsOpened()) return false;
+
+	// the first pass goes on, FinishIndex() takes it
+	if (m_speech_task) return true;
+
+	if (m_speech.IsOpened()) return m_speech.Update();
+
+	m_speech_task = new SpeechTask(m_path, m_convert, m_ByPS, m_format,
+		block*m_decim.GetFactor());
+
+	if (!m_speech_task->Start()) {
+		delete m_speech_task;
+		m_speech_task = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+/*
+** Take the index of the first pass if it is done, wait - until it is.
+** Returns true if the index was taken now, its segments are known from
+** then on.
+*/
+bool AnalysisEngine::FinishIndex(bool wait)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	if (!m_speech_task || (!wait && !m_speech_task->IsDone()))
+		return false;
+
+	m_speech_task->Wait();
+	m_speech = m_speech_task->GetIndex();
+
+	delete m_speech_task;
+	m_speech_task = NULL;
+
+	return true;
+}
+
+// cancel the first pass, the lock is held
+void AnalysisEngine::StopIndex()
+{
+	if (!m_speech_task) return;
+
+	m_speech_task->Cancel();
+	m_speech_task->Wait();
+
+	delete m_speech_task;
+	m_speech_task = NULL;
+}
+
+// the start of the next speech segment after the sample pos, -1 if none
+wxFileOffset AnalysisEngine::NextSpeech(wxFileOffset pos)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	const unsigned factor = m_decim.GetFactor();
+	const wxFileOffset next = m_speech.Next(pos*factor);
+
+	return (next < 0)? next: next/factor;
+}
+
+// the start of the speech segment before the sample pos, -1 if none
+wxFileOffset AnalysisEngine::PrevSpeech(wxFileOffset pos)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	const unsigned factor = m_decim.GetFactor();
+	const wxFileOffset prev = m_speech.Prev(pos*factor);
+
+	return (prev < 0)? prev: prev/factor;
+}
+
+// some speech in the samples from..to-1, false if the file is not indexed
+bool AnalysisEngine::IsSpeech(wxFileOffset from, wxFileOffset to)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	const unsigned factor = m_decim.GetFactor();
+
+	return m_speech.IsSpeech(from*factor, to*factor);
+}
+
+void AnalysisEngine::FFT()
+{
+	m_fwin->Spectrum(m_fbuffer1, m_samples, m_fftre, m_fftim, m_fftscr);
+
+	ConvertToDb();
+}
+
+// magnitudes in m_fbuffer1[] to m_fdB[], a sine reads its amplitude
+// whatever the window
+void AnalysisEngine::ConvertToDb()
+{
+	const unsigned length2 = m_length/2;
+	const float    k = m_fwin->GetScale();
+
+	for(unsigned i = 0; i < length2; i++) {// something is wrong in the calculations...
+		float dB = 20.0f * (float)log10(m_fbuffer1[i] * k);
+		m_fdB[i] = (dB < -100.0f)? -100.0f: dB;
+	}
+}
+
+// Reading from a file through the block cache, returns the number of bytes
+// read or a negative value on error
+int AnalysisEngine::ReadData(wxFileOffset offset, unsigned char buf[], unsigned size)
+{
+	// the stream history is in memory already
+	if (m_stream.IsOpened()) return m_stream.Read(offset, buf, size);
+
+	int res = m_blocks.Read(offset, buf, size);
+	if (res >= 0) return res;
+
+	// cache miss - read whole blocks so the following frames will hit
+	const wxFileOffset bsize = BlockCache::BLOCK_SIZE;
+	const unsigned generation = m_blocks.GetGeneration();
+
+	for (long index = long(offset/bsize); index <= long((offset+size-1)/bsize); index++)
+	{
+		if (m_blocks.Has(index)) continue;
+
+		if (m_file.Seek(index*bsize, wxFromStart) == wxInvalidOffset)
+			return -1;
+
+		const ssize_t n = m_file.Read(m_block, bsize);
+		if (n < 0)
+			return -1;
+
+		m_blocks.Put(index, m_block, unsigned(n), generation);
+
+		if (n < bsize) break; // end of file
+	}
+
+	res = m_blocks.Read(offset, buf, size);
+
+	// the cache is too small, read directly
+	if (res < 0) {
+		if (m_file.Seek(offset, wxFromStart) == wxInvalidOffset)
+			res = -1;
+		else
+			res = m_file.Read(buf, size);
+	}
+
+	return res;
+}
+
+/*
+** Reading count samples of the input at its own rate from pos into dst[],
+** the samples before the file beginning and after its end are zeros.
+** Returns the number of samples really read or a negative value on error.
+*/
+int AnalysisEngine::ReadInput(wxFileOffset pos, float dst[], unsigned count)
+{
+	unsigned skip = 0;
+
+	/* a little complicated situation when pos is less than zero */
+	if( pos < 0 ) {
+		skip = (-pos < wxFileOffset(count))? unsigned(-pos): count;
+		for(unsigned i = 0; i < skip; i++) dst[i] = 0.0f;
+		if( skip == count ) return 0;
+	}
+
+	// by frames, the decimator reads more than a frame at once
+	unsigned n = 0;
+
+	while( skip+n < count ) {
+		const unsigned size = std::min(count-skip-n, m_length)*m_ByPS;
+		int res = ReadData((pos+skip+n)*m_ByPS, m_buffer, size);
+
+		if( res < 0 ) return res;
+
+		// convert/normalist samples
+		m_convert(dst+skip+n, m_buffer, res);
+		n += res/m_ByPS;
+
+		if( res < int(size) ) break;
+	}
+
+	for(unsigned i = skip+n; i < count; i++) dst[i] = 0.0f;
+
+	return n;
+}
+
+int AnalysisEngine::Input(void *ctx, wxFileOffset pos, float dst[], unsigned count)
+{
+	return ((AnalysisEngine*)ctx)->ReadInput(pos, dst, count);
+}
+
+/*
+** Reading count samples from pos into dst[], decimated if the input is,
+** the samples before the file beginning and after its end are zeros.
+** The decimator keeps its state while the reads follow each other.
+** Returns the number of samples really read or a negative value on error.
+*/
+int AnalysisEngine::ReadSamples(wxFileOffset pos, float dst[], unsigned count)
+{
+	const unsigned factor = m_decim.GetFactor();
+	const wxFileOffset from = std::max(pos, wxFileOffset(0));
+	wxFileOffset end;
+
+	if( factor == 1 ) {
+		const int n = ReadInput(pos, dst, count);
+		if( n < 0 ) return n;
+		end = from + n;
+	}
+	else {
+		if( !m_decim.Read(pos, dst, count, Input, this) ) return -1;
+		end = std::max(std::min(pos + count, InputCount()/factor), from);
+	}
+
+	// short read - the end of file is found
+	if( end < pos + count ) m_window.SetEnd(end);
+
+	return int(end - from);
+}
+
+// Reading from a file + doing FFT into m_samples/m_fdB,
+// returns the bytes of the file data in the frame
+int AnalysisEngine::Analyse(wxFileOffset pos)
+{
+	int res;
+
+	if (!IsOpened()) return 0;
+
+	const FrameCache::Frame *frame = m_frames.Find(pos);
+	if (frame) {
+		m_samples = frame->samples;
+		memcpy(m_fdB, frame->dB, (m_length/2)*sizeof(float));
+		return frame->res;
+	}
+
+	// move the sample window, for the small read-step only
+	// the new samples are read and converted
+	const wxFileOffset delta = pos - m_window.GetPos();
+	const wxFileOffset step = (delta < 0)? -delta: delta;
+
+	// the sliding DFT costs step*N/2 updates against N/2*log2(N)
+	// butterflies of FFT, so it is used for steps less than log2(N);
+	// it knows no zero-padding
+	const bool sliding = m_use_sdft && !m_reassigned && m_frame == m_length &&
+		m_window.IsValid() && step &&
+		step < m_order && SlidingDft::IsSupported(m_fwintype);
+
+	if( sliding && (!m_sdft.IsValid() || m_sdft.GetPos() != m_window.GetPos()) )
+		m_sdft.Load(m_window.GetPos(), m_window.GetData());
+
+	if( m_window.IsValid() && delta > 0 && delta < wxFileOffset(m_length) ) {
+		res = ReadSamples(m_window.GetPos()+m_length, m_fbuffer, unsigned(delta));
+		if( res < 0 ) return res;
+		if( sliding ) m_sdft.Slide(m_window.GetData(), m_fbuffer, int(delta));
+		m_window.Push(m_fbuffer, unsigned(delta));
+	}
+	else if( m_window.IsValid() && delta < 0 && -delta < wxFileOffset(m_length) ) {
+		res = ReadSamples(pos, m_fbuffer, unsigned(-delta));
+		if( res < 0 ) return res;
+		if( sliding ) m_sdft.Slide(m_window.GetData(), m_fbuffer, int(delta));
+		m_window.PushFront(m_fbuffer, unsigned(-delta));
+	}
+	else if( !m_window.IsValid() || delta ) {
+		res = ReadSamples(pos, m_fbuffer, m_length);
+		if( res < 0 ) return res;
+		m_window.Load(pos, m_fbuffer);
+	}
+
+	m_samples = m_window.GetData();
+
+	// bytes of the file data in the frame
+	res = m_window.GetValid()*m_ByPS;
+
+	// FFT - analysis
+	if( sliding ) {
+		m_sdft.Magnitude(m_fbuffer1, m_fwintype);
+		ConvertToDb();
+	}
+	else {
+		FFT();
+	}
+
+	m_frames.Store(pos, res, m_samples, m_fdB);
+
+	return res;
+}
+
+// size - buffer length
+void AnalysisEngine::ConvertU8(float dst[], unsigned char src[], unsigned size)
+{
+	for(unsigned i = 0; i < size; i++)
+		dst[i] = (float)(src[i]-128)/127.0f;
+}
+
+void AnalysisEngine::ConvertS16(float dst[], unsigned char src[], unsigned size)
+{
+	unsigned size2 = size/sizeof(short);
+	short    *src2 = (short*) src;
+
+	for(unsigned i = 0; i < size2; i++)
+		dst[i] = float(src2[i])/32767.0f;
+}
+
+void AnalysisEngine::ConvertS16BE(float dst[], unsigned char src[], unsigned size)
+{
+	unsigned size2 = size/sizeof(short);
+
+	for(unsigned i = 0; i < size2; i++)
+		dst[i] = float((short)((src[i*2] << 8) | src[i*2+1]))/32767.0f;
+}
+
+void AnalysisEngine::ConvertF32(float dst[], unsigned char src[], unsigned size)
+{
+	unsigned size2 = size/sizeof(float);
+	float    *src2 = (float*) src;
+
+	for(unsigned i = 0; i < size2; i++)
+		dst[i] = src2[i];
+}
+
+void AnalysisEngine::SetFormat(int format)
+{
+	m_format = format;
+
+	switch(format)
+	{
+	case Unsigned8bit:
+		m_BiPS = 8; // bits per sample
+		m_ByPS = 1;  // bytes per sample
+		m_convert = ConvertU8;
+		break;
+
+	case Signed16bit:
+		m_BiPS = 16; // bits per sample
+		m_ByPS = 2;  // bytes per sample
+		m_convert = ConvertS16;
+		break;
+
+	case Signed16bitBigEndian:
+		m_BiPS = 16; // bits per sample
+		m_ByPS = 2;  // bytes per sample
+		m_convert = ConvertS16BE;
+		break;
+
+	case Float32bit:
+		m_BiPS = 32; // bits per sample
+		m_ByPS = 4;  // bytes per sample
+		m_convert = ConvertF32;
+		break;
+	}
+}
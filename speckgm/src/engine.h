@@ -0,0 +1,142 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     engine.h
+** License:  GNU
+**
+** The analysis of a raw audio input: samples source -> frames -> spectra
+** -> dB, with its caches. Every instance owns its buffers and may be used
+** from several threads, the results are copied to the caller's arrays.
+** The input may be decimated, all the positions are at the reduced rate.
+******************************************************************************/
+#ifndef _ENGINE_H
+#define _ENGINE_H
+
+#include <wx/thread.h>
+#include <wx/file.h>
+#include "decimator.h"
+#include "fft.h"
+#include "framecache.h"
+#include "prefetch.h"
+#include "pyramid.h"
+#include "samplewindow.h"
+#include "sdft.h"
+#include "streamsource.h"
+#include "vadindex.h"
+#include "welch.h"
+#include "wincache.h"
+
+class AnalysisEngine
+{
+public:
+	enum { Unsigned8bit, Signed16bit, Signed16bitBigEndian, Float32bit };
+
+	AnalysisEngine();
+	~AnalysisEngine();
+
+	bool Init(unsigned length, unsigned frame);
+
+	bool Open(const wxString& path, int format, unsigned history, unsigned factor = 1);
+	void Close();
+	void Reset();
+	void Truncate(wxFileOffset end);
+
+	bool IsOpened() const { return m_file.IsOpened() || m_stream.IsOpened(); }
+	bool IsStream() const { return m_stream.IsOpened(); }
+	bool IsEnded() const { return m_stream.IsEnded(); }
+	const wxString& GetPath() const { return m_path; }
+	unsigned GetOrder() const { return m_order; }
+	unsigned GetLength() const { return m_length; }
+	unsigned GetFrame() const { return m_frame; }
+	unsigned GetBytesPerSample() const { return m_ByPS; }
+	unsigned GetDecimation() const { return m_decim.GetFactor(); }
+	wxFileOffset GetCount();
+	wxFileOffset GetFirst();
+
+	void SetWindow(int type, double param = 0.0, unsigned tapers = 1);
+	int  GetWindow() const { return m_fwintype; }
+	unsigned GetTapers() const { return m_fwintapers; }
+	void SetReassigned(bool use);
+	bool IsReassigned() const { return m_reassigned; }
+	double GetEnbw() const { return m_fwin? m_fwin->GetEnbw(): 1.0; }
+	const float* GetWindowCoefs() const { return m_fwin? m_fwin->GetCoefs(): NULL; }
+	void SetSlidingDft(bool use) { m_use_sdft = use; }
+	bool GetSlidingDft() const { return m_use_sdft; }
+
+	int  ReadFrame(wxFileOffset pos, float samples[], float dB[]);
+	int  ReadColumn(wxFileOffset pos, unsigned step, float dB[], float min[2], float max[2]);
+	bool IsPooled(unsigned step) const { return step > m_frame && m_pyramid.IsOpened(); }
+	bool Prepare(wxFileOffset from, wxFileOffset to);
+	void CacheFrames(wxFileOffset first, unsigned hop, unsigned count);
+	unsigned Welch(wxFileOffset from, wxFileOffset to, float psd[]);
+	void Hint(wxFileOffset pos, long ahead);
+
+	bool IndexSpeech(unsigned block);
+	bool IsIndexing() const { return m_speech_task != NULL; }
+	bool FinishIndex(bool wait = false);
+	bool IsIndexed() const { return m_speech.IsOpened(); }
+	wxFileOffset NextSpeech(wxFileOffset pos);
+	wxFileOffset PrevSpeech(wxFileOffset pos);
+	bool IsSpeech(wxFileOffset from, wxFileOffset to);
+
+	static void ConvertU8(float dst[], unsigned char src[], unsigned size);
+	static void ConvertS16(float dst[], unsigned char src[], unsigned size);
+	static void ConvertS16BE(float dst[], unsigned char src[], unsigned size);
+	static void ConvertF32(float dst[], unsigned char src[], unsigned size);
+
+private:
+	void SetFormat(int format);
+	void Drop();
+	void StopIndex();
+	int  ReadData(wxFileOffset offset, unsigned char buf[], unsigned size);
+	int  ReadInput(wxFileOffset pos, float dst[], unsigned count);
+	int  ReadSamples(wxFileOffset pos, float dst[], unsigned count);
+	wxFileOffset InputCount();
+	static int Input(void *ctx, wxFileOffset pos, float dst[], unsigned count);
+	int  Analyse(wxFileOffset pos);
+	void FFT();
+	void ConvertToDb();
+	void UseWindow(const FftWindow *window);
+
+	wxCriticalSection m_cs; // guards everything below
+	wxFile        m_file;
+	StreamSource  m_stream; // stdin or pipe input, instead of m_file
+	wxString      m_path;
+	ConvertFunc   m_convert;
+
+	unsigned char *m_buffer; // raw samples of a frame
+	unsigned char *m_block;  // BLOCK_SIZE buffer for cache misses
+	float   *m_fbuffer;  // normalized samples, scratch buffer
+	float   *m_samples;  // current frame samples: m_window or cached frame
+	float   *m_fbuffer1; // magnitudes of FFT or SlidingDft
+	dsp_sample *m_fftre; // FFT buffers, of the type chosen at compile time
+	dsp_sample *m_fftim;
+	dsp_sample *m_fftscr; // scratch of the FFT plan
+	float   *m_fdB;      // amplitude/frequency
+
+	SampleWindow m_window; // samples of the last read frame
+	SlidingDft m_sdft;   // spectrum of m_window for tiny read-steps
+	bool     m_use_sdft; // allow SlidingDft
+	WindowCache m_wincache; // FFT windows computed so far
+	const FftWindow *m_fwin; // current FFT window, from m_wincache
+	int      m_fwintype; // FFT window type
+	double   m_fwinparam; // its parameter, 0 - the default
+	unsigned m_fwintapers; // DPSS tapers averaged, 1 - the single window
+	bool     m_reassigned; // the reassigned spectra, single window
+	FrameCache m_frames; // recently analysed frames
+	BlockCache m_blocks; // raw file data
+	Prefetcher m_prefetch;
+	SpectrumPyramid m_pyramid; // columns longer than a frame
+	SpeechIndex m_speech; // speech segments of the file
+	SpeechTask *m_speech_task; // its first pass, NULL - not running
+	Decimator m_decim;   // the input to the analysis rate, streaming
+
+	int      m_format;  // Unsigned8bit...Float32bit
+	unsigned m_BiPS;    // bits per sample
+	unsigned m_ByPS;    // bytes per sample
+	unsigned m_order;   // FFT order, rounded up
+	unsigned m_length;  // FFT size
+	unsigned m_frame;   // window length, the middle of m_length
+};
+
+#endif/*_ENGINE_H*/
@@ -5,6 +5,42 @@
 #define PI  3.1415926535897932384626433832795f
 #define PI2 (PI*2.0f)
 #define PI4 (PI*4.0f)
+#define PI_D 3.14159265358979323846
+
+/*
+    The arithmetic of the kernels per sample type: acc holds the sums of a
+    few samples, mul() is the product by a coefficient and stage() gives
+    the output of a radix-r butterfly. The floating point types are not
+    scaled. The Q15 fixed point (short) is divided by r on every pass, so
+    its forward transforms come out scaled by 1/size and do not overflow.
+*/
+template <class T> struct fft_math
+{
+    typedef T acc;
+    enum { scaled = 0 };
+
+    static T from( double x ) { return (T)x; }
+    static double to( T x ) { return x; }
+    static acc mul( acc a, T b ) { return a*b; }
+    static T stage( acc a, unsigned ) { return a; }
+    static T half( acc a ) { return a*(T)0.5; }
+};
+
+template <> struct fft_math<short>
+{
+    typedef int acc;
+    enum { scaled = 1 };
+
+    static short from( double x ) {
+        const double q = x*32768.0;
+        return (short)((q <= -32768.0)? -32768: (q >= 32767.0)? 32767:
+            (int)((q < 0.0)? q - 0.5: q + 0.5));
+    }
+    static double to( short x ) { return x*(1.0/32768.0); }
+    static acc mul( acc a, short b ) { return (a*b + 0x4000) >> 15; }
+    static short stage( acc a, unsigned r ) { return (short)(a/(int)r); }
+    static short half( acc a ) { return (short)(a >> 1); }
+};
 
 /*
     THE FAST FOURIER TRANSFORM
@@ -15,15 +51,16 @@
     Upon entry, size contains the number of points in the IDFT, rex[] & imx[]
     contain the real & imaginary parts of the complex frequency domain.
     Upon return, rex[] and imx[] contain the complex time domain.
-    All signals run from 0 to size-1.
+    All signals run from 0 to size-1. The radix-2 kernel reads the twiddles
+    exp(-j*2*pi*t/size), t < size/2, from wr[] & wi[] of the plan.
 */
-void dsp_fft( float rex[], float imx[], unsigned size, int forward )
+template <class T>
+static void fft_radix2( T rex[], T imx[], unsigned size, const T wr[], const T wi[] )
 {
-    unsigned nm1, nd2, i, j, k, l, m, le, le2, jm1, ip;
-    float tr, ti, ur, ui, sr ,si;
-
-    /* change the sign of imx[] */
-    if( forward == -1 ) for (i = 0; i < size; i++) imx[i] = -imx[i];
+    typedef fft_math<T> M;
+    typedef typename M::acc acc;
+    unsigned nm1, nd2, i, j, k, l, m, le, le2, jm1, ip, step;
+    T tr, ti;
 
     for( m = 0, i = size; i >>= 1; ++m ); /* log(size)/log(2) */
 
@@ -49,31 +86,491 @@ void dsp_fft( float rex[], float imx[], unsigned size, int forward )
     {
         le = 1 << l;
         le2 = le >> 1;
-        ur = 1.0f;
-        ui = 0.0f;
-        sr = (float)cos(PI/le2); /* Calculate sine & cosine values */
-        si = (float)-sin(PI/le2);
+        step = size >> l; /* exp(-j*pi*jm1/le2) is the twiddle jm1*step */
         for( j = 1; j <= le2; ++j ) /* Loop for each sub DFT */
         {
             jm1 = j-1;
+            const T wr1 = wr[jm1*step], wi1 = wi[jm1*step];
             for( i = jm1; i <= nm1; i += le ) /* Loop for each butterfly */
             {
                 ip = i+le2;
-                tr = rex[ip]*ur - imx[ip]*ui; /* Butterfly calculation */
-                ti = rex[ip]*ui + imx[ip]*ur;
-                rex[ip] = rex[i]-tr;
-                imx[ip] = imx[i]-ti;
-                rex[i]  = rex[i]+tr;
-                imx[i]  = imx[i]+ti;
+                const acc xr = M::mul(rex[ip], wr1) - M::mul(imx[ip], wi1); /* Butterfly calculation */
+                const acc xi = M::mul(rex[ip], wi1) + M::mul(imx[ip], wr1);
+                const acc qr = rex[i], qi = imx[i];
+                rex[ip] = M::stage(qr - xr, 2);
+                imx[ip] = M::stage(qi - xi, 2);
+                rex[i]  = M::stage(qr + xr, 2);
+                imx[i]  = M::stage(qi + xi, 2);
             }
-            tr = ur;
-            ur = tr*sr - ui*si;
-            ui = tr*si + ui*sr;
         }
     }
+}
+
+
+/* size is 2^a * 3^b * 5^c */
+static int fft_smooth( unsigned size )
+{
+    while( size % 2 == 0 ) size /= 2;
+    while( size % 3 == 0 ) size /= 3;
+    while( size % 5 == 0 ) size /= 5;
+    return size == 1;
+}
+
+/* wr[t] + j*wi[t] = exp(-j*2*pi*t/size) for t < count */
+template <class T>
+static void fft_twiddles( T wr[], T wi[], unsigned size, unsigned count )
+{
+    typedef fft_math<T> M;
+    const double a = 2.0*PI_D/size;
+    double ur = 1.0, ui = 0.0, tr;
+    const double sr = cos(a), si = -sin(a);
+    unsigned t;
+
+    for( t = 0; t < count; t++ ) {
+        /* the rounding errors of the rotation are dropped every 32 steps */
+        if( (t & 31) == 0 ) {
+            ur = cos(a*t);
+            ui = -sin(a*t);
+        }
+        wr[t] = M::from(ur);
+        wi[t] = M::from(ui);
+        tr = ur;
+        ur = tr*sr - ui*si;
+        ui = tr*si + ui*sr;
+    }
+}
+
+/*
+    One pass of the mixed-radix FFT: the radix-r butterflies of the inputs
+    x[q + s*(p + j*m)], j < r, go to y[q + s*(r*p + k)] multiplied by
+    exp(-j*2*pi*p*k/(r*m)), wr[],wi[] hold exp(-j*2*pi*t/size) and the
+    rotation p*k/(r*m) is t = p*k*step of them.
+*/
+#define FFT_X(j)     (q + s*(p + (j)*m))
+#define FFT_Y(k)     (q + s*(r*p + (k)))
+#define FFT_TW(k, re, im) { \
+        const T vr = M::stage(re, r), vi = M::stage(im, r); \
+        yr[FFT_Y(k)] = (T)(M::mul(vr, w##k##r) - M::mul(vi, w##k##i)); \
+        yi[FFT_Y(k)] = (T)(M::mul(vr, w##k##i) + M::mul(vi, w##k##r)); }
+
+template <class T>
+static void fft_pass2( const T xr[], const T xi[], T yr[], T yi[],
+    const T wr[], const T wi[], unsigned s, unsigned m, unsigned step )
+{
+    typedef fft_math<T> M;
+    typedef typename M::acc acc;
+    const unsigned r = 2;
+    unsigned p, q;
+
+    for( p = 0; p < m; p++ ) {
+        const T w1r = wr[p*step], w1i = wi[p*step];
+        for( q = 0; q < s; q++ ) {
+            const acc ar = xr[FFT_X(0)], ai = xi[FFT_X(0)];
+            const acc br = xr[FFT_X(1)], bi = xi[FFT_X(1)];
+            yr[FFT_Y(0)] = M::stage(ar + br, r);
+            yi[FFT_Y(0)] = M::stage(ai + bi, r);
+            FFT_TW(1, ar - br, ai - bi)
+        }
+    }
+}
+
+template <class T>
+static void fft_pass3( const T xr[], const T xi[], T yr[], T yi[],
+    const T wr[], const T wi[], unsigned s, unsigned m, unsigned step )
+{
+    typedef fft_math<T> M;
+    typedef typename M::acc acc;
+    const T c3 = M::from(-0.5), s3 = M::from(0.86602540378443864676);
+    const unsigned r = 3;
+    unsigned p, q;
+
+    for( p = 0; p < m; p++ ) {
+        const T w1r = wr[p*step], w1i = wi[p*step];
+        const T w2r = wr[2*p*step], w2i = wi[2*p*step];
+        for( q = 0; q < s; q++ ) {
+            const acc tr = xr[FFT_X(1)] + xr[FFT_X(2)], ti = xi[FFT_X(1)] + xi[FFT_X(2)];
+            const acc dr = xr[FFT_X(1)] - xr[FFT_X(2)], di = xi[FFT_X(1)] - xi[FFT_X(2)];
+            const acc er = xr[FFT_X(0)] + M::mul(tr, c3), ei = xi[FFT_X(0)] + M::mul(ti, c3);
+            yr[FFT_Y(0)] = M::stage(xr[FFT_X(0)] + tr, r);
+            yi[FFT_Y(0)] = M::stage(xi[FFT_X(0)] + ti, r);
+            FFT_TW(1, er + M::mul(di, s3), ei - M::mul(dr, s3))
+            FFT_TW(2, er - M::mul(di, s3), ei + M::mul(dr, s3))
+        }
+    }
+}
+
+template <class T>
+static void fft_pass4( const T xr[], const T xi[], T yr[], T yi[],
+    const T wr[], const T wi[], unsigned s, unsigned m, unsigned step )
+{
+    typedef fft_math<T> M;
+    typedef typename M::acc acc;
+    const unsigned r = 4;
+    unsigned p, q;
+
+    for( p = 0; p < m; p++ ) {
+        const T w1r = wr[p*step], w1i = wi[p*step];
+        const T w2r = wr[2*p*step], w2i = wi[2*p*step];
+        const T w3r = wr[3*p*step], w3i = wi[3*p*step];
+        for( q = 0; q < s; q++ ) {
+            const acc t0r = xr[FFT_X(0)] + xr[FFT_X(2)], t0i = xi[FFT_X(0)] + xi[FFT_X(2)];
+            const acc t1r = xr[FFT_X(0)] - xr[FFT_X(2)], t1i = xi[FFT_X(0)] - xi[FFT_X(2)];
+            const acc t2r = xr[FFT_X(1)] + xr[FFT_X(3)], t2i = xi[FFT_X(1)] + xi[FFT_X(3)];
+            const acc t3r = xr[FFT_X(1)] - xr[FFT_X(3)], t3i = xi[FFT_X(1)] - xi[FFT_X(3)];
+            yr[FFT_Y(0)] = M::stage(t0r + t2r, r);
+            yi[FFT_Y(0)] = M::stage(t0i + t2i, r);
+            FFT_TW(1, t1r + t3i, t1i - t3r)
+            FFT_TW(2, t0r - t2r, t0i - t2i)
+            FFT_TW(3, t1r - t3i, t1i + t3r)
+        }
+    }
+}
+
+template <class T>
+static void fft_pass5( const T xr[], const T xi[], T yr[], T yi[],
+    const T wr[], const T wi[], unsigned s, unsigned m, unsigned step )
+{
+    typedef fft_math<T> M;
+    typedef typename M::acc acc;
+    const T c51 = M::from(0.30901699437494742410), s51 = M::from(0.95105651629515357212);
+    const T c52 = M::from(-0.80901699437494742410), s52 = M::from(0.58778525229247312917);
+    const unsigned r = 5;
+    unsigned p, q;
+
+    for( p = 0; p < m; p++ ) {
+        const T w1r = wr[p*step], w1i = wi[p*step];
+        const T w2r = wr[2*p*step], w2i = wi[2*p*step];
+        const T w3r = wr[3*p*step], w3i = wi[3*p*step];
+        const T w4r = wr[4*p*step], w4i = wi[4*p*step];
+        for( q = 0; q < s; q++ ) {
+            const acc a0r = xr[FFT_X(0)], a0i = xi[FFT_X(0)];
+            const acc t1r = xr[FFT_X(1)] + xr[FFT_X(4)], t1i = xi[FFT_X(1)] + xi[FFT_X(4)];
+            const acc t2r = xr[FFT_X(2)] + xr[FFT_X(3)], t2i = xi[FFT_X(2)] + xi[FFT_X(3)];
+            const acc d1r = xr[FFT_X(1)] - xr[FFT_X(4)], d1i = xi[FFT_X(1)] - xi[FFT_X(4)];
+            const acc d2r = xr[FFT_X(2)] - xr[FFT_X(3)], d2i = xi[FFT_X(2)] - xi[FFT_X(3)];
+            const acc e1r = a0r + M::mul(t1r, c51) + M::mul(t2r, c52);
+            const acc e1i = a0i + M::mul(t1i, c51) + M::mul(t2i, c52);
+            const acc e2r = a0r + M::mul(t1r, c52) + M::mul(t2r, c51);
+            const acc e2i = a0i + M::mul(t1i, c52) + M::mul(t2i, c51);
+            const acc f1r = M::mul(d1r, s51) + M::mul(d2r, s52), f1i = M::mul(d1i, s51) + M::mul(d2i, s52);
+            const acc f2r = M::mul(d1r, s52) - M::mul(d2r, s51), f2i = M::mul(d1i, s52) - M::mul(d2i, s51);
+            yr[FFT_Y(0)] = M::stage(a0r + t1r + t2r, r);
+            yi[FFT_Y(0)] = M::stage(a0i + t1i + t2i, r);
+            FFT_TW(1, e1r + f1i, e1i - f1r)
+            FFT_TW(2, e2r + f2i, e2i - f2r)
+            FFT_TW(3, e2r - f2i, e2i + f2r)
+            FFT_TW(4, e1r - f1i, e1i + f1r)
+        }
+    }
+}
+
+#undef FFT_X
+#undef FFT_Y
+#undef FFT_TW
+
+/*
+    THE PLANS
+    Everything of a transform size that does not depend on the data is
+    computed once: the radix-2 twiddles, the radix passes of the
+    mixed-radix FFT with their twiddles, the chirp of Bluestein's algorithm
+    with its spectrum, the twiddles splitting the real FFT. The transforms
+    only read the plan, so it may be shared by the threads, and every
+    thread passes its own scratch buffer of dsp_plan_scratch() points.
+*/
+enum { FFT_TRIVIAL, FFT_RADIX2, FFT_MIXED, FFT_BLUESTEIN };
+
+template <class T> struct dsp_plan
+{
+    unsigned size;
+    int      kind;          /* FFT_TRIVIAL...FFT_BLUESTEIN */
+    unsigned npass;         /* mixed radix: the radix of every pass */
+    unsigned char radix[32];
+    T        *wr, *wi;      /* exp(-j*2*pi*t/size); Bluestein - the chirp */
+    unsigned m;             /* Bluestein: the size of the convolution */
+    T        *br, *bi;      /* ... the spectrum of the chirp divided by m */
+    dsp_plan<T> *conv;      /* ... the radix-2 plan of m points */
+    dsp_plan<float> *fplan; /* ... done in float for the fixed point */
+    dsp_plan<T> *half;      /* real FFT of an even size: the complex one of size/2 */
+    T        *rr, *ri;      /* ... its twiddles exp(-j*2*pi*k/size), k < size/2 */
+    unsigned scratch;       /* points of the scratch buffer */
+};
+
+template <class T>
+static void plan_bluestein( dsp_plan<T> *p );
+
+/* the tables of the complex FFT of size points */
+template <class T>
+static dsp_plan<T>* plan_complex( unsigned size )
+{
+    dsp_plan<T> *p = new dsp_plan<T>;
+
+    p->size  = size;
+    p->kind  = FFT_TRIVIAL;
+    p->npass = 0;
+    p->wr = p->wi = p->br = p->bi = p->rr = p->ri = NULL;
+    p->m  = 0;
+    p->conv = p->half = NULL;
+    p->fplan = NULL;
+    p->scratch = 0;
+
+    if( size < 2 )
+        ;
+    else if( (size & (size-1)) == 0 ) {
+        p->kind = FFT_RADIX2;
+        p->wr = new T[size];
+        p->wi = p->wr + size/2;
+        fft_twiddles(p->wr, p->wi, size, size/2);
+    }
+    else if( fft_smooth(size) ) {
+        unsigned n = size;
+
+        p->kind = FFT_MIXED;
+        while( n > 1 ) {
+            const unsigned r = (n % 4 == 0)? 4: (n % 2 == 0)? 2: (n % 3 == 0)? 3: 5;
+            p->radix[p->npass++] = (unsigned char)r;
+            n /= r;
+        }
+        p->wr = new T[2*size];
+        p->wi = p->wr + size;
+        fft_twiddles(p->wr, p->wi, size, size);
+        p->scratch = 2*size;
+    }
+    else if( fft_math<T>::scaled ) {
+        /* the fixed point would lose most of its bits in the three scaled
+           FFTs of the convolution, so these sizes are done in float: the
+           scratch holds the float copy of the data and the float scratch */
+        p->kind  = FFT_BLUESTEIN;
+        p->fplan = plan_complex<float>(size);
+        p->scratch = (unsigned)(((2*size + p->fplan->scratch)*sizeof(float) +
+            sizeof(T) - 1)/sizeof(T));
+    }
+    else
+        plan_bluestein(p);
+
+    return p;
+}
+
+/* the chirp exp(-j*pi*k*k/size) and the spectrum of its conjugate over
+   m >= 2*size-1 points, divided by m for the inverse FFT */
+template <class T>
+static void plan_bluestein( dsp_plan<T> *p )
+{
+    const unsigned size = p->size;
+    unsigned m, k;
+
+    for( m = 1; m < 2*size-1; m <<= 1 );
+
+    p->kind = FFT_BLUESTEIN;
+    p->m    = m;
+    p->conv = plan_complex<T>(m);
+    p->wr = new T[2*size + 2*m];
+    p->wi = p->wr + size;
+    p->br = p->wi + size;
+    p->bi = p->br + m;
+
+    for( k = 0; k < m; k++ ) p->br[k] = p->bi[k] = 0;
+
+    for( k = 0; k < size; k++ ) {
+        /* k*k mod 2*size keeps the angle exact for the large k */
+        const double a = PI_D*fmod((double)k*k, 2.0*size)/size;
+        p->wr[k] = (T)cos(a);
+        p->wi[k] = (T)-sin(a);
+
+        p->br[k] =  p->wr[k];
+        p->bi[k] = -p->wi[k];
+        if( k ) {
+            p->br[m-k] =  p->wr[k];
+            p->bi[m-k] = -p->wi[k];
+        }
+    }
+
+    fft_radix2(p->br, p->bi, m, p->conv->wr, p->conv->wi);
+
+    for( k = 0; k < m; k++ ) {
+        p->br[k] /= (T)m;
+        p->bi[k] /= (T)m;
+    }
+
+    p->scratch = 2*m;
+}
+
+/* the complex FFT of size points and the real one, see dsp_realfft() */
+template <class T>
+dsp_plan<T>* dsp_plan_create( unsigned size )
+{
+    dsp_plan<T> *p = plan_complex<T>(size);
+
+    if( size >= 2 && size % 2 == 0 ) {
+        const unsigned n = size/2;
+
+        p->half = plan_complex<T>(n);
+        p->rr = new T[2*n];
+        p->ri = p->rr + n;
+        fft_twiddles(p->rr, p->ri, size, n);
+
+        if( p->half->scratch > p->scratch ) p->scratch = p->half->scratch;
+    }
+
+    return p;
+}
+
+template <class T>
+void dsp_plan_free( dsp_plan<T>* p )
+{
+    if( !p ) return;
+
+    dsp_plan_free(p->conv);
+    dsp_plan_free(p->fplan);
+    dsp_plan_free(p->half);
+    delete[] p->wr;
+    delete[] p->rr;
+    delete p;
+}
+
+template <class T>
+unsigned dsp_plan_size( const dsp_plan<T>* p )
+{
+    return p->size;
+}
+
+template <class T>
+unsigned dsp_plan_scratch( const dsp_plan<T>* p )
+{
+    return p->scratch;
+}
+
+/*
+    MIXED-RADIX FFT
+    Self-sorting (Stockham) forward transform of size = 2^a*3^b*5^c points,
+    one radix 4, 2, 3 or 5 pass per factor, the passes go between rex[],imx[]
+    and the scratch buffer of 2*size points so no reordering is needed. The
+    cost per point is close to that of the radix-2 FFT of the nearest power
+    of two.
+*/
+template <class T>
+static void fft_mixed( const dsp_plan<T> *p, T rex[], T imx[], T buf[] )
+{
+    const unsigned size = p->size;
+    const T *wr = p->wr, *wi = p->wi;
+    T *xr = rex, *xi = imx, *yr = buf, *yi = buf + size, *tp;
+    unsigned n = size, s = 1, r, m, i, k;
+
+    for( k = 0; k < p->npass; k++ )
+    {
+        r = p->radix[k];
+        m = n / r;
+
+        switch( r ) {
+        case 2: fft_pass2(xr, xi, yr, yi, wr, wi, s, m, size/n); break;
+        case 3: fft_pass3(xr, xi, yr, yi, wr, wi, s, m, size/n); break;
+        case 4: fft_pass4(xr, xi, yr, yi, wr, wi, s, m, size/n); break;
+        default: fft_pass5(xr, xi, yr, yi, wr, wi, s, m, size/n); break;
+        }
+
+        tp = xr; xr = yr; yr = tp;
+        tp = xi; xi = yi; yi = tp;
+        n = m;
+        s *= r;
+    }
+
+    if( xr != rex ) {
+        for( i = 0; i < size; i++ ) {
+            rex[i] = xr[i];
+            imx[i] = xi[i];
+        }
+    }
+}
+
+/*
+    BLUESTEIN FFT
+    Forward transform of any size as the convolution with the chirp
+    exp(-j*pi*k*k/size), done by three radix-2 FFTs of at least 2*size-1
+    points, one of them - the spectrum of the chirp - in the plan. Used for
+    the sizes having prime factors other than 2, 3 and 5. The scratch
+    buffer holds 2*m points.
+*/
+template <class T>
+static void fft_bluestein( const dsp_plan<T> *p, T rex[], T imx[], T buf[] )
+{
+    const unsigned size = p->size, m = p->m;
+    const T *wr = p->wr, *wi = p->wi, *br = p->br, *bi = p->bi;
+    T *ar = buf, *ai = buf + m;
+    T tr, ti;
+    unsigned k;
+
+    for( k = 0; k < size; k++ ) {
+        ar[k] = rex[k]*wr[k] - imx[k]*wi[k];
+        ai[k] = rex[k]*wi[k] + imx[k]*wr[k];
+    }
+    for( ; k < m; k++ ) ar[k] = ai[k] = 0;
+
+    fft_radix2(ar, ai, m, p->conv->wr, p->conv->wi);
+
+    /* the convolution: the inverse FFT of the product, as the forward FFT
+       of its conjugate */
+    for( k = 0; k < m; k++ ) {
+        tr = ar[k]*br[k] - ai[k]*bi[k];
+        ti = ar[k]*bi[k] + ai[k]*br[k];
+        ar[k] = tr;
+        ai[k] = -ti;
+    }
+
+    fft_radix2(ar, ai, m, p->conv->wr, p->conv->wi);
+
+    for( k = 0; k < size; k++ ) {
+        const T cr = ar[k], ci = -ai[k];
+        rex[k] = cr*wr[k] - ci*wi[k];
+        imx[k] = cr*wi[k] + ci*wr[k];
+    }
+}
+
+/* in float, see plan_complex(); the scratch of new[] is aligned for it */
+template <>
+void fft_bluestein<short>( const dsp_plan<short> *p, short rex[], short imx[], short buf[] )
+{
+    typedef fft_math<short> M;
+    const unsigned size = p->size;
+    float *xr = (float*)buf;
+    float *xi = xr + size;
+    const double k = 1.0/size;
+    unsigned i;
+
+    for( i = 0; i < size; i++ ) {
+        xr[i] = (float)M::to(rex[i]);
+        xi[i] = (float)M::to(imx[i]);
+    }
+
+    fft_bluestein(p->fplan, xr, xi, xi + size);
+
+    for( i = 0; i < size; i++ ) {
+        rex[i] = M::from(xr[i]*k);
+        imx[i] = M::from(xi[i]*k);
+    }
+}
+
+/*
+    Any size: the radix-2 FFT for the powers of two, the mixed-radix one
+    for 2^a*3^b*5^c points and Bluestein's algorithm for all the others.
+*/
+template <class T>
+void dsp_fft( const dsp_plan<T>* plan, T rex[], T imx[], int forward, T scratch[] )
+{
+    typedef fft_math<T> M;
+    const unsigned size = plan->size;
+    unsigned i;
+
+    /* change the sign of imx[] */
+    if( forward == -1 ) for (i = 0; i < size; i++) imx[i] = -imx[i];
+
+    switch( plan->kind ) {
+    case FFT_RADIX2:    fft_radix2(rex, imx, size, plan->wr, plan->wi); break;
+    case FFT_MIXED:     fft_mixed(plan, rex, imx, scratch); break;
+    case FFT_BLUESTEIN: fft_bluestein(plan, rex, imx, scratch); break;
+    }
 
     if( forward == -1 ) {
-        tr = 1.0f/(float)size;
+        /* the fixed point is divided by size in the passes already */
+        const T tr = M::scaled? (T)1: (T)(1.0/size);
         for (i = 0; i < size; i++) {
             /* divide the time domain by size and change the sign of imx[] */
             rex[i] *= tr;
@@ -82,6 +579,19 @@ void dsp_fft( float rex[], float imx[], unsigned size, int forward )
     }
 }
 
+/* a single transform, its plan is made for it */
+template <class T>
+void dsp_fft( T rex[], T imx[], unsigned size, int forward )
+{
+    dsp_plan<T> *plan = plan_complex<T>(size);
+    T *scratch = plan->scratch? new T[plan->scratch]: NULL;
+
+    dsp_fft(plan, rex, imx, forward, scratch);
+
+    delete[] scratch;
+    dsp_plan_free(plan);
+}
+
 /*
     FFT FOR REAL SIGNALS
     Upon entry, size contains the number of points in the DFT, rex[] contains
@@ -94,10 +604,27 @@ void dsp_fft( float rex[], float imx[], unsigned size, int forward )
     are ignored. Upon return, rex[] contains the real time domain, imx[]
     contains zeros.
 */
-void dsp_realfft( float rex[], float imx[], unsigned size, int forward )
+template <class T>
+static void realfft_any( const dsp_plan<T>* plan, T rex[], T imx[], int forward, T scratch[] );
+
+template <class T>
+void dsp_realfft( const dsp_plan<T>* plan, T rex[], T imx[], int forward, T scratch[] )
 {
+    typedef fft_math<T> M;
+    typedef typename M::acc acc;
+    const unsigned size = plan->size;
+    const T *wr = plan->rr, *wi = plan->ri;
     unsigned nm1, nd2, n4, i, im, ip2, ipm, j, l, le, le2, jm1, ip;
-    float tr, ti, ur, ui, sr ,si;
+
+    if( size < 2 ) {
+        if( size ) imx[0] = 0;
+        return;
+    }
+
+    if( size & (size-1) ) {
+        realfft_any(plan, rex, imx, forward, scratch);
+        return;
+    }
 
     if( forward == -1 ) {
         /* Make frequency domain symmetrical */
@@ -119,7 +646,7 @@ void dsp_realfft( float rex[], float imx[], unsigned size, int forward )
         imx[i] = rex[2*i+1];
     }
 
-    dsp_fft(rex, imx, nd2, 1);
+    dsp_fft(plan->half, rex, imx, 1, scratch);
 
     nm1 = size - 1; /* even/odd frequency domain decomposition */
     n4 = size >> 2;
@@ -127,114 +654,378 @@ void dsp_realfft( float rex[], float imx[], unsigned size, int forward )
         im  = nd2-i;
         ip2 = i+nd2;
         ipm = im+nd2;
-        rex[ip2] =  (imx[i] + imx[im])*0.5f;
+        rex[ip2] =  M::half(imx[i] + imx[im]);
         rex[ipm] =  rex[ip2];
-        imx[ip2] = -(rex[i] - rex[im])*0.5f;
+        imx[ip2] =  M::half(rex[im] - rex[i]);
         imx[ipm] = -imx[ip2];
-        rex[i]   =  (rex[i] + rex[im])*0.5f;
+        rex[i]   =  M::half(rex[i] + rex[im]);
         rex[im]  =  rex[i];
-        imx[i]   =  (imx[i] - imx[im])*0.5f;
+        imx[i]   =  M::half(imx[i] - imx[im]);
         imx[im]  = -imx[i];
     }
     rex[(size*3)/4] = imx[size/4];
     rex[nd2] = imx[0];
-    imx[(size*3)/4] = imx[nd2] = imx[size/4] = imx[0] = 0.0f;
+    imx[(size*3)/4] = imx[nd2] = imx[size/4] = imx[0] = 0;
 
+    /* the last stage, exp(-j*pi*jm1/le2) is the twiddle jm1 of the plan */
     le = 1 << l;
     le2 = le >> 1;
-    ur = 1.0f;
-    ui = 0.0f;
-    sr = (float)cos(PI/le2);
-    si = (float)-sin(PI/le2);
     for( j = 1; j <= le2; ++j ) {
         jm1 = j-1;
+        const T wr1 = wr[jm1], wi1 = wi[jm1];
         for( i = jm1; i <= nm1; i += le ) {
             ip = i+le2;
-            tr = rex[ip]*ur - imx[ip]*ui;
-            ti = rex[ip]*ui + imx[ip]*ur;
-            rex[ip] = rex[i]-tr;
-            imx[ip] = imx[i]-ti;
-            rex[i]  = rex[i]+tr;
-            imx[i]  = imx[i]+ti;
+            const acc xr = M::mul(rex[ip], wr1) - M::mul(imx[ip], wi1);
+            const acc xi = M::mul(rex[ip], wi1) + M::mul(imx[ip], wr1);
+            const acc qr = rex[i], qi = imx[i];
+            rex[ip] = M::stage(qr - xr, 2);
+            imx[ip] = M::stage(qi - xi, 2);
+            rex[i]  = M::stage(qr + xr, 2);
+            imx[i]  = M::stage(qi + xi, 2);
         }
-        tr = ur;
-        ur = tr*sr - ui*si;
-        ui = tr*si + ui*sr;
     }
 
     if( forward == -1 ) {
+        const T tr = M::scaled? (T)1: (T)(1.0/size);
         for (i = 0; i < size; i++) {
-            rex[i] = (rex[i]+imx[i])*(1.0f/(float)size);
-            imx[i] = 0.0f;
+            rex[i] = (rex[i]+imx[i])*tr;
+            imx[i] = 0;
         }
     }
 }
 
-/* rectangular-to-polar conversion */
-void dsp_rect2polar( float rex[], float imx[], unsigned size )
+/* a single transform, its plan is made for it */
+template <class T>
+void dsp_realfft( T rex[], T imx[], unsigned size, int forward )
 {
+    dsp_plan<T> *plan = dsp_plan_create<T>(size);
+    T *scratch = plan->scratch? new T[plan->scratch]: NULL;
+
+    dsp_realfft(plan, rex, imx, forward, scratch);
+
+    delete[] scratch;
+    dsp_plan_free(plan);
+}
+
+/*
+    REAL FFT OF ANY SIZE
+    The even size points are packed into size/2 complex ones,
+    z[n] = x[2n] + j*x[2n+1], and the spectrum is split back as
+    X[k] = E[k] + exp(-j*2*pi*k/size)*O[k], where E and O are the even
+    and odd parts of Z. The odd sizes are done by the complex FFT. The
+    output is as of dsp_realfft(): all size points, the upper half mirrored.
+*/
+template <class T>
+static void realfft_any( const dsp_plan<T>* plan, T rex[], T imx[], int forward, T scratch[] )
+{
+    typedef fft_math<T> M;
+    typedef typename M::acc acc;
+    const unsigned size = plan->size, nd2 = size >> 1;
+    const T *wr = plan->rr, *wi = plan->ri;
+    unsigned i, k;
+
+    if( forward == -1 ) {
+        for (i = (size>>1)+1; i < size; i++) {
+            rex[i] =  rex[size-i];
+            imx[i] = -imx[size-i];
+        }
+        dsp_fft(plan, rex, imx, -1, scratch);
+        for (i = 0; i < size; i++) imx[i] = 0;
+        return;
+    }
+
+    if( size & 1 ) {
+        for (i = 0; i < size; i++) imx[i] = 0;
+        dsp_fft(plan, rex, imx, 1, scratch);
+        return;
+    }
+
+    for( i = 0; i < nd2; i++ ) {
+        rex[i] = rex[2*i];
+        imx[i] = rex[2*i+1];
+    }
+
+    dsp_fft(plan->half, rex, imx, 1, scratch);
+
+    for( k = 0; k <= nd2/2; k++ ) {
+        const unsigned j = (nd2 - k) % nd2;
+        /* E = (Z[k] + conj(Z[j]))/2, O = (Z[k] - conj(Z[j]))/(2j) */
+        const T er = M::half(rex[k] + rex[j]), ei = M::half(imx[k] - imx[j]);
+        const T or_ = M::half(imx[k] + imx[j]), oi = M::half(rex[j] - rex[k]);
+        const acc pr = M::mul(or_, wr[k]) - M::mul(oi, wi[k]);
+        const acc pi = M::mul(oi, wr[k]) + M::mul(or_, wi[k]);
+
+        /* X[k] = E + W^k*O, X[nd2-k] = conj(E - W^k*O) */
+        rex[k] = M::stage(er + pr, 2);
+        imx[k] = M::stage(ei + pi, 2);
+        rex[nd2-k] = M::stage(er - pr, 2);
+        imx[nd2-k] = M::stage(pi - ei, 2);
+    }
+
+    for( k = 1; k < nd2; k++ ) {
+        rex[size-k] =  rex[k];
+        imx[size-k] = -imx[k];
+    }
+}
+
+/*
+    The cosine-sum windows w[n] = a0 - a1*cos(2*pi*n/size) + a2*cos(4*pi*n/size)
+    - ..., DFT-even as the other cosine windows. Returns the number of the
+    coefficients in a[], 0 if the window is not a cosine sum.
+*/
+int dsp_window_cosines( int window, double a[5] )
+{
+    static const double coefs[][5] = {
+        { 1.0 },                                        /* RECTANGULAR */
+        { 0.54, 0.46 },                                 /* HAMMING */
+        { 0.5, 0.5 },                                   /* HANNING */
+        { 0.42, 0.5, 0.08 },                            /* BLACKMAN */
+        { 0.35875, 0.48829, 0.14128, 0.01168 },         /* BLACKMAN_HARRIS */
+        { 0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368 } /* FLATTOP */
+    };
+    int row, count, i;
+
+    switch( window )
+    {
+        case RECTANGULAR:     row = 0; count = 1; break;
+        case HAMMING:         row = 1; count = 2; break;
+        case HANNING:         row = 2; count = 2; break;
+        case BLACKMAN:        row = 3; count = 3; break;
+        case BLACKMAN_HARRIS: row = 4; count = 4; break;
+        case FLATTOP:         row = 5; count = 5; break;
+        default: return 0;
+    }
+
+    for( i = 0; i < 5; i++ ) a[i] = (i < count)? coefs[row][i]: 0.0;
+
+    return count;
+}
+
+/* modified Bessel function of the first kind, order 0 */
+static double bessel_i0( double x )
+{
+    double sum = 1.0, term = 1.0;
+    const double q = x*x/4.0;
+    unsigned k;
+
+    for( k = 1; k < 500 && term > sum*1e-17; k++ ) {
+        term *= q/((double)k*k);
+        sum += term;
+    }
+    return sum;
+}
+
+/*
+    The discrete prolate spheroidal sequence of the order (0 - the first)
+    of size points for the half-bandwidth nw/size: the eigenvector of the
+    order+1-th largest eigenvalue of the tridiagonal matrix commuting with
+    the concentration problem, found by bisection on the Sturm sequence and
+    inverse iteration. Normalized to the peak 1.
+*/
+static void dpss_window( double w[], unsigned size, double nw, unsigned order )
+{
+    const double c = cos(2.0*PI_D*nw/size);
+    double *d = new double[3*size];
+    double *e = d + size, *u = d + 2*size; /* e[i] couples i-1 and i */
+    double lo, hi, lambda, peak;
+    unsigned i, it;
+
+    for( i = 0; i < size; i++ ) {
+        const double t = ((double)size - 1.0 - 2.0*i)/2.0;
+        d[i] = t*t*c;
+        e[i] = i? (double)i*(size - i)/2.0: 0.0;
+    }
+
+    /* Gershgorin bounds of the spectrum */
+    lo = hi = d[0];
+    for( i = 0; i < size; i++ ) {
+        const double r = fabs(e[i]) + ((i+1 < size)? fabs(e[i+1]): 0.0);
+        if( d[i] - r < lo ) lo = d[i] - r;
+        if( d[i] + r > hi ) hi = d[i] + r;
+    }
+
+    /* the eigenvalue with order eigenvalues above it */
+    for( it = 0; it < 200 && hi - lo > 1e-12*(fabs(hi) + 1.0); it++ ) {
+        const double x = (lo + hi)/2.0;
+        double q = d[0] - x;
+        unsigned above = (q > 0.0);
+
+        for( i = 1; i < size; i++ ) {
+            q = d[i] - x - e[i]*e[i]/((q != 0.0)? q: 1e-300);
+            above += (q > 0.0);
+        }
+        if( above > order ) lo = x; else hi = x;
+    }
+    lambda = hi + 1e-10*(fabs(hi) + 1.0);
+
+    /* inverse iteration: (A - lambda)*w = u by the tridiagonal elimination,
+       from a vector with both the even and the odd parts */
+    for( i = 0; i < size; i++ ) w[i] = 1.0 + (double)i/size;
+
+    for( it = 0; it < 3; it++ )
+    {
+        u[0] = d[0] - lambda;
+        for( i = 1; i < size; i++ ) {
+            const double f = e[i]/((u[i-1] != 0.0)? u[i-1]: 1e-300);
+            u[i] = d[i] - lambda - f*e[i];
+            w[i] -= f*w[i-1];
+        }
+        w[size-1] /= (u[size-1] != 0.0)? u[size-1]: 1e-300;
+        for( i = size-1; i-- > 0; )
+            w[i] = (w[i] - e[i+1]*w[i+1])/((u[i] != 0.0)? u[i]: 1e-300);
+
+        for( peak = 0.0, i = 0; i < size; i++ )
+            if( fabs(w[i]) > fabs(peak) ) peak = w[i];
+        for( i = 0; i < size; i++ ) w[i] /= peak;
+    }
+
+    delete[] d;
+}
+
+/* rectangular-to-polar conversion, the fixed point phase is in units of pi */
+template <class T>
+void dsp_rect2polar( T rex[], T imx[], unsigned size )
+{
+    typedef fft_math<T> M;
     register unsigned i;
-    float mag, phase;
+    double re, im, mag, phase;
 
     /* rectangular-to-polar conversion */
     for (i = 0; i < size; i++) {
-        mag = (float)sqrt(rex[i]*rex[i] + imx[i]*imx[i]);
+        re = M::to(rex[i]);
+        im = M::to(imx[i]);
+        mag = sqrt(re*re + im*im);
         /* prevent divide by 0 
-        phase = (rex[i] == 0.0f)? 0.0f: (float)atan(imx[i]/rex[i]);*/
-        phase = (float)atan(imx[i]/rex[i]);
+        phase = (re == 0.0)? 0.0: atan(im/re);*/
+        phase = atan(im/re);
 
-        if (rex[i] < 0.0f) phase += (imx[i] < 0.0f)? -PI: PI;
-        rex[i] = mag;
-        imx[i] = phase;
+        if (re < 0.0) phase += (im < 0.0)? -PI_D: PI_D;
+        rex[i] = M::from(mag);
+        imx[i] = M::from(M::scaled? phase/PI_D: phase);
     }
 }
 
 
-void dsp_window( float coef[], unsigned size, int window )
+template <class T>
+void dsp_window( T coef[], unsigned size, int window, double param )
 {
+    typedef fft_math<T> M;
     const unsigned size2 = (size-1)/2;
     unsigned       i;
     const float    k = 1.0f/size2;
+    const float    kp = 1.0f/size;
+    const double   half = (size - 1)/2.0;
+    double         a[5];
 
     switch( window )
 	{
         case RECTANGULAR:
             for( i = 0; i < size; i++ ) {
-                coef[i] = 1.0f;
+                coef[i] = M::from(1.0);
             }
             break;
         case BARTLETT:
             for (i = 0; i < size; i++) {
                 int n = i - size2;
                 if (n < 0) n = -n;
-                coef[i] = 1.0f - k*n;
+                coef[i] = M::from(1.0f - k*n);
             }
             break;
+        /* the cosine windows are DFT-even (periodic): the argument runs
+           over one period per size points so that the sliding DFT can
+           apply them in the frequency domain */
         case HAMMING:
             for( i = 0; i < size; i++ ) {
-                coef[i] = 0.54f - 0.46f*cos(PI2*i*k);
+                coef[i] = M::from(0.54f - 0.46f*cos(PI2*i*kp));
             }
             break;
         case HANNING:
             for( i = 0; i < size; i++ ) {
-                coef[i] = 0.5f - 0.5f*cos(PI2*i*k);
+                coef[i] = M::from(0.5f - 0.5f*cos(PI2*i*kp));
             }
             break;
         case BLACKMAN:
             for( i = 0; i < size; i++ ) {
-                coef[i] = 0.42f - 0.5f*cos(PI2*i*k) + 0.08f*cos(PI4*i*k);
+                coef[i] = M::from(0.42f - 0.5f*cos(PI2*i*kp) + 0.08f*cos(PI4*i*kp));
             }
             break;
         case WELCH:
             for( i = 0; i < size; i++ ) {
                 int n = i - size2;
                 if (n < 0) n = -n;
-                coef[i] = 1.0f - sqrtf(k*n);
+                coef[i] = M::from(1.0f - sqrtf(k*n));
+            }
+            break;
+        case BLACKMAN_HARRIS:
+        case FLATTOP:
+            dsp_window_cosines(window, a);
+            for( i = 0; i < size; i++ ) {
+                const double x = 2.0*PI_D*i/size;
+                coef[i] = M::from(a[0] - a[1]*cos(x) + a[2]*cos(2*x) - a[3]*cos(3*x) + a[4]*cos(4*x));
             }
             break;
+        case KAISER: {
+            const double beta = (param > 0.0)? param: 8.6;
+            const double norm = 1.0/bessel_i0(beta);
+            for( i = 0; i < size; i++ ) {
+                const double x = (half > 0.0)? (i - half)/half: 0.0;
+                coef[i] = M::from(bessel_i0(beta*sqrt(1.0 - x*x))*norm);
+            }
+            break;
+        }
+        case GAUSSIAN: {
+            const double sigma = ((param > 0.0)? param: 0.4)*half;
+            for( i = 0; i < size; i++ ) {
+                const double x = (sigma > 0.0)? (i - half)/sigma: 0.0;
+                coef[i] = M::from(exp(-0.5*x*x));
+            }
+            break;
+        }
+        case DPSS: {
+            double *w = new double[size];
+            dpss_window(w, size, (param > 0.0)? param: 3.0, 0);
+            for( i = 0; i < size; i++ ) coef[i] = M::from(w[i]);
+            delete[] w;
+            break;
+        }
     }
 }
 
+/*
+    The window of frame points in the middle of size coefficients, zeros
+    around it: the frame zero-padded to the FFT size.
+*/
+template <class T>
+void dsp_window_padded( T coef[], unsigned size, unsigned frame, int window, double param )
+{
+    const unsigned first = (size - frame)/2;
+    unsigned       i;
+
+    for( i = 0; i < size; i++ ) coef[i] = 0;
+
+    dsp_window(coef + first, frame, window, param);
+}
+
+/*
+    The DPSS taper of the order in the middle frame points of size
+    coefficients, zeros around it; nw as the param of DPSS, 0 - 3.
+*/
+template <class T>
+void dsp_dpss_padded( T coef[], unsigned size, unsigned frame, double nw, unsigned order )
+{
+    typedef fft_math<T> M;
+    const unsigned first = (size - frame)/2;
+    double         *w = new double[frame];
+    unsigned       i;
+
+    dpss_window(w, frame, (nw > 0.0)? nw: 3.0, order);
+
+    for( i = 0; i < size; i++ ) coef[i] = 0;
+    for( i = 0; i < frame; i++ ) coef[first + i] = M::from(w[i]);
+
+    delete[] w;
+}
+
 void dsp_window_apply0( float rex[], float coef[], unsigned size)
 {
     unsigned       i;
@@ -251,18 +1042,160 @@ void dsp_window_apply0( float rex[], float coef[], unsigned size)
     }
 }
 
-void dsp_window_apply( float dst[], const float src[], const float coef[], const unsigned size)
+template <class T>
+void dsp_window_apply( T dst[], const T src[], const T coef[], const unsigned size)
 {
+    typedef fft_math<T> M;
     unsigned       i;
 
-    for (i = 0; i < size; i += 8) {
-        dst[i  ] = src[i  ] * coef[i  ];
-        dst[i+1] = src[i+1] * coef[i+1];
-        dst[i+2] = src[i+2] * coef[i+2];
-        dst[i+3] = src[i+3] * coef[i+3];
-        dst[i+4] = src[i+4] * coef[i+4];
-        dst[i+5] = src[i+5] * coef[i+5];
-        dst[i+6] = src[i+6] * coef[i+6];
-        dst[i+7] = src[i+7] * coef[i+7];
+    for (i = 0; i + 8 <= size; i += 8) {
+        dst[i  ] = (T)M::mul(src[i  ], coef[i  ]);
+        dst[i+1] = (T)M::mul(src[i+1], coef[i+1]);
+        dst[i+2] = (T)M::mul(src[i+2], coef[i+2]);
+        dst[i+3] = (T)M::mul(src[i+3], coef[i+3]);
+        dst[i+4] = (T)M::mul(src[i+4], coef[i+4]);
+        dst[i+5] = (T)M::mul(src[i+5], coef[i+5]);
+        dst[i+6] = (T)M::mul(src[i+6], coef[i+6]);
+        dst[i+7] = (T)M::mul(src[i+7], coef[i+7]);
+    }
+    /* the sizes not divisible by 8 */
+    for (; i < size; i++) dst[i] = (T)M::mul(src[i], coef[i]);
+}
+
+/*
+    THE MAGNITUDE SPECTRUM
+    size/2 magnitudes of the real FFT of src[]*win[] into mag[], computed
+    in dsp_sample: size is that of the plan, rex[] & imx[] are the buffers
+    of size+2 points and scratch[] the one of dsp_plan_scratch(), mag[] may
+    be rex[] itself when dsp_sample is float. The magnitudes are in the
+    scale of the float FFT whatever the sample type.
+*/
+void dsp_spectrum( float mag[], const float src[], const float win[],
+    const dsp_plan<dsp_sample>* plan, dsp_sample rex[], dsp_sample imx[], dsp_sample scratch[] )
+{
+    typedef fft_math<dsp_sample> M;
+    const unsigned size = plan->size;
+    const double k = M::scaled? (double)size: 1.0;
+    unsigned i;
+
+    for( i = 0; i < size; i++ ) rex[i] = M::from(src[i]*win[i]);
+
+    dsp_realfft(plan, rex, imx, 1, scratch);
+
+    for( i = 0; i < size/2; i++ ) {
+        const double re = M::to(rex[i]), im = M::to(imx[i]);
+        mag[i] = (float)(k*sqrt(re*re + im*im));
     }
 }
+
+/*
+    THE MULTITAPER SPECTRUM
+    As dsp_spectrum() for tapers windows of size coefficients stride apart
+    in win[]: the root of the mean power of their spectra. The frame is
+    converted once, only the windowing and the FFT are repeated per taper.
+    mag[] accumulates the powers, so it must not be rex[] or imx[].
+*/
+void dsp_multitaper( float mag[], const float src[], const float win[], unsigned stride,
+    unsigned tapers, const dsp_plan<dsp_sample>* plan, dsp_sample rex[], dsp_sample imx[],
+    dsp_sample scratch[] )
+{
+    typedef fft_math<dsp_sample> M;
+    const unsigned size = plan->size;
+    const double k = M::scaled? (double)size: 1.0;
+    const double kp = k*k/tapers;
+    unsigned i, t;
+
+    for( i = 0; i < size/2; i++ ) mag[i] = 0.0f;
+
+    for( t = 0; t < tapers; t++ )
+    {
+        const float *w = win + (size_t)t*stride;
+
+        for( i = 0; i < size; i++ ) rex[i] = M::from(src[i]*w[i]);
+
+        dsp_realfft(plan, rex, imx, 1, scratch);
+
+        for( i = 0; i < size/2; i++ ) {
+            const double re = M::to(rex[i]), im = M::to(imx[i]);
+            mag[i] += (float)(re*re + im*im);
+        }
+    }
+
+    for( i = 0; i < size/2; i++ ) mag[i] = (float)sqrt(kp*mag[i]);
+}
+
+/*
+    THE REASSIGNED SPECTRUM
+    As dsp_spectrum(), but the power of every bin is moved to its
+    instantaneous frequency k - Im(Xd/X)*size/(2*pi), where X is the
+    spectrum of src[]*win[] and Xd the one of src[]*dwin[], dwin[] - the
+    derivative of the window per sample. Both are real, so they share one
+    complex FFT: X is the even and Xd the odd part of it. The powers are
+    accumulated in mag[] and multiplied by kp before the root, so mag[]
+    must not be rex[] or imx[].
+*/
+void dsp_reassigned( float mag[], const float src[], const float win[], const float dwin[],
+    const dsp_plan<dsp_sample>* plan, double kp, dsp_sample rex[], dsp_sample imx[],
+    dsp_sample scratch[] )
+{
+    typedef fft_math<dsp_sample> M;
+    const unsigned size = plan->size;
+    const double k = M::scaled? (double)size: 1.0;
+    const double kb = size/(2.0*PI_D);
+    const int size2 = (int)size/2;
+    int i;
+
+    for( i = 0; i < (int)size; i++ ) {
+        rex[i] = M::from(src[i]*win[i]);
+        imx[i] = M::from(src[i]*dwin[i]);
+    }
+
+    dsp_fft(plan, rex, imx, 1, scratch);
+
+    for( i = 0; i < size2; i++ ) mag[i] = 0.0f;
+
+    for( i = 0; i < size2; i++ )
+    {
+        const int j = i? (int)size - i: 0;
+        const double zr = M::to(rex[i]), zi = M::to(imx[i]);
+        const double wr = M::to(rex[j]), wi = M::to(imx[j]);
+        /* X = (Z[i] + conj Z[j])/2, Xd = (Z[i] - conj Z[j])/2j */
+        const double xr = (zr + wr)/2.0, xi = (zi - wi)/2.0;
+        const double dr = (zi + wi)/2.0, di = (wr - zr)/2.0;
+        const double p = xr*xr + xi*xi;
+        int bin;
+
+        if( p <= 0.0 ) continue;
+
+        bin = (int)floor(i - kb*(di*xr - dr*xi)/p + 0.5);
+        if( bin >= 0 && bin < size2 ) mag[bin] += (float)p;
+    }
+
+    for( i = 0; i < size2; i++ ) mag[i] = (float)(k*sqrt(kp*mag[i]));
+}
+
+/* the sample types of the kernels */
+#define FFT_INSTANTIATE(T) \
+    template void dsp_fft<T>( T rex[], T imx[], unsigned size, int forward ); \
+    template void dsp_realfft<T>( T rex[], T imx[], unsigned size, int forward ); \
+    template dsp_plan<T>* dsp_plan_create<T>( unsigned size ); \
+    template void dsp_plan_free<T>( dsp_plan<T>* plan ); \
+    template unsigned dsp_plan_size<T>( const dsp_plan<T>* plan ); \
+    template unsigned dsp_plan_scratch<T>( const dsp_plan<T>* plan ); \
+    template void dsp_fft<T>( const dsp_plan<T>* plan, T rex[], T imx[], int forward, \
+        T scratch[] ); \
+    template void dsp_realfft<T>( const dsp_plan<T>* plan, T rex[], T imx[], int forward, \
+        T scratch[] ); \
+    template void dsp_rect2polar<T>( T rex[], T imx[], unsigned size ); \
+    template void dsp_window<T>( T coef[], unsigned size, int window, double param ); \
+    template void dsp_window_padded<T>( T coef[], unsigned size, unsigned frame, int window, \
+        double param ); \
+    template void dsp_dpss_padded<T>( T coef[], unsigned size, unsigned frame, double nw, \
+        unsigned order ); \
+    template void dsp_window_apply<T>( T dst[], const T src[], const T coef[], const unsigned size );
+
+FFT_INSTANTIATE(float)
+FFT_INSTANTIATE(double)
+FFT_INSTANTIATE(short)
+
+#undef FFT_INSTANTIATE
@@ -10,11 +10,71 @@
 #ifndef _FFT_H
 #define _FFT_H
 
-enum { RECTANGULAR, BARTLETT, HAMMING, HANNING, BLACKMAN, WELCH };
+enum { RECTANGULAR, BARTLETT, HAMMING, HANNING, BLACKMAN, WELCH,
+       BLACKMAN_HARRIS, FLATTOP, KAISER, GAUSSIAN, DPSS };
 
-void dsp_realfft( float rex[], float imx[], unsigned size, int forward );
-void dsp_rect2polar( float rex[], float imx[], unsigned size );
-void dsp_window( float rex[], unsigned size, int window );
-void dsp_window_apply( float dst[], const float src[], const float win[], const unsigned size );
+/*
+    The kernels are instantiated in fft.cpp for float, double and short.
+    short is the Q15 fixed point: its forward transforms are scaled by
+    1/size, its windows hold the coefficients times 32768 and its phases
+    are in units of pi.
+*/
+template <class T> void dsp_fft( T rex[], T imx[], unsigned size, int forward );
+template <class T> void dsp_realfft( T rex[], T imx[], unsigned size, int forward );
+
+/*
+    The plan of a size holds its twiddles, factors and chirp, so the
+    repeated transforms compute no sines and allocate nothing: the caller
+    passes a scratch buffer of dsp_plan_scratch() points, one per thread,
+    while the plan itself may be shared. The transforms above make a plan
+    for every call.
+*/
+template <class T> struct dsp_plan;
+
+template <class T> dsp_plan<T>* dsp_plan_create( unsigned size );
+template <class T> void dsp_plan_free( dsp_plan<T>* plan );
+template <class T> unsigned dsp_plan_size( const dsp_plan<T>* plan );
+template <class T> unsigned dsp_plan_scratch( const dsp_plan<T>* plan );
+template <class T> void dsp_fft( const dsp_plan<T>* plan, T rex[], T imx[], int forward,
+    T scratch[] );
+template <class T> void dsp_realfft( const dsp_plan<T>* plan, T rex[], T imx[], int forward,
+    T scratch[] );
+
+template <class T> void dsp_rect2polar( T rex[], T imx[], unsigned size );
+template <class T> void dsp_window( T rex[], unsigned size, int window, double param = 0.0 );
+template <class T> void dsp_window_padded( T rex[], unsigned size, unsigned frame, int window,
+    double param = 0.0 );
+template <class T> void dsp_dpss_padded( T rex[], unsigned size, unsigned frame, double nw,
+    unsigned order );
+
+/*
+    param of the windows, 0 - the default: KAISER - beta (8.6), GAUSSIAN -
+    sigma relative to the half size (0.4), DPSS - the time-half-bandwidth
+    product NW (3).
+*/
+int dsp_window_cosines( int window, double a[5] );
+template <class T> void dsp_window_apply( T dst[], const T src[], const T win[], const unsigned size );
+
+/*
+    The sample type of the analysis FFTs, chosen at compile time: float by
+    default, FFT_DOUBLE for the measurements, FFT_FIXED for the 16 bit
+    fixed point that halves the memory traffic of the overview.
+*/
+#if defined(FFT_DOUBLE)
+typedef double dsp_sample;
+#elif defined(FFT_FIXED)
+typedef short  dsp_sample;
+#else
+typedef float  dsp_sample;
+#endif
+
+void dsp_spectrum( float mag[], const float src[], const float win[],
+    const dsp_plan<dsp_sample>* plan, dsp_sample rex[], dsp_sample imx[], dsp_sample scratch[] );
+void dsp_multitaper( float mag[], const float src[], const float win[], unsigned stride,
+    unsigned tapers, const dsp_plan<dsp_sample>* plan, dsp_sample rex[], dsp_sample imx[],
+    dsp_sample scratch[] );
+void dsp_reassigned( float mag[], const float src[], const float win[], const float dwin[],
+    const dsp_plan<dsp_sample>* plan, double kp, dsp_sample rex[], dsp_sample imx[],
+    dsp_sample scratch[] );
 
 #endif/*_FFT_H*/
@@ -0,0 +1,87 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     filewatch.cpp
+** License:  GNU
+**
+** On Linux the file is watched with inotify and Check() is a single
+** non-blocking read of the pending events. Elsewhere Check() always says
+** the file may have changed and the caller compares the file length.
+******************************************************************************/
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+    #pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#ifdef __LINUX__
+	#include <sys/inotify.h>
+	#include <unistd.h>
+#endif
+
+#include "filewatch.h"
+
+FileWatch::FileWatch(): m_fd(-1), m_wd(-1), m_opened(false)
+{
+}
+
+FileWatch::~FileWatch()
+{
+	Close();
+}
+
+bool FileWatch::Open(const wxString& path)
+{
+	Close();
+
+#ifdef __LINUX__
+	m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (m_fd >= 0) {
+		m_wd = inotify_add_watch(m_fd, path.fn_str(), IN_MODIFY | IN_CLOSE_WRITE);
+		if (m_wd < 0) {
+			close(m_fd);
+			m_fd = -1;
+		}
+	}
+#else
+	(void)path;
+#endif
+
+	m_opened = true;
+
+	return true;
+}
+
+void FileWatch::Close()
+{
+#ifdef __LINUX__
+	if (m_fd >= 0) close(m_fd); // removes the watch too
+#endif
+	m_fd = m_wd = -1;
+	m_opened = false;
+}
+
+// true if the file may have been written since the last call
+bool FileWatch::Check()
+{
+	if (!m_opened) return false;
+
+#ifdef __LINUX__
+	if (m_fd >= 0) {
+		char events[4096];
+		bool changed = false;
+
+		while (read(m_fd, events, sizeof(events)) > 0)
+			changed = true;
+
+		return changed;
+	}
+#endif
+
+	return true;
+}
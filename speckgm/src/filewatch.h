@@ -0,0 +1,32 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     filewatch.h
+** License:  GNU
+**
+** Notification of writes to a file that is still being recorded.
+******************************************************************************/
+#ifndef _FILEWATCH_H
+#define _FILEWATCH_H
+
+#include <wx/string.h>
+
+class FileWatch
+{
+public:
+	FileWatch();
+	~FileWatch();
+
+	bool Open(const wxString& path);
+	void Close();
+
+	bool IsOpened() const { return m_opened; }
+	bool Check();
+
+private:
+	int  m_fd; // inotify instance
+	int  m_wd; // watch of the file
+	bool m_opened;
+};
+
+#endif/*_FILEWATCH_H*/
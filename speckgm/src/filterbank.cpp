@@ -0,0 +1,180 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     filterbank.cpp
+** License:  GNU
+**
+** Every band is a triangle from the previous band center to the next one.
+** Only non-zero weights are stored, so applying the bank costs about two
+** multiplications per input bin whatever the number of bands is. A band
+** narrower than the bin spacing interpolates between the two nearest bins.
+******************************************************************************/
+#include <stdlib.h>
+#include <math.h>
+#include <vector>
+#include "filterbank.h"
+
+FilterBank::FilterBank(): m_bins(0), m_bands(0), m_rate(0), m_scale(LINEAR), m_freq(NULL),
+	m_first(NULL), m_count(NULL), m_offset(NULL), m_weight(NULL)
+{
+}
+
+FilterBank::~FilterBank()
+{
+	Free();
+}
+
+void FilterBank::Free()
+{
+	delete[] m_freq;
+	delete[] m_first;
+	delete[] m_count;
+	delete[] m_offset;
+	delete[] m_weight;
+
+	m_freq   = NULL;
+	m_first  = m_count = m_offset = NULL;
+	m_weight = NULL;
+}
+
+/*
+** Log-frequency bands: centers from fmin to rate/2 at a constant ratio.
+** bins  - FFT size/2;
+** bands - number of bands, usually the height of the view.
+*/
+bool FilterBank::InitLog(unsigned bins, unsigned bands, unsigned rate, float fmin)
+{
+	Free();
+
+	m_bins  = bins;
+	m_bands = bands;
+	m_rate  = rate;
+	m_scale = LOG;
+
+	if (m_bands < 2) return false;
+
+	const float fmax  = 0.5f*rate;
+	const float ratio = (float)pow(fmax/fmin, 1.0/(m_bands-1));
+
+	m_freq = new float[m_bands+2];
+	m_freq[0] = fmin/ratio;
+	for (unsigned i = 1; i <= m_bands+1; i++)
+		m_freq[i] = m_freq[i-1]*ratio;
+
+	return Build(m_freq);
+}
+
+static inline double hz2mel(double hz)  { return 2595.0*log10(1.0 + hz/700.0); }
+static inline double mel2hz(double mel) { return 700.0*(pow(10.0, mel/2595.0) - 1.0); }
+
+/*
+** Mel bands: centers equally spaced on the mel scale, the first and
+** the last triangles start at fmin and end at fmax.
+*/
+bool FilterBank::InitMel(unsigned bins, unsigned bands, unsigned rate, float fmin, float fmax)
+{
+	Free();
+
+	m_bins  = bins;
+	m_bands = bands;
+	m_rate  = rate;
+	m_scale = MEL;
+
+	if (m_bands < 2) return false;
+
+	const double mlo = hz2mel(fmin);
+	const double step = (hz2mel(fmax) - mlo)/(m_bands+1);
+
+	m_freq = new float[m_bands+2];
+	for (unsigned i = 0; i <= m_bands+1; i++)
+		m_freq[i] = (float)mel2hz(mlo + i*step);
+
+	return Build(m_freq);
+}
+
+// centers[] - m_bands+2 frequencies, the first and the last are the edges
+bool FilterBank::Build(const float centers[])
+{
+	const float df = float(m_rate)/(2*m_bins); // bin spacing, Hz
+	std::vector<float> weight;
+
+	m_first  = new unsigned[m_bands];
+	m_count  = new unsigned[m_bands];
+	m_offset = new unsigned[m_bands];
+
+	for (unsigned b = 0; b < m_bands; b++)
+	{
+		const float lo = centers[b], fc = centers[b+1], hi = centers[b+2];
+
+		unsigned first = unsigned(ceil(lo/df));
+		unsigned last  = unsigned(floor(hi/df));
+		if (last >= m_bins) last = m_bins-1;
+
+		m_offset[b] = weight.size();
+		float sum = 0.0f;
+
+		for (unsigned j = first; j <= last && first <= last; j++) {
+			const float f = j*df;
+			const float w = (f <= fc)? (f-lo)/(fc-lo): (hi-f)/(hi-fc);
+			if (w <= 0.0f) continue;
+			if (weight.size() == m_offset[b]) first = j;
+			weight.push_back(w);
+			sum += w;
+		}
+
+		if (sum > 0.0f) {
+			// normalize so the band is a weighted mean of its bins
+			for (unsigned i = m_offset[b]; i < weight.size(); i++)
+				weight[i] /= sum;
+			m_first[b] = first;
+			m_count[b] = weight.size() - m_offset[b];
+		}
+		else {
+			// narrow band - linear interpolation between the nearest bins
+			float    x  = fc/df;
+			unsigned j0 = unsigned(x);
+			if (j0 >= m_bins-1) {
+				j0 = m_bins-2;
+				x  = float(m_bins-1);
+			}
+			weight.push_back(1.0f - (x-j0));
+			weight.push_back(x-j0);
+			m_first[b] = j0;
+			m_count[b] = 2;
+		}
+	}
+
+	m_weight = new float[weight.size()];
+	for (unsigned i = 0; i < weight.size(); i++) m_weight[i] = weight[i];
+
+	return true;
+}
+
+// in[] - m_bins values, out[] - m_bands values
+void FilterBank::Apply(const float in[], float out[]) const
+{
+	for (unsigned b = 0; b < m_bands; b++)
+	{
+		const float *w = m_weight + m_offset[b];
+		const float *x = in + m_first[b];
+		float sum = 0.0f;
+
+		for (unsigned i = 0; i < m_count[b]; i++)
+			sum += w[i]*x[i];
+
+		out[b] = sum;
+	}
+}
+
+// fractional band number of the frequency
+float FilterBank::GetBand(float freq) const
+{
+	if (freq <= m_freq[1]) return 0.0f;
+
+	for (unsigned b = 1; b < m_bands; b++) {
+		if (freq <= m_freq[b+1])
+			return (b-1) + (freq - m_freq[b])/(m_freq[b+1] - m_freq[b]);
+	}
+
+	return float(m_bands-1);
+}
@@ -0,0 +1,49 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     filterbank.h
+** License:  GNU
+**
+** Sparse bank of triangular filters over the FFT bins, used to map the
+** linear spectrum onto a log-frequency or mel axis.
+******************************************************************************/
+#ifndef _FILTERBANK_H
+#define _FILTERBANK_H
+
+class FilterBank
+{
+public:
+	enum { LINEAR, LOG, MEL };
+
+	FilterBank();
+	~FilterBank();
+
+	bool InitLog(unsigned bins, unsigned bands, unsigned rate, float fmin);
+	bool InitMel(unsigned bins, unsigned bands, unsigned rate, float fmin, float fmax);
+	void Apply(const float in[], float out[]) const;
+
+	bool IsSame(unsigned bins, unsigned bands, unsigned rate, int scale) const
+		{ return m_bins == bins && m_bands == bands && m_rate == rate && m_scale == scale; }
+
+	unsigned GetBands() const { return m_bands; }
+	int GetScale() const { return m_scale; }
+	float GetFreq(unsigned band) const { return m_freq[band]; }
+	float GetBand(float freq) const;
+
+protected:
+	bool Build(const float centers[]);
+	void Free();
+
+private:
+	unsigned m_bins;   // input size, FFT size/2
+	unsigned m_bands;  // output size
+	unsigned m_rate;   // sample rate
+	int      m_scale;  // LOG or MEL
+	float    *m_freq;  // band center frequencies, m_bands+2 with the edges
+	unsigned *m_first; // first bin of the band
+	unsigned *m_count; // number of bins in the band
+	unsigned *m_offset; // band's first weight in m_weight[]
+	float    *m_weight;
+};
+
+#endif/*_FILTERBANK_H*/
@@ -0,0 +1,131 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     framecache.cpp
+** License:  GNU
+**
+** LRU cache of analysed frames. All the frame buffers are allocated once
+** in one pool so storing a frame never allocates memory, the least recently
+** used frame is simply reused.
+******************************************************************************/
+#include <string.h>
+#include <algorithm>
+#include "framecache.h"
+
+FrameCache::FrameCache(): m_pool(NULL), m_capacity(0), m_length(0)
+{
+}
+
+FrameCache::~FrameCache()
+{
+	if (m_pool) delete[] m_pool;
+}
+
+/*
+** capacity - number of frames to keep;
+** length   - FFT size, a frame holds length samples and length/2 dB values.
+*/
+bool FrameCache::Init(unsigned capacity, unsigned length)
+{
+	m_lru.clear();
+	m_index.clear();
+	m_free.clear();
+
+	if (m_pool) {
+		delete[] m_pool;
+		m_pool = NULL;
+	}
+
+	m_capacity = capacity;
+	m_length   = length;
+
+	const unsigned frame_size = m_length + m_length/2;
+	m_pool = new float[m_capacity*frame_size];
+
+	if (!m_pool) {
+		m_capacity = 0;
+		return false;
+	}
+
+	for (unsigned i = 0; i < m_capacity; i++) {
+		Frame frame;
+		frame.pos     = 0;
+		frame.res     = 0;
+		frame.samples = m_pool + i*frame_size;
+		frame.dB      = frame.samples + m_length;
+		frame.min     = 0.0f;
+		frame.max     = 0.0f;
+		frame.max_bin = 0;
+		m_free.push_back(frame);
+	}
+
+	return true;
+}
+
+// drop all frames, i.e. when the file or the FFT window is changed
+void FrameCache::Reset()
+{
+	m_index.clear();
+	m_free.splice(m_free.end(), m_lru);
+}
+
+// drop the frames reaching the samples from end, i.e. the end of file
+// has moved and these frames were padded with zeros
+void FrameCache::Truncate(wxFileOffset end)
+{
+	FrameIndex::iterator it = m_index.lower_bound(end - m_length + 1);
+
+	while (it != m_index.end()) {
+		m_free.splice(m_free.end(), m_lru, it->second);
+		m_index.erase(it++);
+	}
+}
+
+const FrameCache::Frame* FrameCache::Find(wxFileOffset pos)
+{
+	FrameIndex::iterator it = m_index.find(pos);
+
+	if (it == m_index.end())
+		return NULL;
+
+	// move the frame to the list head
+	m_lru.splice(m_lru.begin(), m_lru, it->second);
+
+	return &*it->second;
+}
+
+const FrameCache::Frame* FrameCache::Store(wxFileOffset pos, int res, const float samples[], const float dB[])
+{
+	if (!m_capacity) return NULL;
+
+	FrameIndex::iterator it = m_index.find(pos);
+
+	if (it != m_index.end()) {
+		m_lru.splice(m_lru.begin(), m_lru, it->second);
+	}
+	else {
+		if (m_free.empty()) {
+			// evict the least recently used frame
+			m_index.erase(m_lru.back().pos);
+			m_lru.splice(m_lru.begin(), m_lru, --m_lru.end());
+		}
+		else {
+			m_lru.splice(m_lru.begin(), m_free, m_free.begin());
+		}
+		m_index[pos] = m_lru.begin();
+	}
+
+	Frame& frame = m_lru.front();
+	const unsigned length2 = m_length/2;
+
+	frame.pos = pos;
+	frame.res = res;
+	memcpy(frame.samples, samples, m_length*sizeof(float));
+	memcpy(frame.dB, dB, length2*sizeof(float));
+
+	frame.min     = *std::min_element(frame.samples, frame.samples+m_length);
+	frame.max     = *std::max_element(frame.samples, frame.samples+m_length);
+	frame.max_bin = std::max_element(frame.dB, frame.dB+length2) - frame.dB;
+
+	return &frame;
+}
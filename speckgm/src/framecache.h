@@ -0,0 +1,54 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     framecache.h
+** License:  GNU
+**
+** LRU cache of analysed frames (samples, dB spectrum and their extrema)
+** keyed by the frame's sample position in the file.
+******************************************************************************/
+#ifndef _FRAMECACHE_H
+#define _FRAMECACHE_H
+
+#include <wx/filefn.h>
+#include <list>
+#include <map>
+
+class FrameCache
+{
+public:
+	struct Frame {
+		wxFileOffset pos; // frame start, in samples (the key)
+		int      res;     // bytes read, as returned by ReadFrame()
+		float    *samples; // normalized samples, m_length
+		float    *dB;      // amplitude/frequency, m_length/2
+		float    min;     // min sample value
+		float    max;     // max sample value
+		unsigned max_bin; // index of the max dB value
+	};
+
+	FrameCache();
+	~FrameCache();
+
+	bool Init(unsigned capacity, unsigned length);
+	void Reset();
+	void Truncate(wxFileOffset end);
+
+	const Frame* Find(wxFileOffset pos);
+	const Frame* Store(wxFileOffset pos, int res, const float samples[], const float dB[]);
+
+	unsigned GetLength() const { return m_length; }
+
+private:
+	typedef std::list<Frame> FrameList;
+	typedef std::map<wxFileOffset, FrameList::iterator> FrameIndex;
+
+	FrameList  m_lru;      // most recently used first
+	FrameIndex m_index;    // position -> list entry
+	FrameList  m_free;     // unused frames
+	float      *m_pool;    // storage for all frames
+	unsigned   m_capacity; // max number of frames
+	unsigned   m_length;   // FFT size
+};
+
+#endif/*_FRAMECACHE_H*/
@@ -0,0 +1,191 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     frametask.cpp
+** License:  GNU
+**
+** The frames are split into one contiguous chunk per CPU, every FrameTask
+** reads its chunk with its own SampleReader in large sequential reads and
+** writes the samples and the spectra of its frames straight into its part
+** of the output arrays, so no locking is needed; the power sums of the
+** Welch PSD are kept per task and added up when all the tasks are done.
+** The samples before the file beginning and after its end are zeros, as
+** in AnalysisEngine::ReadSamples().
+******************************************************************************/
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+    #pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "fft.h"
+#include "decimator.h"
+#include "frametask.h"
+
+const unsigned FRAME_READ_FRAMES = 64; // frames per one read
+
+FrameTask::FrameTask(const wxString& path, ConvertFunc convert, unsigned bps, unsigned factor,
+	const FftWindow& window, unsigned hop, wxFileOffset first, unsigned nframes,
+	float samples[], float dB[], int res[], bool power): wxThread(wxTHREAD_JOINABLE),
+	m_path(path), m_convert(convert), m_bps(bps), m_factor(factor), m_window(&window),
+	m_scale(window.GetScale()), m_length(window.GetLength()), m_hop(hop), m_first(first), m_nframes(nframes),
+	m_samples(samples), m_dB(dB), m_res(res), m_power(NULL), m_ok(false)
+{
+	if (power) {
+		m_power = new double[m_length/2];
+		std::fill(m_power, m_power + m_length/2, 0.0);
+	}
+}
+
+FrameTask::~FrameTask()
+{
+	delete[] m_power;
+}
+
+void* FrameTask::Entry()
+{
+	SampleReader reader(m_convert, m_bps, m_factor);
+
+	if (!reader.Open(m_path)) return NULL;
+
+	const unsigned length2 = m_length/2;
+	const float k = m_scale;
+
+	// samples of FRAME_READ_FRAMES frames read at once
+	const unsigned span = (FRAME_READ_FRAMES-1)*m_hop + m_length;
+
+	float *samples = new float[span];
+	float *mag = new float[length2];
+	dsp_sample *rex = new dsp_sample[m_length+2];
+	dsp_sample *imx = new dsp_sample[m_length+2];
+	dsp_sample *scratch = new dsp_sample[m_window->GetScratch() + 1];
+
+	m_ok = true;
+
+	for (unsigned done = 0; done < m_nframes && m_ok; )
+	{
+		const unsigned nframes = std::min(FRAME_READ_FRAMES, m_nframes - done);
+		const unsigned count = (nframes-1)*m_hop + m_length;
+		const wxFileOffset pos = m_first + wxFileOffset(done)*m_hop;
+
+		// the padding of the first frames may start before the file
+		const int res = reader.Read(pos, samples, count);
+		if (res < 0) {
+			m_ok = false;
+			break;
+		}
+
+		// the part of the chunk that is in the file
+		const wxFileOffset from = std::max(pos, wxFileOffset(0));
+		const wxFileOffset to = from + res;
+
+		for (unsigned n = 0; n < nframes; n++)
+		{
+			const unsigned i = done + n;
+			const float *s = samples + n*m_hop;
+
+			if (m_res) {
+				const wxFileOffset first = std::max(pos + n*m_hop, from);
+				const wxFileOffset last  = std::min(pos + n*m_hop + m_length, to);
+
+				m_res[i] = (last > first)? int(last - first)*m_bps: 0;
+			}
+
+			if (m_samples) memcpy(m_samples + size_t(i)*m_length, s, m_length*sizeof(float));
+
+			m_window->Spectrum(mag, s, rex, imx, scratch);
+
+			// the same scale as AnalysisEngine::ConvertToDb()
+			if (m_dB) {
+				float *dB = m_dB + size_t(i)*length2;
+				for (unsigned j = 0; j < length2; j++) {
+					float v = 20.0f * (float)log10(mag[j] * k);
+					dB[j] = (v < -100.0f)? -100.0f: v;
+				}
+			}
+
+			if (m_power) {
+				for (unsigned j = 0; j < length2; j++)
+					m_power[j] += double(mag[j])*mag[j];
+			}
+		}
+
+		done += nframes;
+	}
+
+	delete[] samples;
+	delete[] mag;
+	delete[] rex;
+	delete[] imx;
+	delete[] scratch;
+
+	return NULL;
+}
+
+/*
+** Samples and spectra of nframes frames from first with the step hop,
+** length - the FFT size of the window:
+** samples[] - nframes*length, dB[] - nframes*length/2, res[] - the bytes
+** of the file data in every frame as returned by AnalysisEngine::ReadFrame(),
+** any of them may be NULL; power[] - NULL or length/2 sums the power of
+** the bins of all the frames is added to.
+** Returns false on error.
+*/
+bool ComputeFrames(const wxString& path, ConvertFunc convert, unsigned bps, unsigned factor,
+	const FftWindow& window, unsigned hop, wxFileOffset first, unsigned nframes,
+	float samples[], float dB[], int res[], double power[])
+{
+	const unsigned length = window.GetLength();
+
+	if (!nframes) return true;
+
+	int ntasks = wxThread::GetCPUCount();
+	if (ntasks < 1) ntasks = 1;
+	if (unsigned(ntasks) > nframes) ntasks = nframes;
+
+	std::vector<FrameTask*> tasks;
+	bool ok = true;
+	unsigned done = 0;
+
+	for (int t = 0; t < ntasks; t++)
+	{
+		const unsigned n = nframes/ntasks + ((unsigned(t) < nframes%ntasks)? 1: 0);
+		FrameTask *task = new FrameTask(path, convert, bps, factor, window, hop,
+			first + wxFileOffset(done)*hop, n,
+			samples? samples + size_t(done)*length: NULL,
+			dB? dB + size_t(done)*(length/2): NULL,
+			res? res + done: NULL, power != NULL);
+
+		if (task->Create() != wxTHREAD_NO_ERROR || task->Run() != wxTHREAD_NO_ERROR) {
+			delete task;
+			ok = false;
+			break;
+		}
+		tasks.push_back(task);
+		done += n;
+	}
+
+	for (unsigned t = 0; t < tasks.size(); t++)
+	{
+		tasks[t]->Wait();
+
+		if (!tasks[t]->IsOk()) ok = false;
+
+		if (power) {
+			const double *part = tasks[t]->GetPower();
+			for (unsigned i = 0; i < length/2; i++) power[i] += part[i];
+		}
+
+		delete tasks[t];
+	}
+
+	return ok;
+}
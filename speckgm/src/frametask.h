@@ -0,0 +1,54 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     frametask.h
+** License:  GNU
+**
+** Spectra of a run of equally spaced frames of a raw audio file, computed
+** by several threads. Used to fill the whole view at once after a jump,
+** by the pyramid and, summing the power of the frames, by the Welch PSD.
+******************************************************************************/
+#ifndef _FRAMETASK_H
+#define _FRAMETASK_H
+
+#include <wx/thread.h>
+#include <wx/file.h>
+#include "welch.h"
+
+class FrameTask: public wxThread
+{
+public:
+	FrameTask(const wxString& path, ConvertFunc convert, unsigned bps, unsigned factor,
+		const FftWindow& window, unsigned hop, wxFileOffset first, unsigned nframes,
+		float samples[], float dB[], int res[], bool power = false);
+	~FrameTask();
+
+	const double* GetPower() const { return m_power; }
+	bool IsOk() const { return m_ok; }
+
+protected:
+	virtual void* Entry();
+
+private:
+	wxString     m_path;
+	ConvertFunc  m_convert;
+	unsigned     m_bps;     // bytes per sample
+	unsigned     m_factor;  // decimation of the samples
+	const FftWindow *m_window; // shared, cached by the engine
+	float        m_scale;   // magnitudes to amplitudes of the window
+	unsigned     m_length;  // FFT size
+	unsigned     m_hop;     // frames step
+	wxFileOffset m_first;   // first frame position, samples
+	unsigned     m_nframes; // frames to process
+	float        *m_samples; // output: m_length samples per frame
+	float        *m_dB;      // output: m_length/2 values per frame
+	int          *m_res;     // output: bytes of the file data per frame
+	double       *m_power;   // sum of the bins power, m_length/2; NULL - none
+	bool         m_ok;
+};
+
+bool ComputeFrames(const wxString& path, ConvertFunc convert, unsigned bps, unsigned factor,
+	const FftWindow& window, unsigned hop, wxFileOffset first, unsigned nframes,
+	float samples[], float dB[], int res[], double power[] = NULL);
+
+#endif/*_FRAMETASK_H*/
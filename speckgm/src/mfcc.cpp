@@ -0,0 +1,91 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     mfcc.cpp
+** License:  GNU
+**
+** dB spectrum -> power -> mel filter bank -> log -> DCT-II.
+** The filter bank and the DCT matrix are precomputed in Init() for the
+** FFT size and the sample rate.
+******************************************************************************/
+#include <stdlib.h>
+#include <math.h>
+#include "mfcc.h"
+
+#define PI 3.1415926535897932384626433832795
+
+MelFeatures::MelFeatures(): m_size(0), m_rate(0), m_bands(0), m_coefs(0),
+	m_power(NULL), m_energy(NULL), m_dct(NULL)
+{
+}
+
+MelFeatures::~MelFeatures()
+{
+	delete[] m_power;
+	delete[] m_energy;
+	delete[] m_dct;
+}
+
+/*
+** size  - FFT size;
+** rate  - sample rate;
+** bands - number of mel bands;
+** coefs - number of MFCC, 0 - mel energies only.
+*/
+bool MelFeatures::Init(unsigned size, unsigned rate, unsigned bands, unsigned coefs)
+{
+	delete[] m_power;
+	delete[] m_energy;
+	delete[] m_dct;
+
+	m_size  = size;
+	m_rate  = rate;
+	m_bands = bands;
+	m_coefs = (coefs > bands)? bands: coefs;
+
+	m_power  = new float[m_size/2];
+	m_energy = new float[m_bands];
+	m_dct    = new float[m_coefs*m_bands + 1];
+
+	// orthonormal DCT-II
+	for (unsigned i = 0; i < m_coefs; i++) {
+		const double k = (i == 0)? sqrt(1.0/m_bands): sqrt(2.0/m_bands);
+		for (unsigned j = 0; j < m_bands; j++)
+			m_dct[i*m_bands + j] = (float)(k*cos(PI*i*(j + 0.5)/m_bands));
+	}
+
+	return m_bank.InitMel(m_size/2, m_bands, m_rate, 0.0f, 0.5f*m_rate);
+}
+
+/*
+** dB[]   - m_size/2 values of the frame spectrum;
+** mel[]  - m_bands log-energies of the mel bands, dB;
+** mfcc[] - m_coefs coefficients, may be NULL.
+*/
+void MelFeatures::Compute(const float dB[], float mel[], float mfcc[])
+{
+	const unsigned bins = m_size/2;
+
+	for (unsigned i = 0; i < bins; i++)
+		m_power[i] = (float)pow(10.0f, 0.1f*dB[i]);
+
+	m_bank.Apply(m_power, m_energy);
+
+	for (unsigned j = 0; j < m_bands; j++) {
+		const float e = (m_energy[j] > 1e-10f)? m_energy[j]: 1e-10f;
+		m_energy[j] = (float)log(e);
+		mel[j] = (float)(10.0/log(10.0))*m_energy[j];
+	}
+
+	if (!mfcc) return;
+
+	for (unsigned i = 0; i < m_coefs; i++) {
+		const float *d = m_dct + i*m_bands;
+		float sum = 0.0f;
+
+		for (unsigned j = 0; j < m_bands; j++)
+			sum += d[j]*m_energy[j];
+
+		mfcc[i] = sum;
+	}
+}
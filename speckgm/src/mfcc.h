@@ -0,0 +1,41 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     mfcc.h
+** License:  GNU
+**
+** Mel-filterbank energies and mel-frequency cepstral coefficients (MFCC)
+** of a frame computed from its dB spectrum.
+******************************************************************************/
+#ifndef _MFCC_H
+#define _MFCC_H
+
+#include "filterbank.h"
+
+class MelFeatures
+{
+public:
+	MelFeatures();
+	~MelFeatures();
+
+	bool Init(unsigned size, unsigned rate, unsigned bands, unsigned coefs);
+	void Compute(const float dB[], float mel[], float mfcc[]);
+
+	bool IsSame(unsigned size, unsigned rate) const
+		{ return m_size == size && m_rate == rate; }
+
+	unsigned GetBands() const { return m_bands; }
+	unsigned GetCoefs() const { return m_coefs; }
+
+private:
+	FilterBank m_bank;
+	unsigned m_size;   // FFT size
+	unsigned m_rate;   // sample rate
+	unsigned m_bands;  // number of mel bands
+	unsigned m_coefs;  // number of cepstral coefficients
+	float    *m_power; // bins power, m_size/2
+	float    *m_energy; // mel band energies, m_bands
+	float    *m_dct;   // DCT-II matrix, m_coefs x m_bands
+};
+
+#endif/*_MFCC_H*/
@@ -0,0 +1,140 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     npyfile.cpp
+** License:  GNU
+**
+** The number of rows is known in advance so the header is written first
+** and the rows are streamed after it. Rows are collected in a large
+** buffer and written by WRITE_BUFFER_SIZE chunks; the whole matrix is
+** never kept in memory.
+******************************************************************************/
+#include <string.h>
+#include "npyfile.h"
+
+const unsigned WRITE_BUFFER_SIZE = 1 << 20;
+
+// '<f4' or '>f4' depending on the byte order of this machine
+static const char* FloatDescr()
+{
+	const unsigned one = 1;
+	return (*(const char*)&one == 1)? "<f4": ">f4";
+}
+
+MatrixWriter::MatrixWriter(): m_file(NULL), m_format(NPY), m_rows(0),
+	m_cols(0), m_written(0), m_buffer(NULL), m_size(0), m_ok(false)
+{
+}
+
+MatrixWriter::~MatrixWriter()
+{
+	Close();
+}
+
+/*
+** path   - output file, for RAW the sidecar is path + ".json";
+** format - NPY or RAW;
+** rows, cols - matrix size, rows are written one by one by Write();
+** info   - extra JSON members for the RAW sidecar, e.g. "\"fft\": 512".
+*/
+bool MatrixWriter::Open(const char* path, int format, unsigned rows, unsigned cols,
+	const std::string& info)
+{
+	Close();
+
+	m_format  = format;
+	m_rows    = rows;
+	m_cols    = cols;
+	m_written = 0;
+	m_size    = 0;
+
+	if (m_format == RAW) {
+		std::string json(path);
+		json += ".json";
+
+		FILE *file = fopen(json.c_str(), "w");
+		if (!file) return false;
+
+		fprintf(file, "{\"dtype\": \"%s\", \"shape\": [%u, %u]%s%s}\n",
+			FloatDescr(), m_rows, m_cols, info.empty()? "": ", ", info.c_str());
+
+		if (fclose(file) != 0) return false;
+	}
+
+	m_file = fopen(path, "wb");
+	if (!m_file) return false;
+
+	m_buffer = new char[WRITE_BUFFER_SIZE];
+	m_ok = true;
+
+	if (m_format == NPY) {
+		// format version 1.0: magic, version, header length, header
+		// padded by spaces so that the data starts at a 64 bytes boundary
+		char dict[128];
+		const int len = sprintf(dict,
+			"{'descr': '%s', 'fortran_order': False, 'shape': (%u, %u), }",
+			FloatDescr(), m_rows, m_cols);
+
+		const unsigned total = ((10 + len + 1 + 63)/64)*64;
+		const unsigned hlen  = total - 10;
+
+		memcpy(m_buffer, "\x93NUMPY\x01\x00", 8);
+		m_buffer[8] = char(hlen & 0xFF);
+		m_buffer[9] = char(hlen >> 8);
+		memcpy(m_buffer + 10, dict, len);
+		memset(m_buffer + 10 + len, ' ', total - 10 - len - 1);
+		m_buffer[total-1] = '\n';
+		m_size = total;
+	}
+
+	return true;
+}
+
+bool MatrixWriter::Write(const float row[])
+{
+	if (!m_ok || m_written >= m_rows) return false;
+
+	const unsigned size = m_cols*sizeof(float);
+
+	if (m_size + size > WRITE_BUFFER_SIZE && !Flush())
+		return false;
+
+	if (size > WRITE_BUFFER_SIZE) {
+		// a row bigger than the buffer is written directly
+		if (fwrite(row, 1, size, m_file) != size) m_ok = false;
+	}
+	else {
+		memcpy(m_buffer + m_size, row, size);
+		m_size += size;
+	}
+
+	++m_written;
+
+	return m_ok;
+}
+
+bool MatrixWriter::Flush()
+{
+	if (m_size && fwrite(m_buffer, 1, m_size, m_file) != m_size)
+		m_ok = false;
+
+	m_size = 0;
+
+	return m_ok;
+}
+
+// the file is complete only if all the declared rows were written
+bool MatrixWriter::Close()
+{
+	if (!m_file) return false;
+
+	Flush();
+
+	if (fclose(m_file) != 0) m_ok = false;
+	m_file = NULL;
+
+	delete[] m_buffer;
+	m_buffer = NULL;
+
+	return m_ok && m_written == m_rows;
+}
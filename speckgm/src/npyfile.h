@@ -0,0 +1,42 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     npyfile.h
+** License:  GNU
+**
+** Streaming writer of float32 matrices: NumPy .npy files or raw float32
+** data with a JSON sidecar describing it.
+******************************************************************************/
+#ifndef _NPYFILE_H
+#define _NPYFILE_H
+
+#include <stdio.h>
+#include <string>
+
+class MatrixWriter
+{
+public:
+	enum { NPY, RAW };
+
+	MatrixWriter();
+	~MatrixWriter();
+
+	bool Open(const char* path, int format, unsigned rows, unsigned cols,
+		const std::string& info = std::string());
+	bool Write(const float row[]);
+	bool Close();
+
+private:
+	bool Flush();
+
+	FILE     *m_file;
+	int      m_format;
+	unsigned m_rows;    // rows declared in the header
+	unsigned m_cols;
+	unsigned m_written; // rows written
+	char     *m_buffer; // output buffer
+	unsigned m_size;    // bytes in m_buffer
+	bool     m_ok;
+};
+
+#endif/*_NPYFILE_H*/
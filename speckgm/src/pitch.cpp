@@ -0,0 +1,202 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     pitch.cpp
+** License:  GNU
+**
+** The autocorrelation of a frame is the inverse Fourier transform of its
+** power spectrum. As in the classic autocorrelation pitch detectors only
+** the band below 1 kHz (an eighth of the sample rate) is used, and only
+** the lags of fmax..fmin are needed, every other sample: they are summed
+** directly from a table of cosines, which is cheaper than a whole inverse
+** FFT, and the peak is refined by the parabolic interpolation. The power
+** is compressed to flatten the formants, looked up in a table by the dB
+** level, and the autocorrelation is divided by the one of the FFT window,
+** which would otherwise make the long periods look unvoiced. The
+** candidate nearest to the previous column's F0 is preferred, so octave
+** jumps need a clearly better peak.
+******************************************************************************/
+#include <stdlib.h>
+#include <math.h>
+#include "pitch.h"
+
+const double PI = 3.14159265358979323846;
+
+const unsigned PITCH_LAG_STEP = 2;   // samples between the lags
+const float PITCH_DB_MIN = -100.0f;  // range and step of the power table
+const float PITCH_DB_MAX = 20.0f;
+const float PITCH_DB_STEP = 0.1f;
+const float PITCH_COMPRESS = 0.33f;  // exponent of the power
+const float PITCH_VOICED = 0.4f;     // least normalized autocorrelation peak
+const float PITCH_OCTAVE = 0.9f;     // shorter lags win within this of the best
+const float PITCH_TRACK = 0.75f;     // the previous F0 wins within this of the best
+const float PITCH_JUMP = 0.2f;       // relative F0 change still on the track
+
+static float s_power[int((PITCH_DB_MAX - PITCH_DB_MIN)/PITCH_DB_STEP) + 1];
+static bool  s_power_ready = false;
+
+static void InitPower()
+{
+	const int n = sizeof(s_power)/sizeof(s_power[0]);
+
+	for (int i = 0; i < n; i++)
+		s_power[i] = (float)pow(10.0, PITCH_COMPRESS*(PITCH_DB_MIN + i*PITCH_DB_STEP)/10.0);
+
+	s_power_ready = true;
+}
+
+static inline float Power(float dB)
+{
+	const int n = sizeof(s_power)/sizeof(s_power[0]);
+	const int i = int((dB - PITCH_DB_MIN)*(1.0f/PITCH_DB_STEP) + 0.5f);
+
+	return s_power[(i < 0)? 0: (i >= n)? n-1: i];
+}
+
+PitchTracker::PitchTracker(): m_size(0), m_rate(0), m_bins(0), m_minlag(0), m_maxlag(0),
+	m_prev(0.0f), m_window(NULL), m_power(NULL), m_basis(NULL), m_acf(NULL), m_wacf(NULL)
+{
+}
+
+PitchTracker::~PitchTracker()
+{
+	delete[] m_power;
+	delete[] m_basis;
+	delete[] m_acf;
+	delete[] m_wacf;
+}
+
+/*
+** size   - FFT size of the spectra;
+** rate   - sample rate;
+** fmin, fmax - F0 range, Hz;
+** window - size coefs of the FFT window, NULL - rectangular.
+*/
+bool PitchTracker::Init(unsigned size, unsigned rate, float fmin, float fmax,
+	const float window[])
+{
+	delete[] m_power;
+	delete[] m_basis;
+	delete[] m_acf;
+	delete[] m_wacf;
+
+	if (!s_power_ready) InitPower();
+
+	m_size   = size;
+	m_rate   = rate;
+	m_window = window;
+	m_prev   = 0.0f;
+
+	const float lagrate = float(m_rate)/PITCH_LAG_STEP;
+
+	m_bins   = m_size/8;
+	m_minlag = unsigned(lagrate/fmax);
+	m_maxlag = unsigned(lagrate/fmin) + 1;
+	if (m_minlag < 2) m_minlag = 2;
+	if (m_maxlag > (m_size - 1)/PITCH_LAG_STEP - 1) m_maxlag = (m_size - 1)/PITCH_LAG_STEP - 1;
+
+	if (m_bins < 2 || m_minlag >= m_maxlag) {
+		m_power = m_basis = m_acf = m_wacf = NULL;
+		m_maxlag = m_minlag;
+		return false;
+	}
+
+	const unsigned nlags = m_maxlag - m_minlag + 3;
+
+	m_power = new float[m_bins];
+	m_basis = new float[nlags*m_bins];
+	m_acf   = new float[m_maxlag + 2];
+	m_wacf  = new float[m_maxlag + 2];
+
+	for (unsigned j = 0; j < nlags; j++)
+		for (unsigned k = 0; k < m_bins; k++)
+			m_basis[j*m_bins + k] = (float)cos(2.0*PI*k*(m_minlag - 1 + j)*PITCH_LAG_STEP/m_size);
+
+	// the window autocorrelation at the lags
+	double w0 = 0.0;
+	for (unsigned n = 0; n < m_size; n++)
+		w0 += window? double(window[n])*window[n]: 1.0;
+
+	for (unsigned j = m_minlag - 1; j <= m_maxlag + 1; j++)
+	{
+		const unsigned t = j*PITCH_LAG_STEP;
+		double r = 0.0;
+
+		for (unsigned n = 0; n + t < m_size; n++)
+			r += window? double(window[n])*window[n+t]: 1.0;
+
+		r /= w0;
+		m_wacf[j] = (r > 0.05)? float(1.0/r): 20.0f;
+	}
+
+	return true;
+}
+
+/*
+** F0 of the column with the dB spectrum dB[] (m_size/2 values), following
+** the previous column; 0 - unvoiced.
+*/
+float PitchTracker::Track(const float dB[])
+{
+	if (m_minlag >= m_maxlag) return 0.0f;
+
+	// the compressed power spectrum, without DC
+	float r0 = 0.0f;
+	m_power[0] = 0.0f;
+	for (unsigned k = 1; k < m_bins; k++)
+		r0 += m_power[k] = Power(dB[k]);
+
+	if (r0 <= 0.0f) return m_prev = 0.0f;
+
+	// the normalized autocorrelation of the lags, corrected for the window
+	float *r = m_acf;
+	const float *b = m_basis;
+
+	for (unsigned j = m_minlag - 1; j <= m_maxlag + 1; j++, b += m_bins)
+	{
+		float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+		unsigned k = 0;
+
+		for (; k + 4 <= m_bins; k += 4) {
+			s0 += m_power[k  ]*b[k  ];
+			s1 += m_power[k+1]*b[k+1];
+			s2 += m_power[k+2]*b[k+2];
+			s3 += m_power[k+3]*b[k+3];
+		}
+		for (; k < m_bins; k++) s0 += m_power[k]*b[k];
+
+		r[j] = (s0 + s1 + s2 + s3)/r0*m_wacf[j];
+	}
+
+	// the best peak and the thresholds relative to it
+	float best = 0.0f;
+
+	for (unsigned j = m_minlag; j <= m_maxlag; j++)
+		if (r[j] > r[j-1] && r[j] >= r[j+1] && r[j] > best) best = r[j];
+
+	if (best < PITCH_VOICED) return m_prev = 0.0f;
+
+	const float lagrate = float(m_rate)/PITCH_LAG_STEP;
+	const float track = m_prev? lagrate/m_prev: 0.0f;
+	unsigned lag = 0, near = 0;
+
+	for (unsigned j = m_minlag; j <= m_maxlag; j++)
+	{
+		if (!(r[j] > r[j-1] && r[j] >= r[j+1])) continue;
+
+		if (!lag && r[j] >= PITCH_OCTAVE*best) lag = j;
+
+		if (track && r[j] >= PITCH_TRACK*best && fabs(j - track) <= PITCH_JUMP*track &&
+			(!near || fabs(j - track) < fabs(near - track)))
+			near = j;
+	}
+
+	if (near) lag = near;
+
+	// the parabola through the peak
+	const float y0 = r[lag-1], y1 = r[lag], y2 = r[lag+1];
+	const float den = y0 - 2.0f*y1 + y2;
+	const float d = (den < 0.0f)? 0.5f*(y0 - y2)/den: 0.0f;
+
+	return m_prev = lagrate/(lag + d);
+}
@@ -0,0 +1,40 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     pitch.h
+** License:  GNU
+**
+** Fundamental frequency of the spectrogram columns, tracked column by
+** column from their dB spectra.
+******************************************************************************/
+#ifndef _PITCH_H
+#define _PITCH_H
+
+class PitchTracker
+{
+public:
+	PitchTracker();
+	~PitchTracker();
+
+	bool Init(unsigned size, unsigned rate, float fmin, float fmax, const float window[]);
+	float Track(const float dB[]);
+	void Reset() { m_prev = 0.0f; }
+
+	bool IsSame(unsigned size, unsigned rate, const float window[]) const
+		{ return m_size == size && m_rate == rate && m_window == window; }
+
+private:
+	unsigned m_size;   // FFT size of the spectra
+	unsigned m_rate;   // sample rate
+	unsigned m_bins;   // bins used, below the eighth of the rate
+	unsigned m_minlag; // lags of fmax..fmin, PITCH_LAG_STEP samples
+	unsigned m_maxlag;
+	float    m_prev;   // F0 of the previous column, 0 - unvoiced
+	const float *m_window; // FFT window of the spectra, m_size coefs
+	float    *m_power; // compressed power of the bins, m_bins
+	float    *m_basis; // cosines of the bins for the lags m_minlag-1..m_maxlag+1
+	float    *m_acf;   // autocorrelation at the lags 0..m_maxlag+1
+	float    *m_wacf;  // 1/normalized autocorrelation of the window
+};
+
+#endif/*_PITCH_H*/
@@ -0,0 +1,331 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     prefetch.cpp
+** License:  GNU
+**
+** The raw file data is cached in blocks of BLOCK_SIZE bytes. AnalysisEngine
+** takes its data from the cache and reads the file only on a miss, while
+** the Prefetcher thread reads ahead of the scrolling using its own file
+** handle so the GUI thread is not stalled by slow storage.
+******************************************************************************/
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+    #pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#if !defined(__WXMSW__)
+    #include <fcntl.h>
+#endif
+
+#include <string.h>
+#include <algorithm>
+#include "prefetch.h"
+
+/******************************************************************************
+**  BlockCache class
+******************************************************************************/
+BlockCache::BlockCache(): m_pool(NULL), m_capacity(0), m_generation(0)
+{
+}
+
+BlockCache::~BlockCache()
+{
+	if (m_pool) delete[] m_pool;
+}
+
+bool BlockCache::Init(unsigned capacity)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	m_lru.clear();
+	m_index.clear();
+	m_free.clear();
+
+	if (m_pool) {
+		delete[] m_pool;
+		m_pool = NULL;
+	}
+
+	m_capacity = capacity;
+	m_pool = new unsigned char[m_capacity*BLOCK_SIZE];
+
+	if (!m_pool) {
+		m_capacity = 0;
+		return false;
+	}
+
+	for (unsigned i = 0; i < m_capacity; i++) {
+		Block block;
+		block.index = -1;
+		block.size  = 0;
+		block.data  = m_pool + i*BLOCK_SIZE;
+		m_free.push_back(block);
+	}
+
+	++m_generation;
+
+	return true;
+}
+
+// drop all blocks, data being read by the Prefetcher at the moment
+// belongs to the previous generation and will not be stored
+void BlockCache::Reset()
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	m_index.clear();
+	m_free.splice(m_free.end(), m_lru);
+	++m_generation;
+}
+
+// drop the blocks from the end offset, the file has grown and the last
+// block is not the end of file any more
+void BlockCache::Truncate(wxFileOffset end)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	BlockIndex::iterator it = m_index.lower_bound(long(end / BLOCK_SIZE));
+
+	while (it != m_index.end()) {
+		m_free.splice(m_free.end(), m_lru, it->second);
+		m_index.erase(it++);
+	}
+	++m_generation;
+}
+
+bool BlockCache::Has(long block)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	return m_index.find(block) != m_index.end();
+}
+
+/*
+** Copy size bytes from the file offset into dst[]. Returns the number of
+** bytes copied (less than size at the end of file) or -1 if some block is
+** not in the cache.
+*/
+int BlockCache::Read(wxFileOffset offset, unsigned char dst[], unsigned size)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	unsigned done = 0;
+
+	while (done < size) {
+		const long     index = long(offset / BLOCK_SIZE);
+		const unsigned start = unsigned(offset % BLOCK_SIZE);
+
+		BlockIndex::iterator it = m_index.find(index);
+		if (it == m_index.end())
+			return -1;
+
+		m_lru.splice(m_lru.begin(), m_lru, it->second);
+
+		const Block& block = *it->second;
+		if (start >= block.size)
+			break; // end of file
+
+		unsigned n = std::min(block.size - start, size - done);
+		memcpy(dst + done, block.data + start, n);
+		done   += n;
+		offset += n;
+
+		if (block.size < BLOCK_SIZE)
+			break; // end of file
+	}
+
+	return int(done);
+}
+
+void BlockCache::Put(long index, const unsigned char data[], unsigned size, unsigned generation)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	if (!m_capacity || generation != m_generation) return;
+
+	BlockIndex::iterator it = m_index.find(index);
+
+	if (it != m_index.end()) {
+		m_lru.splice(m_lru.begin(), m_lru, it->second);
+	}
+	else {
+		if (m_free.empty()) {
+			// evict the least recently used block
+			m_index.erase(m_lru.back().index);
+			m_lru.splice(m_lru.begin(), m_lru, --m_lru.end());
+		}
+		else {
+			m_lru.splice(m_lru.begin(), m_free, m_free.begin());
+		}
+		m_index[index] = m_lru.begin();
+	}
+
+	Block& block = m_lru.front();
+
+	block.index = index;
+	block.size  = size;
+	memcpy(block.data, data, size);
+}
+
+/******************************************************************************
+**  Prefetcher class
+**  --------------------------------------------------------------------------
+**  Read-ahead thread. The GUI thread gives a hint - the current position
+**  and how many bytes it is going to need next (negative when scrolling
+**  backward), the thread reads the missing blocks into the BlockCache.
+******************************************************************************/
+Prefetcher::Prefetcher(BlockCache& cache): wxThread(wxTHREAD_JOINABLE),
+	m_cache(cache), m_hint(0,1), m_pathserial(0), m_offset(0), m_ahead(0), m_serial(0),
+	m_run(false), m_buffer(NULL)
+{
+}
+
+bool Prefetcher::Start()
+{
+	m_buffer = new unsigned char[BlockCache::BLOCK_SIZE];
+	m_run = true;
+
+	if (wxThread::Create() != wxTHREAD_NO_ERROR) {
+		m_run = false;
+		return false;
+	}
+
+	return wxThread::Run() == wxTHREAD_NO_ERROR;
+}
+
+void Prefetcher::Stop()
+{
+	if (!m_run) return;
+
+	m_run = false;
+	m_hint.Post();
+	wxThread::Wait();
+
+	Close();
+	if (m_file.IsOpened()) m_file.Close();
+
+	delete[] m_buffer;
+	m_buffer = NULL;
+}
+
+/*
+** The thread opens the file itself on the next request, the callers only
+** lock to post a request, so they never wait for a read in progress: it
+** sees the new m_serial and stops after its current block.
+*/
+bool Prefetcher::Open(const wxString& path)
+{
+	{
+		wxMutexLocker lock(m_mutex);
+		m_path  = path;
+		m_ahead = 0;
+		++m_pathserial;
+		++m_serial;
+	}
+	m_hint.Post();
+
+	return wxFile::Exists(path);
+}
+
+void Prefetcher::Close()
+{
+	{
+		wxMutexLocker lock(m_mutex);
+		m_path.Clear();
+		m_ahead = 0;
+		++m_pathserial;
+		++m_serial;
+	}
+	m_hint.Post();
+}
+
+void Prefetcher::Hint(wxFileOffset offset, long ahead)
+{
+	{
+		wxMutexLocker lock(m_mutex);
+		m_offset = offset;
+		m_ahead  = ahead;
+		++m_serial;
+	}
+	m_hint.Post();
+}
+
+void* Prefetcher::Entry()
+{
+	unsigned pathserial = m_pathserial - 1; // the file of m_file
+
+	while (m_run)
+	{
+		if (m_hint.WaitTimeout(1000) != wxSEMA_NO_ERROR)
+			continue;
+
+		wxString     path;
+		unsigned     serial, fileserial;
+		wxFileOffset offset;
+		long         ahead;
+		{
+			wxMutexLocker lock(m_mutex);
+			path       = m_path;
+			fileserial = m_pathserial;
+			serial     = m_serial;
+			offset     = m_offset;
+			ahead      = m_ahead;
+		}
+
+		if (fileserial != pathserial) {
+			if (m_file.IsOpened()) m_file.Close();
+			if (!path.IsEmpty()) m_file.Open(path);
+			pathserial = fileserial;
+		}
+
+		if (ahead && m_file.IsOpened()) Fetch(offset, ahead, serial);
+	}
+
+	return NULL;
+}
+
+// serial - of the request, a newer one stops the reading
+void Prefetcher::Fetch(wxFileOffset offset, long ahead, unsigned serial)
+{
+	const long size  = BlockCache::BLOCK_SIZE;
+	long       first = long(offset / size);
+	long       last  = long((offset + ahead) / size);
+	const int  step  = (ahead > 0)? 1: -1;
+
+	if (last < 0) last = 0;
+
+#if !defined(__WXMSW__) && defined(POSIX_FADV_WILLNEED)
+	// let the kernel start reading the whole range at once
+	{
+		const wxFileOffset from = std::min(first, last)*wxFileOffset(size);
+		const wxFileOffset len  = ((last > first)? last - first + 1: first - last + 1)*wxFileOffset(size);
+		posix_fadvise(m_file.fd(), from, len, POSIX_FADV_WILLNEED);
+	}
+#endif
+
+	for (long index = first; m_run && m_serial == serial; index += step)
+	{
+		if (!m_cache.Has(index))
+		{
+			const unsigned generation = m_cache.GetGeneration();
+
+			if (m_file.Seek(index*wxFileOffset(size), wxFromStart) == wxInvalidOffset)
+				break;
+
+			const ssize_t res = m_file.Read(m_buffer, size);
+			if (res < 0) break;
+
+			m_cache.Put(index, m_buffer, unsigned(res), generation);
+
+			if (res < size) break; // end of file
+		}
+
+		if (index == last) break;
+	}
+}
@@ -0,0 +1,87 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     prefetch.h
+** License:  GNU
+**
+** Block cache of the raw file data and the read-ahead thread filling it
+** in the direction the user scrolls.
+******************************************************************************/
+#ifndef _PREFETCH_H
+#define _PREFETCH_H
+
+#include <wx/thread.h>
+#include <wx/file.h>
+#include <list>
+#include <map>
+
+class BlockCache
+{
+public:
+	enum { BLOCK_SIZE = 64*1024 };
+
+	BlockCache();
+	~BlockCache();
+
+	bool Init(unsigned capacity);
+	void Reset();
+	void Truncate(wxFileOffset end);
+
+	int  Read(wxFileOffset offset, unsigned char dst[], unsigned size);
+	bool Has(long block);
+	void Put(long block, const unsigned char data[], unsigned size, unsigned generation);
+
+	unsigned GetGeneration() const { return m_generation; }
+
+private:
+	struct Block {
+		long          index; // block number in the file (the key)
+		unsigned      size;  // valid bytes, less than BLOCK_SIZE at EOF
+		unsigned char *data;
+	};
+
+	typedef std::list<Block> BlockList;
+	typedef std::map<long, BlockList::iterator> BlockIndex;
+
+	wxCriticalSection m_cs;
+	BlockList     m_lru;        // most recently used first
+	BlockIndex    m_index;      // block number -> list entry
+	BlockList     m_free;       // unused blocks
+	unsigned char *m_pool;      // storage for all blocks
+	unsigned      m_capacity;   // max number of blocks
+	unsigned      m_generation; // incremented by Reset()
+};
+
+
+class Prefetcher: public wxThread
+{
+public:
+	Prefetcher(BlockCache& cache);
+
+	bool Start();
+	void Stop();
+
+	bool Open(const wxString& path);
+	void Close();
+
+	void Hint(wxFileOffset offset, long ahead);
+
+protected:
+	virtual void* Entry();
+	void Fetch(wxFileOffset offset, long ahead, unsigned serial);
+
+private:
+	BlockCache&   m_cache;
+	wxFile        m_file;   // own file handle, used by the thread only
+	wxMutex       m_mutex;  // guards the request below, never held over the I/O
+	wxSemaphore   m_hint;   // posted on a new hint or file
+	wxString      m_path;   // file to read, empty - none
+	unsigned      m_pathserial; // incremented by Open() and Close()
+	wxFileOffset  m_offset; // requested position, bytes
+	long          m_ahead;  // bytes to read ahead, negative - backward
+	volatile unsigned m_serial; // incremented by every request, read unlocked
+	bool          m_run;
+	unsigned char *m_buffer;
+};
+
+#endif/*_PREFETCH_H*/
@@ -0,0 +1,396 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     pyramid.cpp
+** License:  GNU
+**
+** Level 0 column i is the spectrum of the frame i*frame..(i+1)*frame-1,
+** zero-padded to the FFT length when the frame is shorter, level k column
+** i covers 2^k such frames. The levels are sized for the
+** whole file but filled on demand: Prepare() computes the missing level 0
+** columns of a range by ComputeFrames() in large parallel batches, the
+** upper columns are max-pooled from their children when first read. The
+** spectra are kept quantized to PYRAMID_DB_STEP, a byte per bin, in
+** chunks of columns allocated on their first write. A zero-padded FFT
+** stores length/frame times more bins than the samples it covers, so the
+** chunks are freed least recently used first beyond PYRAMID_MEMORY and
+** their columns computed again when read.
+******************************************************************************/
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+    #pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <algorithm>
+#include "frametask.h"
+#include "pyramid.h"
+
+const unsigned PYRAMID_BATCH = 1024;  // level 0 columns computed at once
+const float    PYRAMID_DB_MIN = -100.0f;
+const float    PYRAMID_DB_STEP = 0.5f; // quantization of the spectra
+const unsigned PYRAMID_CHUNK_SIZE = 256*1024; // bytes of a chunk of columns
+const size_t   PYRAMID_MEMORY = 64*1024*1024; // bytes of the chunks kept
+
+static unsigned char Quantize(float dB)
+{
+	const int q = int((dB - PYRAMID_DB_MIN)/PYRAMID_DB_STEP + 0.5f);
+
+	return (unsigned char)((q < 0)? 0: (q > 255)? 255: q);
+}
+
+SpectrumPyramid::SpectrumPyramid(): m_convert(NULL), m_bps(0), m_factor(1),
+	m_window(NULL), m_length(0), m_frame(0), m_chunk(1), m_nsamples(0), m_bytes(0),
+	m_clock(0)
+{
+}
+
+SpectrumPyramid::~SpectrumPyramid()
+{
+	Reset();
+}
+
+void SpectrumPyramid::Open(const wxString& path, ConvertFunc convert,
+	unsigned bps, unsigned factor, const FftWindow *window)
+{
+	Reset();
+
+	m_path    = path;
+	m_convert = convert;
+	m_bps     = bps;
+	m_factor  = factor;
+	m_window  = window;
+	m_length  = window->GetLength();
+	m_frame   = window->GetFrame();
+	m_chunk   = std::max(PYRAMID_CHUNK_SIZE/(m_length/2), 1u);
+}
+
+void SpectrumPyramid::Close()
+{
+	Reset();
+	m_bps = 0;
+}
+
+// drop everything, e.g. the FFT window has changed
+void SpectrumPyramid::Reset()
+{
+	for (unsigned k = 0; k < m_levels.size(); k++)
+		for (unsigned c = 0; c < m_levels[k].chunks.size(); c++)
+			delete[] m_levels[k].chunks[c];
+
+	m_levels.clear();
+	m_nsamples = 0;
+	m_bytes = 0;
+}
+
+// drop the columns reaching the samples from end, they were padded with
+// zeros or the file was rewritten there
+void SpectrumPyramid::Truncate(wxFileOffset end)
+{
+	if (end < 0) end = 0;
+
+	const wxFileOffset first = end/m_frame;
+
+	for (unsigned k = 0; k < m_levels.size(); k++)
+	{
+		std::vector<bool>& built = m_levels[k].built;
+		const wxFileOffset col = first >> k;
+
+		if (col < wxFileOffset(built.size()))
+			std::fill(built.begin() + size_t(col), built.end(), false);
+	}
+}
+
+// size the levels for the file of nsamples, the columns already built
+// are kept if the file has grown
+void SpectrumPyramid::Resize(wxFileOffset nsamples)
+{
+	if (nsamples == m_nsamples) return;
+
+	if (nsamples < m_nsamples)
+		Reset();
+	else
+		Truncate(m_nsamples);
+
+	m_nsamples = nsamples;
+
+	unsigned ncols = unsigned((nsamples + m_frame - 1)/m_frame);
+	unsigned k = 0;
+
+	for (;;)
+	{
+		if (k == m_levels.size()) m_levels.push_back(Level());
+
+		Level& level = m_levels[k++];
+		level.chunks.resize((ncols + m_chunk - 1)/m_chunk, NULL);
+		level.used.resize(level.chunks.size(), 0);
+		level.min.resize(ncols);
+		level.max.resize(ncols);
+		level.built.resize(ncols, false);
+
+		if (ncols <= 1) break;
+		ncols = (ncols + 1)/2;
+	}
+}
+
+/*
+** The length/2 values of the column of level k, its chunk is allocated
+** on the first use and becomes the most recently used one. The chunks
+** touched last stay, so the pointer is valid until the levels are
+** resized or a few other chunks are used.
+*/
+unsigned char* SpectrumPyramid::Column(unsigned k, unsigned col)
+{
+	const unsigned length2 = m_length/2;
+	const size_t bytes = size_t(m_chunk)*length2;
+	Level& level = m_levels[k];
+	const unsigned c = col/m_chunk;
+
+	if (!level.chunks[c])
+	{
+		while (m_bytes + bytes > PYRAMID_MEMORY && Evict());
+
+		level.chunks[c] = new unsigned char[bytes];
+		std::fill(level.chunks[c], level.chunks[c] + bytes, 0);
+		m_bytes += bytes;
+	}
+
+	level.used[c] = ++m_clock;
+
+	return level.chunks[c] + size_t(col % m_chunk)*length2;
+}
+
+// free the least recently used chunk, its columns are not built any more
+bool SpectrumPyramid::Evict()
+{
+	unsigned lk = 0, lc = 0, used = 0;
+	bool found = false;
+
+	for (unsigned k = 0; k < m_levels.size(); k++)
+	{
+		const Level& level = m_levels[k];
+
+		for (unsigned c = 0; c < level.chunks.size(); c++)
+			if (level.chunks[c] && (!found || level.used[c] < used)) {
+				lk = k;
+				lc = c;
+				used = level.used[c];
+				found = true;
+			}
+	}
+
+	if (!found) return false;
+
+	Level& level = m_levels[lk];
+	const unsigned first = lc*m_chunk;
+	const unsigned last  = std::min(first + m_chunk, unsigned(level.built.size()));
+
+	delete[] level.chunks[lc];
+	level.chunks[lc] = NULL;
+	m_bytes -= size_t(m_chunk)*(m_length/2);
+
+	std::fill(level.built.begin() + first, level.built.begin() + last, false);
+
+	return true;
+}
+
+// compute level 0 columns first..first+count-1
+bool SpectrumPyramid::Build(unsigned first, unsigned count)
+{
+	const unsigned length2 = m_length/2;
+	const unsigned batch = std::min(count, PYRAMID_BATCH);
+
+	// the window is in the middle of the FFT buffer
+	const unsigned pad = (m_length - m_frame)/2;
+
+	float *samples = new float[size_t(batch)*m_length];
+	float *dB = new float[size_t(batch)*length2];
+	int *res = new int[batch];
+	bool ok = true;
+
+	for (unsigned done = 0; ok && done < count; )
+	{
+		const unsigned n = std::min(batch, count - done);
+
+		ok = ComputeFrames(m_path, m_convert, m_bps, m_factor, *m_window, m_frame,
+			wxFileOffset(first + done)*m_frame - pad, n, samples, dB, res);
+
+		for (unsigned i = 0; ok && i < n; i++)
+		{
+			const unsigned col = first + done + i;
+			const float *s = samples + size_t(i)*m_length + pad;
+			const float *d = dB + size_t(i)*length2;
+			unsigned char *q = Column(0, col);
+			Level& level = m_levels[0];
+
+			for (unsigned j = 0; j < length2; j++) q[j] = Quantize(d[j]);
+
+			level.min[col] = *std::min_element(s, s + m_frame);
+			level.max[col] = *std::max_element(s, s + m_frame);
+			level.built[col] = true;
+		}
+
+		done += n;
+	}
+
+	delete[] samples;
+	delete[] dB;
+	delete[] res;
+
+	return ok;
+}
+
+// max-pool the column from its children
+void SpectrumPyramid::Pool(unsigned k, unsigned col)
+{
+	if (m_levels[k].built[col]) return;
+
+	if (k == 0) {
+		// the whole run of the missing columns of the chunk, in one batch
+		const std::vector<bool>& built = m_levels[0].built;
+		const unsigned end = std::min((col/m_chunk + 1)*m_chunk, unsigned(built.size()));
+		unsigned last = col + 1;
+
+		while (last < end && !built[last]) last++;
+
+		Build(col, last - col);
+		return;
+	}
+
+	const unsigned length2 = m_length/2;
+	const unsigned first = 2*col;
+	const unsigned last  = std::min(2*col + 2, unsigned(m_levels[k-1].built.size()));
+	bool built = true;
+	float min = 0.0f, max = 0.0f;
+	std::vector<unsigned char> q(length2, 0);
+
+	for (unsigned c = first; c < last; c++)
+	{
+		Pool(k-1, c);
+
+		const Level& child = m_levels[k-1];
+		const unsigned char *p = Column(k-1, c);
+
+		for (unsigned j = 0; j < length2; j++) q[j] = std::max(q[j], p[j]);
+
+		min = (c == first)? child.min[c]: std::min(min, child.min[c]);
+		max = (c == first)? child.max[c]: std::max(max, child.max[c]);
+		built = built && child.built[c];
+	}
+
+	Level& level = m_levels[k];
+
+	std::copy(q.begin(), q.end(), Column(k, col));
+	level.min[col] = min;
+	level.max[col] = max;
+	level.built[col] = built;
+}
+
+// the coarsest level with columns not longer than size
+unsigned SpectrumPyramid::LevelOf(wxFileOffset size) const
+{
+	unsigned k = 0;
+
+	while (k+1 < m_levels.size() && (wxFileOffset(m_frame) << (k+1)) <= size) k++;
+
+	return k;
+}
+
+/*
+** Compute the missing level 0 columns of the samples from..to of the
+** file of nsamples, to be read by GetSpectrum()/GetAmplitude().
+** Returns false on error.
+*/
+bool SpectrumPyramid::Prepare(wxFileOffset from, wxFileOffset to, wxFileOffset nsamples)
+{
+	Resize(nsamples);
+
+	if (from < 0) from = 0;
+	if (to > nsamples) to = nsamples;
+	if (from >= to) return true;
+
+	const std::vector<bool>& built = m_levels[0].built;
+	const unsigned last = unsigned((to - 1)/m_frame);
+	bool ok = true;
+
+	for (unsigned col = unsigned(from/m_frame); ok && col <= last; )
+	{
+		if (built[col]) {
+			col++;
+			continue;
+		}
+
+		unsigned end = col + 1;
+		while (end <= last && !built[end]) end++;
+
+		ok = Build(col, end - col);
+		col = end;
+	}
+
+	return ok;
+}
+
+// max-pooled spectrum of the samples from..to, length/2 values
+void SpectrumPyramid::GetSpectrum(wxFileOffset from, wxFileOffset to, float dB[])
+{
+	const unsigned length2 = m_length/2;
+	const unsigned k = LevelOf(to - from);
+
+	if (from < 0) from = 0;
+	if (to > m_nsamples) to = m_nsamples;
+
+	if (from >= to || m_levels.empty()) {
+		std::fill(dB, dB + length2, PYRAMID_DB_MIN);
+		return;
+	}
+
+	const Level& level = m_levels[k];
+	const wxFileOffset size = wxFileOffset(m_frame) << k;
+	const unsigned first = unsigned(from/size);
+	const unsigned last  = std::min(unsigned((to - 1)/size), unsigned(level.built.size() - 1));
+
+	std::vector<unsigned char> q(length2, 0);
+
+	for (unsigned c = first; c <= last; c++)
+	{
+		Pool(k, c);
+
+		const unsigned char *p = Column(k, c);
+		for (unsigned j = 0; j < length2; j++) q[j] = std::max(q[j], p[j]);
+	}
+
+	for (unsigned j = 0; j < length2; j++)
+		dB[j] = PYRAMID_DB_MIN + q[j]*PYRAMID_DB_STEP;
+}
+
+// extrema of the samples from..to, at the resolution of the level
+void SpectrumPyramid::GetAmplitude(wxFileOffset from, wxFileOffset to, float& min, float& max)
+{
+	const unsigned k = LevelOf(to - from);
+
+	min = max = 0.0f;
+
+	if (from < 0) from = 0;
+	if (to > m_nsamples) to = m_nsamples;
+	if (from >= to || m_levels.empty()) return;
+
+	const Level& level = m_levels[k];
+	const wxFileOffset size = wxFileOffset(m_frame) << k;
+	const unsigned first = unsigned(from/size);
+	const unsigned last  = std::min(unsigned((to - 1)/size), unsigned(level.built.size() - 1));
+
+	Pool(k, first);
+	min = level.min[first];
+	max = level.max[first];
+
+	for (unsigned c = first + 1; c <= last; c++)
+	{
+		Pool(k, c);
+		min = std::min(min, level.min[c]);
+		max = std::max(max, level.max[c]);
+	}
+}
@@ -0,0 +1,65 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     pyramid.h
+** License:  GNU
+**
+** Multi-resolution spectrogram of a raw audio file for the views zoomed
+** out beyond the frame size: level 0 holds the spectra of the adjacent
+** frames, every next level the max-pooled pairs of the previous one.
+******************************************************************************/
+#ifndef _PYRAMID_H
+#define _PYRAMID_H
+
+#include <vector>
+#include "welch.h"
+
+class SpectrumPyramid
+{
+public:
+	SpectrumPyramid();
+	~SpectrumPyramid();
+
+	void Open(const wxString& path, ConvertFunc convert, unsigned bps, unsigned factor,
+		const FftWindow *window);
+	void Close();
+	void Reset();
+	void Truncate(wxFileOffset end);
+
+	bool IsOpened() const { return m_bps != 0; }
+
+	bool Prepare(wxFileOffset from, wxFileOffset to, wxFileOffset nsamples);
+	void GetSpectrum(wxFileOffset from, wxFileOffset to, float dB[]);
+	void GetAmplitude(wxFileOffset from, wxFileOffset to, float& min, float& max);
+
+private:
+	struct Level {
+		std::vector<unsigned char*> chunks; // m_chunk columns each, NULL - freed
+		std::vector<unsigned> used;   // last use of the chunks, m_clock
+		std::vector<float> min;       // samples extrema per column
+		std::vector<float> max;
+		std::vector<bool>  built;
+	};
+
+	void Resize(wxFileOffset nsamples);
+	unsigned char* Column(unsigned k, unsigned col);
+	bool Evict();
+	bool Build(unsigned first, unsigned count);
+	void Pool(unsigned level, unsigned col);
+	unsigned LevelOf(wxFileOffset size) const;
+
+	wxString     m_path;
+	ConvertFunc  m_convert;
+	unsigned     m_bps;     // bytes per sample, 0 - not opened
+	unsigned     m_factor;  // decimation of the samples
+	const FftWindow *m_window; // cached by the engine
+	unsigned     m_length;  // FFT size
+	unsigned     m_frame;   // window length, samples per level 0 column
+	unsigned     m_chunk;   // columns per chunk
+	wxFileOffset m_nsamples; // file length the levels are sized for
+	size_t       m_bytes;   // of the allocated chunks
+	unsigned     m_clock;   // last use stamp of the chunks
+	std::vector<Level> m_levels;
+};
+
+#endif/*_PYRAMID_H*/
@@ -0,0 +1,88 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     ringbuffer.cpp
+** License:  GNU
+**
+** The head and tail are free running counters, their difference is the
+** amount of data. Every side changes only its own counter, after the
+** data is copied; the barrier keeps the copy and the counter update in
+** this order, so no locks are needed and the writer never waits.
+******************************************************************************/
+#include <string.h>
+#include "ringbuffer.h"
+
+RingBuffer::RingBuffer(): m_data(NULL), m_size(0), m_head(0), m_tail(0)
+{
+}
+
+RingBuffer::~RingBuffer()
+{
+	delete[] m_data;
+}
+
+// size is rounded up to a power of 2
+bool RingBuffer::Init(unsigned size)
+{
+	unsigned n = 1;
+	while (n < size) n <<= 1;
+
+	delete[] m_data;
+	m_data = new char[n];
+	m_size = n;
+	m_head = m_tail = 0;
+
+	return true;
+}
+
+// not thread safe, both sides must be stopped
+void RingBuffer::Reset()
+{
+	m_head = m_tail = 0;
+}
+
+// puts all the n bytes or nothing
+bool RingBuffer::Put(const void* src, unsigned n)
+{
+	if (GetFree() < n) return false;
+
+	const unsigned at    = m_head & (m_size-1);
+	const unsigned first = (n < m_size - at)? n: m_size - at;
+
+	memcpy(m_data + at, src, first);
+	memcpy(m_data, (const char*)src + first, n - first);
+
+	RING_BARRIER();
+	m_head += n;
+
+	return true;
+}
+
+// gets all the n bytes or nothing
+bool RingBuffer::Get(void* dst, unsigned n)
+{
+	if (GetCount() < n) return false;
+
+	Read(dst, n);
+	return true;
+}
+
+// gets up to max bytes, returns their number
+unsigned RingBuffer::Read(void* dst, unsigned max)
+{
+	unsigned n = GetCount();
+	if (n > max) n = max;
+
+	RING_BARRIER();
+
+	const unsigned at    = m_tail & (m_size-1);
+	const unsigned first = (n < m_size - at)? n: m_size - at;
+
+	memcpy(dst, m_data + at, first);
+	memcpy((char*)dst + first, m_data, n - first);
+
+	RING_BARRIER();
+	m_tail += n;
+
+	return n;
+}
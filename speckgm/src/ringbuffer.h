@@ -0,0 +1,44 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     ringbuffer.h
+** License:  GNU
+**
+** Lock-free byte ring for one writer thread and one reader thread.
+******************************************************************************/
+#ifndef _RINGBUFFER_H
+#define _RINGBUFFER_H
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+	#define RING_BARRIER() _ReadWriteBarrier()
+#else
+	#define RING_BARRIER() __sync_synchronize()
+#endif
+
+class RingBuffer
+{
+public:
+	RingBuffer();
+	~RingBuffer();
+
+	bool Init(unsigned size);
+	void Reset();
+
+	// writer side
+	bool Put(const void* src, unsigned n);
+	unsigned GetFree() const { return m_size - (m_head - m_tail); }
+
+	// reader side
+	bool Get(void* dst, unsigned n);
+	unsigned Read(void* dst, unsigned max);
+	unsigned GetCount() const { return m_head - m_tail; }
+
+private:
+	char     *m_data;
+	unsigned m_size;  // power of 2
+	volatile unsigned m_head; // bytes written, changed by the writer only
+	volatile unsigned m_tail; // bytes read, changed by the reader only
+};
+
+#endif/*_RINGBUFFER_H*/
@@ -0,0 +1,87 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     samplewindow.cpp
+** License:  GNU
+**
+** The window is a circular buffer of m_length samples kept twice in a row:
+** data[i] == data[i+m_length]. Whatever the head position is, the window
+** samples are data[head]..data[head+m_length-1] without wrapping.
+******************************************************************************/
+#include <string.h>
+#include "samplewindow.h"
+
+SampleWindow::SampleWindow(): m_data(NULL), m_length(0), m_head(0),
+	m_pos(0), m_end(-1), m_valid(false)
+{
+}
+
+SampleWindow::~SampleWindow()
+{
+	if (m_data) delete[] m_data;
+}
+
+bool SampleWindow::Init(unsigned length)
+{
+	if (m_data) {
+		delete[] m_data;
+		m_data = NULL;
+	}
+
+	m_length = length;
+	m_data = new float[2*m_length];
+
+	Reset();
+
+	return m_data != NULL;
+}
+
+void SampleWindow::Reset()
+{
+	m_head  = 0;
+	m_pos   = 0;
+	m_end   = -1;
+	m_valid = false;
+}
+
+// fill the whole window, src[] - m_length samples from pos
+void SampleWindow::Load(wxFileOffset pos, const float src[])
+{
+	memcpy(m_data, src, m_length*sizeof(float));
+	memcpy(m_data + m_length, src, m_length*sizeof(float));
+
+	m_head  = 0;
+	m_pos   = pos;
+	m_valid = true;
+}
+
+// move forward by n, src[] - n samples following the window
+void SampleWindow::Push(const float src[], unsigned n)
+{
+	for (unsigned i = 0; i < n; i++) {
+		m_data[m_head] = m_data[m_head + m_length] = src[i];
+		if (++m_head == m_length) m_head = 0;
+	}
+	m_pos += n;
+}
+
+// move backward by n, src[] - n samples preceding the window
+void SampleWindow::PushFront(const float src[], unsigned n)
+{
+	for (unsigned i = n; i-- > 0; ) {
+		m_head = (m_head? m_head: m_length) - 1;
+		m_data[m_head] = m_data[m_head + m_length] = src[i];
+	}
+	m_pos -= n;
+}
+
+// number of the window samples that are really in the file
+unsigned SampleWindow::GetValid() const
+{
+	wxFileOffset first = (m_pos < 0)? 0: m_pos;
+	wxFileOffset last  = m_pos + m_length;
+
+	if (m_end >= 0 && last > m_end) last = m_end;
+
+	return (last > first)? unsigned(last - first): 0;
+}
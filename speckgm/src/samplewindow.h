@@ -0,0 +1,45 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     samplewindow.h
+** License:  GNU
+**
+** Sliding window over the converted samples. Moving the window by a hop
+** needs only the hop's new samples, the window is still available as one
+** contiguous array for the FFT.
+******************************************************************************/
+#ifndef _SAMPLEWINDOW_H
+#define _SAMPLEWINDOW_H
+
+#include <wx/filefn.h>
+
+class SampleWindow
+{
+public:
+	SampleWindow();
+	~SampleWindow();
+
+	bool Init(unsigned length);
+	void Reset();
+
+	void Load(wxFileOffset pos, const float src[]);
+	void Push(const float src[], unsigned n);
+	void PushFront(const float src[], unsigned n);
+
+	bool  IsValid() const { return m_valid; }
+	wxFileOffset GetPos() const { return m_pos; }
+	float* GetData() const { return m_data + m_head; }
+	unsigned GetValid() const;
+
+	void SetEnd(wxFileOffset end) { m_end = end; }
+
+private:
+	float    *m_data;  // 2*m_length, every sample is stored twice
+	unsigned m_length; // window length, FFT size
+	unsigned m_head;   // index of the oldest sample
+	wxFileOffset m_pos; // file position of the oldest sample
+	wxFileOffset m_end; // end of file position, -1 - not known
+	bool     m_valid;
+};
+
+#endif/*_SAMPLEWINDOW_H*/
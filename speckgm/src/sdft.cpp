@@ -0,0 +1,194 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     sdft.cpp
+** License:  GNU
+**
+** For the frame x[p]..x[p+N-1] and X[k] = sum x[p+m]*exp(-j*2*pi*k*m/N)
+** moving the frame by one sample forward is
+**     X'[k] = (X[k] - x[p] + x[p+N]) * exp(j*2*pi*k/N)
+** and backward
+**     X'[k] = X[k] * exp(-j*2*pi*k/N) + x[p-1] - x[p+N-1]
+** i.e. O(N) per sample for all the bins. The rounding errors accumulate
+** so the spectrum is recomputed by FFT after every m_resync samples.
+******************************************************************************/
+#include <stdlib.h>
+#include <math.h>
+#include "fft.h"
+#include "sdft.h"
+
+#define PI2 6.283185307179586476925286766559
+
+SlidingDft::SlidingDft(): m_size(0), m_resync(0), m_slid(0), m_pos(0),
+	m_valid(false), m_re(NULL), m_im(NULL), m_cos(NULL), m_sin(NULL),
+	m_rex(NULL), m_imx(NULL), m_plan(NULL), m_scratch(NULL)
+{
+}
+
+SlidingDft::~SlidingDft()
+{
+	delete[] m_re;
+	delete[] m_im;
+	delete[] m_cos;
+	delete[] m_sin;
+	delete[] m_rex;
+	delete[] m_imx;
+	delete[] m_scratch;
+	dsp_plan_free(m_plan);
+}
+
+/*
+** size   - DFT size, even;
+** resync - number of slid samples after which IsValid() returns false.
+*/
+bool SlidingDft::Init(unsigned size, unsigned resync)
+{
+	delete[] m_re;
+	delete[] m_im;
+	delete[] m_cos;
+	delete[] m_sin;
+	delete[] m_rex;
+	delete[] m_imx;
+	delete[] m_scratch;
+	dsp_plan_free(m_plan);
+
+	m_size   = size;
+	m_resync = resync;
+	m_valid  = false;
+
+	const unsigned bins = m_size/2 + 1;
+
+	m_re  = new double[bins];
+	m_im  = new double[bins];
+	m_cos = new double[bins];
+	m_sin = new double[bins];
+	m_rex = new float[m_size+2];
+	m_imx = new float[m_size+2];
+	m_plan = dsp_plan_create<float>(m_size);
+	m_scratch = new float[dsp_plan_scratch(m_plan) + 1];
+
+	for (unsigned k = 0; k < bins; k++) {
+		m_cos[k] = cos(PI2*k/m_size);
+		m_sin[k] = sin(PI2*k/m_size);
+	}
+
+	return m_re && m_im && m_cos && m_sin && m_rex && m_imx && m_scratch;
+}
+
+// the windows which can be applied by frequency-domain convolution
+bool SlidingDft::IsSupported(int window)
+{
+	double a[5];
+
+	return dsp_window_cosines(window, a) > 0;
+}
+
+// exact spectrum of frame[] at the position pos
+void SlidingDft::Load(wxFileOffset pos, const float frame[])
+{
+	for (unsigned i = 0; i < m_size; i++) m_rex[i] = frame[i];
+
+	dsp_realfft(m_plan, m_rex, m_imx, 1, m_scratch);
+
+	for (unsigned k = 0; k <= m_size/2; k++) {
+		m_re[k] = m_rex[k];
+		m_im[k] = m_imx[k];
+	}
+
+	m_pos   = pos;
+	m_slid  = 0;
+	m_valid = true;
+}
+
+/*
+** Move the frame by n samples, n > 0 - forward, n < 0 - backward.
+** frame[] - the current frame samples (before moving);
+** src[]   - |n| new samples: following the frame if moving forward,
+**           preceding it if moving backward.
+*/
+void SlidingDft::Slide(const float frame[], const float src[], int n)
+{
+	const unsigned bins = m_size/2 + 1;
+
+	if (n > 0) {
+		for (unsigned k = 0; k < bins; k++) {
+			const double c = m_cos[k], s = m_sin[k];
+			double re = m_re[k], im = m_im[k];
+
+			for (int i = 0; i < n; i++) {
+				const double d = re - frame[i] + src[i];
+				re = d*c - im*s;
+				im = d*s + im*c;
+			}
+			m_re[k] = re;
+			m_im[k] = im;
+		}
+	}
+	else if (n < 0) {
+		const unsigned m = -n;
+
+		for (unsigned k = 0; k < bins; k++) {
+			const double c = m_cos[k], s = m_sin[k];
+			double re = m_re[k], im = m_im[k];
+
+			for (unsigned i = m; i-- > 0; ) {
+				const double t = re*c + im*s;
+				im = im*c - re*s;
+				re = t + src[i] - frame[m_size-m+i];
+			}
+			m_re[k] = re;
+			m_im[k] = im;
+		}
+	}
+
+	m_pos  += n;
+	m_slid += (n < 0)? -n: n;
+}
+
+// bin k of the full spectrum, using X[-k] = X[N-k] = conj(X[k])
+void SlidingDft::Bin(int k, double& re, double& im) const
+{
+	const int size = int(m_size);
+
+	if (k < 0) k += size;
+	if (k > size/2) {
+		re =  m_re[size-k];
+		im = -m_im[size-k];
+	} else {
+		re =  m_re[k];
+		im =  m_im[k];
+	}
+}
+
+/*
+** Magnitudes of bins 0..N/2-1 of the windowed frame into mag[].
+** The cosine-sum window w[m] = a0 - a1*cos(2*pi*m/N) + a2*cos(4*pi*m/N)
+** - ... in the frequency domain is Y[k] = a0*X[k] - a1/2*(X[k-1] + X[k+1])
+** + a2/2*(X[k-2] + X[k+2]) - ..., up to the 4 neighbours of the flat-top.
+*/
+void SlidingDft::Magnitude(float mag[], int window) const
+{
+	double a[5];
+	const int count = dsp_window_cosines(window, a);
+
+	for (int k = 0; k < int(m_size/2); k++)
+	{
+		double re, im, r1, i1, r2, i2;
+
+		Bin(k, re, im);
+		re *= a[0];
+		im *= a[0];
+
+		for (int m = 1; m < count; m++)
+		{
+			const double c = (m & 1)? -0.5*a[m]: 0.5*a[m];
+
+			Bin(k-m, r1, i1);
+			Bin(k+m, r2, i2);
+			re += c*(r1 + r2);
+			im += c*(i1 + i2);
+		}
+
+		mag[k] = (float)sqrt(re*re + im*im);
+	}
+}
@@ -0,0 +1,54 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     sdft.h
+** License:  GNU
+**
+** Sliding DFT: recursive update of the spectrum when the frame moves by
+** a few samples. Cosine-sum windows (Hanning, Hamming, Blackman,
+** Blackman-Harris, flat-top) are applied in the frequency domain by
+** convolution.
+******************************************************************************/
+#ifndef _SDFT_H
+#define _SDFT_H
+
+#include <wx/filefn.h>
+#include "fft.h"
+
+class SlidingDft
+{
+public:
+	SlidingDft();
+	~SlidingDft();
+
+	bool Init(unsigned size, unsigned resync);
+	void Reset() { m_valid = false; }
+
+	static bool IsSupported(int window);
+
+	void Load(wxFileOffset pos, const float frame[]);
+	void Slide(const float frame[], const float src[], int n);
+	void Magnitude(float mag[], int window) const;
+
+	bool IsValid() const { return m_valid && m_slid < m_resync; }
+	wxFileOffset GetPos() const { return m_pos; }
+
+private:
+	void Bin(int k, double& re, double& im) const;
+
+	unsigned m_size;   // DFT size
+	unsigned m_resync; // samples to slide before the next exact Load()
+	unsigned m_slid;   // samples slid since the last Load()
+	wxFileOffset m_pos; // frame position
+	bool     m_valid;
+	double   *m_re;    // bins 0..size/2
+	double   *m_im;
+	double   *m_cos;   // twiddles cos(2*pi*k/size), k = 0..size/2
+	double   *m_sin;
+	float    *m_rex;   // dsp_realfft() buffers
+	float    *m_imx;
+	dsp_plan<float> *m_plan; // of the Load() FFT
+	float    *m_scratch;
+};
+
+#endif/*_SDFT_H*/
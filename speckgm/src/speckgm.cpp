@@ -33,11 +33,50 @@
 #endif
 
 #include <wx/file.h>
+#include <wx/cmdline.h>
 #include <algorithm>
 #include "fft.h"
+#include "engine.h"
+#include "columntask.h"
+#include "filterbank.h"
+#include "mfcc.h"
+#include "pitch.h"
+#include "npyfile.h"
+#include "tileimage.h"
+#include "capture.h"
+#include "filewatch.h"
 
 const unsigned int ORDER = 9; // 1 << 9 == 512
 const unsigned int SAMPLE_RATE = 8000;
+const unsigned int PREFETCH_TIME = 500;     // ms of scrolling to read ahead
+const float LOG_FREQ_MIN = 50.0f;           // lowest frequency of the log scale, Hz
+const unsigned int MEL_BANDS = 26;          // mel filter bank size for the export
+const unsigned int MFCC_COEFS = 13;         // number of exported MFCC
+const unsigned int DB_LEVELS = 8;           // colors of the spectrogram
+const unsigned int DELTA_LEVELS = 9;        // colors of the difference of two inputs
+const float DELTA_FLOOR = -45.0f;           // both inputs quieter - no difference, dB
+const unsigned int CAPTURE_TIMER = 40;      // ms between the live view updates
+const unsigned int FOLLOW_TIMER = 100;      // ms between the checks of a followed file
+const unsigned int INDEX_TIMER = 200;       // ms between the checks of the speech index pass
+const unsigned int STREAM_HISTORY = 64 << 20; // bytes of stdin/pipe input kept
+const unsigned int OVERVIEW_RANGE = 1 << 20; // units of the overview scrollbar at most
+const unsigned int JUMP_SCROLL = 10;       // read-steps of a jump done by scrolling
+const unsigned int MIN_READ_STEP = 8;       // zoom limits, samples per view column
+const unsigned int MAX_READ_STEP = 1 << 20;
+const unsigned int MULTITAPER = DPSS + 1;   // the window choice after the windows
+const unsigned int MULTITAPER_TAPERS = 5;   // DPSS tapers averaged, 2*NW - 1
+const float PITCH_FMIN = 60.0f;             // F0 range of the pitch contour, Hz
+const float PITCH_FMAX = 400.0f;
+const unsigned int VAD_BLOCK = SAMPLE_RATE/100; // samples per block of the speech index
+const unsigned int SPEECH_LEAD = 8;         // a found segment starts 1/8 into the view
+#ifdef HAVE_ALSA
+const wxChar CAPTURE_DEVICE[] = _T("default");
+#else
+const wxChar CAPTURE_DEVICE[] = _T("-");    // the standard input
+#endif
+
+extern const wxColour dBtoColor[];
+unsigned MapLevel(float dB);
 
 // ----------------------------------------------------------------------------
 // private classes
@@ -195,7 +234,8 @@ class AmplitudeView : public BaseView
 		eLevelScaleWidth = 40,
 		ePitchWidth      = 10,
 		eEmptyScaleWidth = 50,
-		eTimeScaleHeight = 25
+		eTimeScaleHeight = 25,
+		eSpeechHeight    = 3
 	};
 
 	const static int Amplitude2Db[7][2];
@@ -207,6 +247,8 @@ public:
 	void Clear();
 	void DrawScale();
 	void Draw(float pBuffer[], int size, int step, bool forward);
+	void DrawColumn(const float min[2], const float max[2], int step, bool forward,
+		bool speech = false);
 	void RePaint();
 	const wxRect& GetWorkRect() const { return m_rect; }
 	inline int GetWorkWidth() const	{ return m_rect.width; }
@@ -214,19 +256,27 @@ public:
 	inline void SetCursor(int x, int y)
 		{ m_cursor.x = eLevelScaleWidth+x, m_cursor.y = y; }
 
-	inline void SetTime( int time ) { m_Time = time; }
+	// selected range, x1 < 0 - no selection
+	inline void SetSelection(int x1, int x2)
+		{ m_sel_x1 = (x1 < 0)? -1: eLevelScaleWidth+x1, m_sel_x2 = eLevelScaleWidth+x2; }
+
+	inline void SetTime( wxFileOffset time ) { m_Time = time; }
 
 protected:
 	void DoScroll(int dx);
+	void DrawCursor(wxDC& DC);
 	void OnPaint(wxPaintEvent& event);
 	void OnLButtonDown(wxMouseEvent& event);
 	void OnSize(wxSizeEvent& event);
 
 private:
-	int		m_Time;   // data for time span
+	wxFileOffset m_Time; // data for time span
 	int     m_sample_rate;
 	wxPoint m_cursor; // cursor position
+	int     m_sel_x1; // selection edges
+	int     m_sel_x2;
 	wxRect  m_rect;   // work rectangle
+	wxColour m_speech_color; // speech marks on the time scale
 
 	DECLARE_EVENT_TABLE()
 };
@@ -246,6 +296,9 @@ class SpectrumView : public BaseView
 	const int LEVL_SCALE_WIDTH;
 
 public:
+	// two inputs: one above the other or the dB difference of the first
+	enum { COMPARE_OFF, COMPARE_SIDE, COMPARE_DIFF };
+
 	SpectrumView(wxWindow* pParentWnd);
 	~SpectrumView();
 
@@ -254,13 +307,26 @@ public:
 	void Clear();
 	void Draw0(float* dB, int size, bool forward);
 	void Draw(float* dB, int size, bool forward);
+	void Draw(float* dB, float* dB2, int size, bool forward);
+	void DrawPitch(float f0, bool forward);
 	void DrawScale(int rate, int points);
 	void DrawScale() { DrawScale(m_sample_rate, m_length); }
 	const wxRect& GetWorkRect() const { return m_rect; }
+	void SetFreqScale(int scale) { m_scale = scale; }
+	void SetCompare(int mode) { m_compare = mode; }
+	int  GetCompare() const { return m_compare; }
 
 protected:
 	void DoScroll(int dx);
 	void OnSize(wxSizeEvent& event);
+	int  GetRows() const;
+	bool PrepareRows();
+	bool PrepareBank();
+	void MapRows(const float* dB, float rows[]);
+	void DrawRows(const float rows[], int bottom, int x, bool delta);
+	void DrawFreqScale(int bottom);
+	void DrawBandScale(int bottom);
+	void DrawDeltaScale();
 
 private:
 	wxRect   m_rect;
@@ -268,6 +334,14 @@ private:
 	int      m_sample_rate;
 	int      m_num_pitch;
 	wxString *m_strings;
+	int      m_scale;    // frequency axis: FilterBank::LINEAR, LOG or MEL
+	int      m_compare;  // COMPARE_OFF, COMPARE_SIDE or COMPARE_DIFF
+	FilterBank m_bank;   // FFT bins to screen rows for the log/mel axis
+	float    *m_rows;    // values of the rows of a column, twice for two inputs
+	int      m_nrows;    // ... allocated
+	int      m_f0_y;     // pitch contour row of the last column, -1 - none
+	bool     m_f0_fwd;   // ... drawn scrolling forward
+	wxPen    m_f0_pen;   // pitch contour pen, not in the dB colors
 
 	DECLARE_EVENT_TABLE()
 };
@@ -359,7 +433,6 @@ bool wxQueue::Put(void* ptr)
 // Define a new frame type: this is going to be our main frame
 class DxViewFrame : public wxFrame, wxThread
 {
-	enum { Unsigned8bit, Signed16bit, Signed16bitBigEndian, Float32bit };
 	struct dxEvent {
 		int scroll;
 	};
@@ -367,6 +440,22 @@ class DxViewFrame : public wxFrame, wxThread
 public:
     DxViewFrame(const wxString& title);
 
+	bool OpenFile(const wxString& path, int format, unsigned rate = 0);
+	bool OpenCompare(const wxString& path, int format);
+	void SetCompare(int mode);
+	void CloseCompare();
+	bool ExportFeatures(const wxString& path, bool mfcc);
+	bool ExportMatrix(const wxString& path, int format, wxFileOffset from = 0, wxFileOffset to = -1);
+	bool ExportImage(const wxString& path, int format);
+	void JumpTo(wxFileOffset pos);
+	bool SetLength(unsigned length, unsigned frame);
+	void SetCaptureDevice(const wxString& device) { m_device = device; }
+	void SetInputRate(unsigned rate) { m_input_rate = rate; }
+	void SetSpeechOnly(bool only);
+	void WaitForInput();
+	bool StartCapture();
+	void StopCapture();
+
 protected:
     // event handlers (these functions should _not_ be virtual)
     void OnQuit(wxCommandEvent& event);
@@ -375,14 +464,37 @@ protected:
     void OnTest(wxCommandEvent& event);
     void OnScroll(wxCommandEvent& event);
 	void OnSetFFTwin(wxCommandEvent& event);
+	void OnSetFFTsize(wxCommandEvent& event);
+	void OnSlidingDft(wxCommandEvent& event);
+	void OnFreqScale(wxCommandEvent& event);
+	void OnReassigned(wxCommandEvent& event);
+	void OnPitch(wxCommandEvent& event);
+	void OnSpeechOnly(wxCommandEvent& event);
+	void OnOpenCompare(wxCommandEvent& event);
+	void OnCompare(wxCommandEvent& event);
+	void OnExport(wxCommandEvent& event);
+	void OnExportMatrix(wxCommandEvent& event);
+	void OnExportImage(wxCommandEvent& event);
+	void OnClose(wxCloseEvent& event);
 	void OnOpen(wxCommandEvent& event);
-	void OnStart(wxCommandEvent& WXUNUSED(event)) {};
+	void OnStart(wxCommandEvent& event);
+	void OnLiveTimer(wxTimerEvent& event);
+	void OnFollow(wxCommandEvent& event);
+	void OnFollowTimer(wxTimerEvent& event);
+	void OnIndexTimer(wxTimerEvent& event);
 	void OnNext(wxCommandEvent& event);
 	void OnNext2(wxCommandEvent& event);
 	void OnPrev(wxCommandEvent& event);
 	void OnPrev2(wxCommandEvent& event);
+	void OnNextSpeech(wxCommandEvent& event);
+	void OnPrevSpeech(wxCommandEvent& event);
+	void OnUpdateSpeech(wxUpdateUIEvent& event);
+	void OnOverview(wxScrollEvent& event);
+	void OnGoTo(wxCommandEvent& event);
+	void OnGoToMenu(wxCommandEvent& event);
 	void OnBtZoomIn(wxCommandEvent& event);
 	void OnBtZoomOut(wxCommandEvent& event);
+	void OnScale(wxCommandEvent& event);
 	void OnLButtonDown(wxMouseEvent& event);
 	void OnSize(wxSizeEvent& event);
 	void OnUpdateUI(wxUpdateUIEvent& evnet);
@@ -393,26 +505,32 @@ protected:
 	virtual long OnDxSeek(long pos, int flag) { return 0; };
 
 	void RedrawAll();
+	void IndexSpeech();
+	bool TakeIndex(bool wait);
 	void DxScroll(int scroll);
-
-	static void ConvertU8(float *dst, unsigned char *src, unsigned size);
-	static void ConvertS16(float *dst, unsigned char *src, unsigned size);
-	static void ConvertS16BE(float *dst, unsigned char *src, unsigned size);
-	static void ConvertF32(float *dst, unsigned char *src, unsigned size);
-
-	void SetFileFormat(int format);
-	int ReadAndFft(int position);
-	void FFT();
+	void SetReadStep(unsigned rd_size);
+	bool IsPooled() const { return m_engine.IsPooled(m_rd_size); }
+	bool IsSpeech(wxFileOffset pos) { return m_engine.IsSpeech(pos - m_rd_size/2, pos + m_rd_size/2); }
+	bool IsSkipped(wxFileOffset pos) { return m_speech_only && m_engine.IsIndexed() && !IsSpeech(pos); }
+	unsigned CountExported(wxFileOffset from, wxFileOffset to);
+	bool IsComparing() const { return spectrumView->GetCompare() != SpectrumView::COMPARE_OFF; }
+	void CacheView();
+	void UpdateOverview();
+	void ShowWelch(int x1, int x2);
+
+	void ClearSelection();
+
+	int ReadColumn(wxFileOffset pos);
+	void DrawColumn(bool forward);
+	void DrawColumnPitch(bool forward);
+	void Prefetch(bool forward, unsigned nsteps);
 
 	virtual void* Entry(); // second thread
 
-	inline void ENTER_FILE_CS() { m_hFileCS.Enter(); }
-	inline void EXIT_FILE_CS()  { m_hFileCS.Leave(); }
-
-	// samples conversion callback, size - src[] size in bytes
-	void            (*cbConvertSamples) (float dst[], unsigned char src[], unsigned size);
 	wxButton        *startButton;
 	wxTextCtrl      *ShowScale;
+	wxTextCtrl      *GoToTime;
+	wxScrollBar     *overviewBar;
 	wxTextCtrl      *ShowTime;
 	wxTextCtrl      *ShowAmplitude;
 	wxTextCtrl      *ShowSpecAmp;
@@ -421,6 +539,7 @@ protected:
 	wxTextCtrl      *ShowMaxSpecAmp;
 	wxChoice        *setFFTwindow;
 	wxChoice        *setFFTsize;
+	wxChoice        *setFrame;
 	wxFlexGridSizer *Sizer;
 
 	SpectrumView    *spectrumView;
@@ -428,29 +547,46 @@ protected:
 	AmplitudeView   *ampView;
 	WaveView        *waveView;
 
-	wxFile          m_file;
-	wxCriticalSection m_hFileCS;
+	AnalysisEngine  m_engine; // the opened input and its analysis
+	AnalysisEngine  *m_engine_b; // the input compared with it, same positions, NULL - none
+	ColumnTask      *m_compare_task; // reads the m_engine_b columns meanwhile
+	LiveCapture     m_capture;
+	wxTimer         m_live_timer; // moves the captured columns to the views
+	wxString        m_device;     // capture device
+	unsigned        m_input_rate; // sample rate of the opened files, decimated to SAMPLE_RATE
+	FileWatch       m_watch;      // the followed file
+	wxTimer         m_follow_timer;
+	wxTimer         m_index_timer; // takes the speech index when its pass is done
+	wxFileOffset    m_follow_end; // file length known to the caches, samples
 	wxQueue	        m_hHaveData;
 
 	bool	IsStart;
 	bool	m_run;  // to run thread
 
-	unsigned char *m_buffer;
-
-	float	*m_fwindow;  // FFT window coefs
-	float	*m_fbuffer;  // normalized samples
-	float	*m_fbuffer1; // FFT real buffer
-	float	*m_fbuffer2; // FFT imaginary buffer
+	float	*m_samples;  // samples of the frame under the cursor or captured
 	float	*m_fdB;      // amplitude/frequency
+	float	*m_fdB_b;    // ... of the compared input
+
+	MelFeatures m_mel;   // mel energies/MFCC for the export
+	PitchTracker m_pitch; // F0 of the drawn columns
+	bool     m_show_pitch; // draw the pitch contour
+	int      m_pitch_dir; // direction of the last tracked column, 0 - none
+	bool     m_speech_only; // the exports leave out the silence
+	float    m_col_min[2]; // extrema of the halves of the last read column
+	float    m_col_max[2];
+
+	wxStopWatch m_scroll_watch;
+	long     m_scroll_time; // time of the last scroll, ms
+	float    m_scroll_rate; // scrolling speed, bytes per ms
+	bool     m_scroll_fwd;  // last scroll direction
 
-	unsigned m_BiPS;    // bits per sample
-	unsigned m_ByPS;    // bytes per sample
-	unsigned m_buf_size;
-	unsigned m_order;   // FFT order
 	unsigned m_length;  // FFT size
 	unsigned m_rd_size; // read-step size
+	unsigned m_overview_unit; // samples per overviewBar unit
 
-	int		m_FilePosition;
+	wxFileOffset m_FilePosition;
+	wxFileOffset m_sel_from; // selected range in samples,
+	wxFileOffset m_sel_to;   // m_sel_to <= m_sel_from - no selection
 	int		m_ampl_x;
 	int     m_afc_freq;
 	//int		m_spec_x;
@@ -466,6 +602,8 @@ protected:
 class DxViewApp : public wxApp
 {
 public:
+    DxViewApp(): m_format(1), m_fft(0), m_frame(0), m_rate(SAMPLE_RATE), m_mel(false), m_mfcc(false), m_npy(false), m_image(false), m_speech(false), m_diff(false), m_status(-1) {}
+
     // override base class virtuals
     // ----------------------------
 
@@ -473,6 +611,26 @@ public:
     // initialization (doing it here and not in the ctor allows to have an error
     // return: if OnInit() returns false, the application terminates)
     virtual bool OnInit();
+    virtual int  OnRun();
+    virtual void OnInitCmdLine(wxCmdLineParser& parser);
+    virtual bool OnCmdLineParsed(wxCmdLineParser& parser);
+
+private:
+	wxString m_input;  // file to open
+	wxString m_output; // output file for the headless export
+	wxString m_device; // capture device to start with
+	wxString m_compare; // file to compare with the input
+	int      m_format; // raw file format, as in the Open dialog
+	long     m_fft;    // FFT size, 0 - the default
+	long     m_frame;  // window length, 0 - the FFT size
+	long     m_rate;   // sample rate of the input file
+	bool     m_mel;    // export mel energies
+	bool     m_mfcc;   // export MFCC
+	bool     m_npy;    // export the spectrogram matrix
+	bool     m_image;  // export the spectrogram image
+	bool     m_speech; // export the speech segments only
+	bool     m_diff;   // show the difference of the compared files
+	int      m_status; // exit code of the headless export, -1 - none
 };
 
 IMPLEMENT_APP(DxViewApp)
@@ -488,16 +646,165 @@ bool DxViewApp::OnInit()
     // create the main application window
     DxViewFrame *frame = new DxViewFrame(_T("Spectrogram Viewer"));
 
+    if ( (m_fft || m_frame) && !frame->SetLength(unsigned(m_fft), unsigned(m_frame)) )
+        wxLogError(_T("Cannot set the FFT size %ld and the frame %ld"), m_fft, m_frame);
+
+    frame->SetInputRate(unsigned(m_rate));
+
+    if ( !m_input.IsEmpty() && !frame->OpenFile(m_input, m_format) ) {
+        wxLogError(_T("Cannot open the file %s"), m_input.c_str());
+        m_output = wxEmptyString;
+    }
+
+    frame->SetSpeechOnly(m_speech);
+
+    // headless export: do not show the window, exit when done
+    if ( m_mel || m_mfcc || m_npy || m_image )
+        frame->WaitForInput();
+
+    // an empty m_output - the input was not opened, nothing is exported
+    if ( m_mel || m_mfcc ) {
+        m_status = 1;
+        if ( !m_output.IsEmpty() && !frame->ExportFeatures(m_output, m_mfcc) )
+            wxLogError(_T("Cannot export the features to %s"), m_output.c_str());
+        else if ( !m_output.IsEmpty() )
+            m_status = 0;
+    }
+    else if ( m_npy ) {
+        // .npy or raw float32 with a JSON sidecar for any other extension
+        const int format = m_output.Lower().EndsWith(_T(".npy"))?
+            MatrixWriter::NPY: MatrixWriter::RAW;
+        m_status = 1;
+        if ( !m_output.IsEmpty() && !frame->ExportMatrix(m_output, format) )
+            wxLogError(_T("Cannot export the spectrogram to %s"), m_output.c_str());
+        else if ( !m_output.IsEmpty() )
+            m_status = 0;
+    }
+    else if ( m_image ) {
+        // a .ppm file or a directory of PNG tiles
+        const int format = m_output.Lower().EndsWith(_T(".ppm"))?
+            TileWriter::PPM: TileWriter::PNG;
+        m_status = 1;
+        if ( !m_output.IsEmpty() && !frame->ExportImage(m_output, format) )
+            wxLogError(_T("Cannot export the image to %s"), m_output.c_str());
+        else if ( !m_output.IsEmpty() )
+            m_status = 0;
+    }
+
+    // returning false would make wxEntry() exit with -1 even on success,
+    // OnRun() returns m_status instead of entering the main loop
+    if ( m_status >= 0 ) {
+        frame->Close(true);
+        ExitMainLoop();
+        return true;
+    }
+
+    if ( !m_compare.IsEmpty() ) {
+        if ( !frame->OpenCompare(m_compare, m_format) )
+            wxLogError(_T("Cannot open the file %s for comparison"), m_compare.c_str());
+        else if ( m_diff )
+            frame->SetCompare(SpectrumView::COMPARE_DIFF);
+    }
+
     // and show it (the frames, unlike simple controls, are not shown when
     // created initially)
     frame->Show(true);
 
+    if ( !m_device.IsEmpty() ) {
+        frame->SetCaptureDevice(m_device);
+        frame->StartCapture();
+    }
+
     // success: wxApp::OnRun() will be called which will enter the main message
     // loop and the application will run. If we returned false here, the
     // application would exit immediately.
     return true;
 }
 
+// the exit code: of the headless export, or of the main loop
+int DxViewApp::OnRun()
+{
+    if ( m_status >= 0 )
+        return m_status;
+
+    return wxApp::OnRun();
+}
+
+static const wxCmdLineEntryDesc g_cmdLineDesc[] =
+{
+    { wxCMD_LINE_SWITCH, _T("h"), _T("help"), _T("show this help"),
+        wxCMD_LINE_VAL_NONE, wxCMD_LINE_OPTION_HELP },
+    { wxCMD_LINE_OPTION, _T("f"), _T("format"), _T("raw file format: u8, s16 (default), s16be or f32") },
+    { wxCMD_LINE_OPTION, _T("c"), _T("capture"), _T("start capturing from the device: ALSA name, FIFO, raw file or - for stdin") },
+    { wxCMD_LINE_OPTION, NULL, _T("fft"), _T("FFT size, any even number (default 512)"),
+        wxCMD_LINE_VAL_NUMBER },
+    { wxCMD_LINE_OPTION, NULL, _T("frame"), _T("window length, zero-padded to the FFT size (default the FFT size)"),
+        wxCMD_LINE_VAL_NUMBER },
+    { wxCMD_LINE_OPTION, NULL, _T("rate"), _T("sample rate of the input files, a multiple of 8000: decimated to 8000 before the analysis"),
+        wxCMD_LINE_VAL_NUMBER },
+    { wxCMD_LINE_SWITCH, NULL, _T("mel"),  _T("export mel log-energies to the output file and exit") },
+    { wxCMD_LINE_SWITCH, NULL, _T("mfcc"), _T("export MFCC to the output file and exit") },
+    { wxCMD_LINE_SWITCH, NULL, _T("image"), _T("export the spectrogram image to the output file (.ppm, otherwise a directory of PNG tiles) and exit") },
+    { wxCMD_LINE_SWITCH, NULL, _T("npy"),  _T("export the spectrogram in dB to the output file (.npy, otherwise raw float32 + .json) and exit") },
+    { wxCMD_LINE_SWITCH, NULL, _T("speech"), _T("leave the silence out of the export") },
+    { wxCMD_LINE_OPTION, NULL, _T("compare"), _T("the file to compare with the input, of its format and rate: shown side by side") },
+    { wxCMD_LINE_SWITCH, NULL, _T("diff"), _T("show the difference of the compared files in dB") },
+    { wxCMD_LINE_PARAM,  NULL, NULL, _T("input file, - for the standard input"),
+        wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL },
+    { wxCMD_LINE_PARAM,  NULL, NULL, _T("output file"),
+        wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL },
+    { wxCMD_LINE_NONE }
+};
+
+void DxViewApp::OnInitCmdLine(wxCmdLineParser& parser)
+{
+    parser.SetDesc(g_cmdLineDesc);
+}
+
+bool DxViewApp::OnCmdLineParsed(wxCmdLineParser& parser)
+{
+    wxString format(_T("s16"));
+
+    parser.Found(_T("f"), &format);
+    parser.Found(_T("c"), &m_device);
+    parser.Found(_T("fft"), &m_fft);
+    parser.Found(_T("frame"), &m_frame);
+    parser.Found(_T("rate"), &m_rate);
+    parser.Found(_T("compare"), &m_compare);
+    m_mel  = parser.Found(_T("mel"));
+    m_mfcc = parser.Found(_T("mfcc"));
+    m_npy  = parser.Found(_T("npy"));
+    m_image = parser.Found(_T("image"));
+    m_speech = parser.Found(_T("speech"));
+    m_diff = parser.Found(_T("diff"));
+
+    // the same order as in the Open dialog
+    if (format == _T("u8"))         m_format = 0;
+    else if (format == _T("s16"))   m_format = 1;
+    else if (format == _T("s16be")) m_format = 2;
+    else if (format == _T("f32"))   m_format = 3;
+    else {
+        parser.Usage();
+        return false;
+    }
+
+    if (m_fft < 0 || m_fft % 2 || m_frame < 0 ||
+        m_rate < long(SAMPLE_RATE) || m_rate % SAMPLE_RATE) {
+        parser.Usage();
+        return false;
+    }
+
+    if (parser.GetParamCount() > 0) m_input  = parser.GetParam(0);
+    if (parser.GetParamCount() > 1) m_output = parser.GetParam(1);
+
+    if ((m_mel || m_mfcc || m_npy || m_image) && m_output.IsEmpty()) {
+        parser.Usage();
+        return false;
+    }
+
+    return true;
+}
+
 // ----------------------------------------------------------------------------
 // constants
 // ----------------------------------------------------------------------------
@@ -508,12 +815,37 @@ enum
 	// menu items
     ID_Test,
     ID_Scroll,
+	ID_SlidingDft,
+	ID_LinFreq,
+	ID_LogFreq,
+	ID_MelFreq,
+	ID_Reassigned,
+	ID_Pitch,
+	ID_SpeechOnly,
+	ID_OpenCompare,
+	ID_CompareOff,
+	ID_CompareSide,
+	ID_CompareDiff,
+	ID_Export,
+	ID_ExportMatrix,
+	ID_ExportImage,
+	ID_LiveTimer,
+	ID_Follow,
+	ID_FollowTimer,
+	ID_IndexTimer,
+	ID_Overview,
+	ID_GoTo,
+	ID_GoToMenu,
+	ID_Scale,
 	ID_FFTwin,
 	ID_FFTsize,
+	ID_Frame,
 	ID_OnNext,
 	ID_OnNext2,
 	ID_OnPrev,
 	ID_OnPrev2,
+	ID_NextSpeech,
+	ID_PrevSpeech,
 	ID_OnAfterSize,
 	ID_OnAfterSome,
     ID_Help = wxID_HELP,
@@ -534,6 +866,26 @@ BEGIN_EVENT_TABLE(DxViewFrame, wxFrame)
     EVT_MENU(wxID_ABOUT,  DxViewFrame::OnAbout)
     EVT_MENU(ID_Test,   DxViewFrame::OnTest)
     EVT_MENU(ID_Scroll, DxViewFrame::OnScroll)
+    EVT_MENU(ID_SlidingDft, DxViewFrame::OnSlidingDft)
+    EVT_MENU(ID_LinFreq, DxViewFrame::OnFreqScale)
+    EVT_MENU(ID_LogFreq, DxViewFrame::OnFreqScale)
+    EVT_MENU(ID_MelFreq, DxViewFrame::OnFreqScale)
+    EVT_MENU(ID_Reassigned, DxViewFrame::OnReassigned)
+    EVT_MENU(ID_Pitch, DxViewFrame::OnPitch)
+    EVT_MENU(ID_SpeechOnly, DxViewFrame::OnSpeechOnly)
+    EVT_MENU(ID_OpenCompare, DxViewFrame::OnOpenCompare)
+    EVT_MENU(ID_CompareOff, DxViewFrame::OnCompare)
+    EVT_MENU(ID_CompareSide, DxViewFrame::OnCompare)
+    EVT_MENU(ID_CompareDiff, DxViewFrame::OnCompare)
+    EVT_MENU(ID_Export, DxViewFrame::OnExport)
+    EVT_MENU(ID_ExportMatrix, DxViewFrame::OnExportMatrix)
+    EVT_MENU(ID_ExportImage, DxViewFrame::OnExportImage)
+    EVT_CLOSE(DxViewFrame::OnClose)
+    EVT_TIMER(ID_LiveTimer, DxViewFrame::OnLiveTimer)
+    EVT_MENU(ID_Follow, DxViewFrame::OnFollow)
+    EVT_TIMER(ID_FollowTimer, DxViewFrame::OnFollowTimer)
+    EVT_TIMER(ID_IndexTimer, DxViewFrame::OnIndexTimer)
+    EVT_MENU(ID_GoToMenu, DxViewFrame::OnGoToMenu)
 
 	EVT_BUTTON(wxID_EXIT, DxViewFrame::OnQuit)
 	EVT_BUTTON(wxID_OPEN, DxViewFrame::OnOpen)
@@ -543,9 +895,18 @@ BEGIN_EVENT_TABLE(DxViewFrame, wxFrame)
 	EVT_BUTTON(ID_OnNext2, DxViewFrame::OnNext2)
 	EVT_BUTTON(ID_OnPrev,  DxViewFrame::OnPrev)
 	EVT_BUTTON(ID_OnPrev2, DxViewFrame::OnPrev2)
+	EVT_BUTTON(ID_NextSpeech, DxViewFrame::OnNextSpeech)
+	EVT_BUTTON(ID_PrevSpeech, DxViewFrame::OnPrevSpeech)
+	EVT_UPDATE_UI(ID_NextSpeech, DxViewFrame::OnUpdateSpeech)
+	EVT_UPDATE_UI(ID_PrevSpeech, DxViewFrame::OnUpdateSpeech)
+	EVT_COMMAND_SCROLL(ID_Overview, DxViewFrame::OnOverview)
+	EVT_TEXT_ENTER(ID_GoTo, DxViewFrame::OnGoTo)
+	EVT_TEXT_ENTER(ID_Scale, DxViewFrame::OnScale)
 	EVT_BUTTON(wxID_ZOOM_IN,  DxViewFrame::OnBtZoomIn)
 	EVT_BUTTON(wxID_ZOOM_OUT, DxViewFrame::OnBtZoomOut)
 	EVT_CHOICE(ID_FFTwin, DxViewFrame::OnSetFFTwin)
+	EVT_CHOICE(ID_FFTsize, DxViewFrame::OnSetFFTsize)
+	EVT_CHOICE(ID_Frame, DxViewFrame::OnSetFFTsize)
 
 	EVT_LEFT_DOWN(DxViewFrame::OnLButtonDown)
 	EVT_SIZE(DxViewFrame::OnSize)
@@ -558,32 +919,49 @@ END_EVENT_TABLE()
 
 const wxString sWinName(_T("Spectrogram Viewer - "));
 const wxString file_name(_T("out.pcm"));
+const wxChar sRawWildcard[] = _T(
+	"Raw 8bit,unsigned PCM (*.pcm)|*.pcm|"
+	"Raw 16bit,signed PCM (*.pcm)|*.pcm|"
+	"Raw 16bit,signed,BE PCM (*.pcm)|*.pcm|"
+	"Raw Float,32bit PCM (*.pcm)|*.pcm|"
+	"|");
 
 // frame constructor
 DxViewFrame::DxViewFrame(const wxString& title)
-	: wxFrame(NULL, wxID_ANY, title), wxThread(wxTHREAD_JOINABLE)
+	: wxFrame(NULL, wxID_ANY, title), wxThread(wxTHREAD_JOINABLE),
+	m_engine_b(NULL), m_compare_task(NULL)
 {
 	m_rd_size = 8;
-	m_order  = ORDER;
-	m_length = 1 << m_order;
-	m_buf_size = m_length * sizeof(float);
-	m_buffer   = new unsigned char[m_buf_size];
-	m_fwindow  = new float[m_length];
-	m_fbuffer  = new float[m_length];
-	m_fbuffer1 = new float[m_length+2];
-	m_fbuffer2 = new float[m_length+2];
-	m_fdB      = new float[m_length/2];
-
-	if(NULL == m_fbuffer || NULL == m_fbuffer2 || NULL == m_fdB)
+	m_overview_unit = m_rd_size;
+	m_col_min[0] = m_col_min[1] = m_col_max[0] = m_col_max[1] = 0.0f;
+	m_sel_from = m_sel_to = 0;
+	m_device = CAPTURE_DEVICE;
+	m_input_rate = SAMPLE_RATE;
+	m_live_timer.SetOwner(this, ID_LiveTimer);
+	m_follow_timer.SetOwner(this, ID_FollowTimer);
+	m_index_timer.SetOwner(this, ID_IndexTimer);
+	m_follow_end = 0;
+	m_show_pitch = false;
+	m_pitch_dir = 0;
+	m_speech_only = false;
+	m_length = 1 << ORDER;
+	m_samples = new float[m_length];
+	m_fdB     = new float[m_length/2];
+	m_fdB_b   = new float[m_length/2];
+
+	if(!m_engine.Init(m_length, 0))
 	{
 		wxLogTrace(wxTRACE_MemAlloc, "  memory allocation problem\n");
-		wxLogTrace(wxTRACE_MemAlloc, "  can't allocate m_fxxxx[]\n");
+		wxLogTrace(wxTRACE_MemAlloc, "  can't initialize the analysis engine\n");
 	}
 
-	// create window for FFT
-	dsp_window(m_fwindow, m_length, RECTANGULAR);
-	for (unsigned i = 0; i < m_length; i++) m_fbuffer[i] = 0.0f;
-	FFT();
+	// the spectrum of silence
+	for (unsigned i = 0; i < m_length; i++) m_samples[i] = 0.0f;
+	for (unsigned i = 0; i < m_length/2; i++) m_fdB[i] = m_fdB_b[i] = -100.0f;
+
+	m_scroll_time = 0;
+	m_scroll_rate = 0.0f;
+	m_scroll_fwd  = true;
 
 	/* strcpy +
 	if( theApp.m_lpCmdLine[0] != '\0' )
@@ -595,11 +973,9 @@ DxViewFrame::DxViewFrame(const wxString& title)
 		file_name[k] = '\0';
 	}*/
 
-	SetFileFormat(Signed16bit);
-
 	// open the default file
-	if (m_file.Exists(file_name))
-		m_file.Open(file_name);
+	if (wxFile::Exists(file_name))
+		m_engine.Open(file_name, AnalysisEngine::Signed16bit, STREAM_HISTORY);
 
 	IsStart = false;
 	m_FilePosition = 0;
@@ -611,6 +987,7 @@ DxViewFrame::DxViewFrame(const wxString& title)
 #if wxUSE_MENUS
     // create a menu bar
     wxMenu *fileMenu = new wxMenu;
+    wxMenu *viewMenu = new wxMenu;
     // the "About" item should be in the help menu
     wxMenu *helpMenu = new wxMenu;
 
@@ -618,7 +995,27 @@ DxViewFrame::DxViewFrame(const wxString& title)
     helpMenu->Append(wxID_ABOUT, _T("&About...\tF2"),  _T("Show about dialog"));
     fileMenu->Append(wxID_OPEN,  _T("&Open\tAlt-O"),   _T("Open audio file"));
     fileMenu->Append(wxID_NEW,   _T("&New\tAlt-N"),    _T("Record new audio file"));
+    fileMenu->Append(ID_OpenCompare, _T("Open for &comparison..."), _T("Open the second audio file to compare with the opened one"));
+    fileMenu->Append(ID_Export,  _T("&Export features..."), _T("Export mel energies or MFCC of the whole file"));
+    fileMenu->Append(ID_ExportMatrix, _T("Export &spectrogram..."), _T("Export the spectrogram of the selected range or of the whole file"));
+    fileMenu->Append(ID_ExportImage, _T("Export &image..."), _T("Export the spectrogram of the whole file as an image"));
+    fileMenu->AppendCheckItem(ID_SpeechOnly, _T("Export speech &only"), _T("Leave the silence between the speech segments out of the exports"));
+    fileMenu->AppendCheckItem(ID_Follow, _T("&Follow file\tAlt-F"), _T("Show the data appended to the file while it is being written"));
+    fileMenu->AppendCheckItem(ID_SlidingDft, _T("Sliding &DFT"), _T("Update the spectrum recursively for small read-steps"));
+    fileMenu->Check(ID_SlidingDft, m_engine.GetSlidingDft());
     fileMenu->Append(wxID_EXIT,  _T("E&xit\tAlt-X"),   _T("Quit this program"));
+    viewMenu->AppendRadioItem(ID_LinFreq, _T("Li&near frequency"), _T("Linear frequency axis of the spectrogram"));
+    viewMenu->AppendRadioItem(ID_LogFreq, _T("&Log frequency\tAlt-L"), _T("Log-frequency axis of the spectrogram"));
+    viewMenu->AppendRadioItem(ID_MelFreq, _T("&Mel frequency\tAlt-M"), _T("Mel-frequency axis of the spectrogram"));
+    viewMenu->AppendSeparator();
+    viewMenu->AppendCheckItem(ID_Reassigned, _T("&Reassigned spectrum\tAlt-R"), _T("Move the energy of the bins to their instantaneous frequencies"));
+    viewMenu->AppendCheckItem(ID_Pitch, _T("&Pitch contour\tAlt-P"), _T("Draw the fundamental frequency over the spectrogram"));
+    viewMenu->AppendSeparator();
+    viewMenu->AppendRadioItem(ID_CompareOff, _T("&Single spectrogram"), _T("The opened file only"));
+    viewMenu->AppendRadioItem(ID_CompareSide, _T("Side &by side\tAlt-B"), _T("The opened file above, the compared one below"));
+    viewMenu->AppendRadioItem(ID_CompareDiff, _T("&Difference A-B\tAlt-D"), _T("The level of the opened file less that of the compared one, dB"));
+    viewMenu->AppendSeparator();
+    viewMenu->Append(ID_GoToMenu, _T("&Go to time\tCtrl-G"), _T("Enter the time to jump to"));
 #if __WXDEBUG__
 	fileMenu->Append(ID_Test,    _T("&Test\tAlt-T"),   _T("The Test"));
     fileMenu->Append(ID_Scroll,  _T("&Scroll\tAlt-S"), _T("The Scroll Test"));
@@ -626,6 +1023,7 @@ DxViewFrame::DxViewFrame(const wxString& title)
     // now append the freshly created menu to the menu bar...
     wxMenuBar *menuBar = new wxMenuBar();
     menuBar->Append(fileMenu, _T("&File"));
+    menuBar->Append(viewMenu, _T("&View"));
     menuBar->Append(helpMenu, _T("&Help"));
     // ... and attach this menu bar to the frame
     SetMenuBar(menuBar);
@@ -669,6 +1067,12 @@ DxViewFrame::DxViewFrame(const wxString& title)
 	setFFTwindow->Append(_T("Hanning"));
 	setFFTwindow->Append(_T("Blackman"));
 	setFFTwindow->Append(_T("Welch"));
+	setFFTwindow->Append(_T("Blackman-Harris"));
+	setFFTwindow->Append(_T("Flat-top"));
+	setFFTwindow->Append(_T("Kaiser"));
+	setFFTwindow->Append(_T("Gaussian"));
+	setFFTwindow->Append(_T("DPSS"));
+	setFFTwindow->Append(_T("Multitaper"));
 	setFFTwindow->SetSelection(RECTANGULAR);
 	buttonSizer->Add(new wxStaticText(this, wxID_ANY, _T("FFT Window")), wxSizerFlags().Center());
 	buttonSizer->Add(setFFTwindow, wxSizerFlags(0).Border(wxLEFT|wxRIGHT,5).Center());
@@ -676,14 +1080,28 @@ DxViewFrame::DxViewFrame(const wxString& title)
 	setFFTsize = new wxChoice(this, ID_FFTsize);
 	setFFTsize->Append(_T("2048"));
 	setFFTsize->Append(_T("1024"));
+	setFFTsize->Append(_T("960"));
 	setFFTsize->Append(_T("512"));
+	setFFTsize->Append(_T("480"));
 	setFFTsize->Append(_T("256"));
+	setFFTsize->Append(_T("160"));
 	setFFTsize->Append(_T("128"));
 	setFFTsize->Append(_T("64"));
-	setFFTsize->SetSelection(2);
+	setFFTsize->SetStringSelection(wxString::Format(_T("%u"), m_length));
 	buttonSizer->Add(new wxStaticText(this, wxID_ANY, _T("FFT Size")), wxSizerFlags().Center());
 	buttonSizer->Add(setFFTsize, wxSizerFlags(0).Border(wxLEFT|wxRIGHT,5).Center());
 
+	// the window shorter than the FFT size is zero-padded to it
+	setFrame = new wxChoice(this, ID_Frame);
+	setFrame->Append(_T("= FFT Size"));
+	setFrame->Append(_T("960"));
+	setFrame->Append(_T("480"));
+	setFrame->Append(_T("320"));
+	setFrame->Append(_T("160"));
+	setFrame->SetSelection(0);
+	buttonSizer->Add(new wxStaticText(this, wxID_ANY, _T("Frame")), wxSizerFlags().Center());
+	buttonSizer->Add(setFrame, wxSizerFlags(0).Border(wxLEFT|wxRIGHT,5).Center());
+
 	ShowSpecAmp    = new wxTextCtrl(this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_READONLY|wxTE_CENTER);
 	ShowFreq       = new wxTextCtrl(this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_READONLY|wxTE_CENTER);
 
@@ -696,17 +1114,25 @@ DxViewFrame::DxViewFrame(const wxString& title)
 
 	wxBoxSizer *navySizer = new wxBoxSizer(wxHORIZONTAL);
 
-	ShowScale = new wxTextCtrl(this, wxID_ANY, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_READONLY|wxTE_CENTRE);
+	ShowScale = new wxTextCtrl(this, ID_Scale, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_PROCESS_ENTER|wxTE_CENTRE);
+	ShowScale->SetToolTip(_T("Samples per column"));
 	wxButton *btZoomIn  = new wxButton(this, wxID_ZOOM_IN,  _T("-"));
 	wxButton *btZoomOut = new wxButton(this, wxID_ZOOM_OUT, _T("+"));
 	wxButton *btPrev2   = new wxButton(this, ID_OnPrev2, _T("<<"));
 	wxButton *btPrev    = new wxButton(this, ID_OnPrev,  _T("<" ));
 	wxButton *btNext    = new wxButton(this, ID_OnNext,  _T(">" ));
 	wxButton *btNext2   = new wxButton(this, ID_OnNext2, _T(">>"));
+	wxButton *btPrevSp  = new wxButton(this, ID_PrevSpeech, _T("|<"));
+	wxButton *btNextSp  = new wxButton(this, ID_NextSpeech, _T(">|"));
+	btPrevSp->SetToolTip(_T("Previous speech segment"));
+	btNextSp->SetToolTip(_T("Next speech segment"));
+	overviewBar = new wxScrollBar(this, ID_Overview, wxDefaultPosition, wxDefaultSize, wxSB_HORIZONTAL);
+	GoToTime    = new wxTextCtrl(this, ID_GoTo, wxEmptyString, wxDefaultPosition, wxDefaultSize, wxTE_PROCESS_ENTER|wxTE_CENTRE);
+	GoToTime->SetToolTip(_T("Go to time: [[hh:]mm:]ss.sss"));
 
 	wxSize sz;
 	sz = ShowScale->GetEffectiveMinSize();
-	sz.x = sz.y + sz.y/2;
+	sz.x = 3*sz.y;
 	ShowScale->SetMinSize(sz);
 
 	sz = btZoomIn->GetEffectiveMinSize();
@@ -717,18 +1143,23 @@ DxViewFrame::DxViewFrame(const wxString& title)
 	btPrev->SetMinSize(sz);
 	btNext->SetMinSize(sz);
 	btNext2->SetMinSize(sz);
+	btPrevSp->SetMinSize(sz);
+	btNextSp->SetMinSize(sz);
 
 	sFlags.Proportion(0).Border(wxALL,3).Left();
 
 	navySizer->Add(btZoomIn,  sFlags);
 	navySizer->Add(ShowScale, sFlags);
 	navySizer->Add(btZoomOut, sFlags);
-	navySizer->AddStretchSpacer();
+	navySizer->Add(overviewBar, wxSizerFlags(1).Border(wxALL,3).Center());
+	navySizer->Add(GoToTime,  sFlags);
 	sFlags.Right();
+	navySizer->Add(btPrevSp,  sFlags);
 	navySizer->Add(btPrev2,   sFlags);
 	navySizer->Add(btPrev,    sFlags);
 	navySizer->Add(btNext,    sFlags);
 	navySizer->Add(btNext2,   sFlags);
+	navySizer->Add(btNextSp,  sFlags);
 
 	wxBoxSizer *showSizer = new wxBoxSizer(wxVERTICAL);
 
@@ -769,7 +1200,7 @@ DxViewFrame::DxViewFrame(const wxString& title)
 	SetSizerAndFit(Sizer);
 	SetAutoLayout(true);
 
-	wxAcceleratorEntry entries[12];
+	wxAcceleratorEntry entries[14];
 	entries[ 0].Set(wxACCEL_CTRL,   (int) 'E',  wxID_EXIT);
 	entries[ 1].Set(wxACCEL_CTRL,   (int) 'O',  wxID_OPEN);
 	entries[ 2].Set(wxACCEL_CTRL,   (int) 'N',  wxID_NEW);
@@ -782,7 +1213,9 @@ DxViewFrame::DxViewFrame(const wxString& title)
 	entries[ 9].Set(wxACCEL_CTRL,   WXK_LEFT,   ID_OnPrev2);
 	entries[10].Set(wxACCEL_NORMAL, WXK_RIGHT,  ID_OnNext);
 	entries[11].Set(wxACCEL_CTRL,   WXK_RIGHT,  ID_OnNext2);
-	wxAcceleratorTable accel(12, entries);
+	entries[12].Set(wxACCEL_ALT,    WXK_LEFT,   ID_PrevSpeech);
+	entries[13].Set(wxACCEL_ALT,    WXK_RIGHT,  ID_NextSpeech);
+	wxAcceleratorTable accel(14, entries);
 	SetAcceleratorTable(accel);
 
 	SetName(sWinName+file_name);
@@ -804,29 +1237,17 @@ DxViewFrame::DxViewFrame(const wxString& title)
 void DxViewFrame::OnQuit(wxCommandEvent& WXUNUSED(event))
 {
 	m_run = false; // try to stop thread;
+	m_live_timer.Stop();
+	m_follow_timer.Stop();
+	m_index_timer.Stop();
+	m_capture.Stop();
 	//wxThread::Wait();
+	CloseCompare();
+	m_engine.Close();
 
-	if (m_file.IsOpened()) m_file.Close();
-	delete[] m_buffer;
-
-	if(m_fwindow) {
-		wxLogTrace(wxTRACE_MemAlloc, "delete m_fwindow [0x%08X]\n",m_fwindow);
-		delete[] m_fwindow;
-	}
-
-	if(m_fbuffer) {
-		wxLogTrace(wxTRACE_MemAlloc, "delete m_fbuffer [0x%08X]\n",m_fbuffer);
-		delete[] m_fbuffer;
-	}
-
-	if(m_fbuffer1) {
-		wxLogTrace(wxTRACE_MemAlloc, "delete m_fbuffer1 [0x%08X]\n",m_fbuffer1);
-		delete[] m_fbuffer1;
-	}
-
-	if(m_fbuffer2) {
-		wxLogTrace(wxTRACE_MemAlloc, "delete m_fbuffer2 [0x%08X]\n",m_fbuffer2);
-		delete[] m_fbuffer2;
+	if(m_samples) {
+		wxLogTrace(wxTRACE_MemAlloc, "delete m_samples [0x%08X]\n",m_samples);
+		delete[] m_samples;
 	}
 
 	if(m_fdB) {
@@ -834,6 +1255,8 @@ void DxViewFrame::OnQuit(wxCommandEvent& WXUNUSED(event))
 		delete[] m_fdB;
 	}
 
+	delete[] m_fdB_b;
+
 	// true is to force the frame to close
 	Close(true);
 }
@@ -858,7 +1281,7 @@ void DxViewFrame::OnTest(wxCommandEvent& WXUNUSED(event))
 /*
 	FILE *file = fopen("test2.txt", "w+");
 	for (unsigned i = 0; i < m_length/2; i++) {
-		fprintf(file, "%f\n", m_fbuffer[i]);
+		fprintf(file, "%f\n", m_samples[i]);
 	}
 	fclose(file);
 */
@@ -874,28 +1297,342 @@ void DxViewFrame::OnScroll(wxCommandEvent& WXUNUSED(event))
 
 void DxViewFrame::OnSetFFTwin(wxCommandEvent& WXUNUSED(event))
 {
-	int n = setFFTwindow->GetSelection();
-	dsp_window(m_fwindow, m_length, n);
+	const int sel = setFFTwindow->GetSelection();
+
+	if( sel == int(MULTITAPER) ) {
+		m_engine.SetWindow(DPSS, 0.0, MULTITAPER_TAPERS);
+		if( m_engine_b ) m_engine_b->SetWindow(DPSS, 0.0, MULTITAPER_TAPERS);
+	} else {
+		m_engine.SetWindow(sel);
+		if( m_engine_b ) m_engine_b->SetWindow(sel);
+	}
 }
 
-void DxViewFrame::OnOpen(wxCommandEvent& WXUNUSED(event))
+// both the FFT size and the frame choices
+void DxViewFrame::OnSetFFTsize(wxCommandEvent& WXUNUSED(event))
 {
-	wxFileDialog fileDlg(this);
+	unsigned long length, frame = 0;
+
+	setFFTsize->GetStringSelection().ToULong(&length);
+	if( setFrame->GetSelection() > 0 )
+		setFrame->GetStringSelection().ToULong(&frame);
+
+	SetLength(unsigned(length), unsigned(std::min(frame, length)));
+}
+
+/*
+** FFT size length (any even number) with the window of frame samples in
+** its middle, zero-padded to length; frame 0 - the whole FFT size.
+** The spectra analysed so far are dropped, the opened input stays.
+*/
+bool DxViewFrame::SetLength(unsigned length, unsigned frame)
+{
+	bool ok = false;
+
+	if( !length ) length = m_length;
+
+	if( IsStart ) {
+		SetStatusText(_T("Stop the capture to change the FFT size"));
+	}
+	else if( length >= 2 && length % 2 == 0 ) {
+		ok = m_engine.Init(length, frame) && (!m_engine_b || m_engine_b->Init(length, frame));
+		if( !ok )
+			wxLogTrace(wxTRACE_MemAlloc, "  can't initialize the analysis engine\n");
+	}
+
+	if( ok ) {
+		m_length = length;
 
-	fileDlg.SetWildcard(_T(
-		"Raw 8bit,unsigned PCM (*.pcm)|*.pcm|"
-		"Raw 16bit,signed PCM (*.pcm)|*.pcm|"
-		"Raw 16bit,signed,BE PCM (*.pcm)|*.pcm|"
-		"Raw Float,32bit PCM (*.pcm)|*.pcm|"
-		"|"));
+		delete[] m_samples;
+		delete[] m_fdB;
+		delete[] m_fdB_b;
+		m_samples = new float[m_length];
+		m_fdB     = new float[m_length/2];
+		m_fdB_b   = new float[m_length/2];
+
+		for (unsigned i = 0; i < m_length; i++) m_samples[i] = 0.0f;
+		for (unsigned i = 0; i < m_length/2; i++) m_fdB[i] = m_fdB_b[i] = -100.0f;
+
+		spectrumView->Init(SAMPLE_RATE, m_length);
+		afhView->Init(m_length/2);
+		waveView->Init(m_length);
+		m_afc_freq = 0;
+	}
+
+	// the choices show the sizes in use, those from the command line may
+	// be out of them
+	setFFTsize->SetStringSelection(wxString::Format(_T("%u"), m_length));
+	if( m_engine.GetFrame() == m_length )
+		setFrame->SetSelection(0);
+	else
+		setFrame->SetStringSelection(wxString::Format(_T("%u"), m_engine.GetFrame()));
+
+	if( ok ) RedrawAll();
+
+	return ok;
+}
+
+void DxViewFrame::OnSlidingDft(wxCommandEvent& event)
+{
+	m_engine.SetSlidingDft(event.IsChecked());
+	if( m_engine_b ) m_engine_b->SetSlidingDft(event.IsChecked());
+}
+
+void DxViewFrame::OnFreqScale(wxCommandEvent& event)
+{
+	switch (event.GetId())
+	{
+	case ID_LinFreq: spectrumView->SetFreqScale(FilterBank::LINEAR); break;
+	case ID_LogFreq: spectrumView->SetFreqScale(FilterBank::LOG);    break;
+	case ID_MelFreq: spectrumView->SetFreqScale(FilterBank::MEL);    break;
+	}
+	RedrawAll();
+}
+
+void DxViewFrame::OnReassigned(wxCommandEvent& event)
+{
+	m_engine.SetReassigned(event.IsChecked());
+	if( m_engine_b ) m_engine_b->SetReassigned(event.IsChecked());
+	RedrawAll();
+}
+
+void DxViewFrame::OnPitch(wxCommandEvent& event)
+{
+	m_show_pitch = event.IsChecked();
+	RedrawAll();
+}
+
+void DxViewFrame::OnExport(wxCommandEvent& WXUNUSED(event))
+{
+	wxFileDialog fileDlg(this, _T("Export features"), wxEmptyString, wxEmptyString,
+		_T("Mel energies (*.txt)|*.txt|MFCC (*.txt)|*.txt"),
+		wxFD_SAVE|wxFD_OVERWRITE_PROMPT);
 
 	if( fileDlg.ShowModal() == wxID_OK )
 	{
-		if (m_file.IsOpened()) m_file.Close();
+		if(!ExportFeatures(fileDlg.GetPath(), fileDlg.GetFilterIndex() == 1))
+			wxMessageBox(_T("Cannot export the features"), _T("Error"), wxICON_ERROR, this);
+	}
+}
+
+void DxViewFrame::OnExportMatrix(wxCommandEvent& WXUNUSED(event))
+{
+	wxFileDialog fileDlg(this, _T("Export spectrogram"), wxEmptyString, wxEmptyString,
+		_T("NumPy array (*.npy)|*.npy|Raw float32 + JSON (*.f32)|*.f32"),
+		wxFD_SAVE|wxFD_OVERWRITE_PROMPT);
+
+	if( fileDlg.ShowModal() == wxID_OK )
+	{
+		const int format = (fileDlg.GetFilterIndex() == 1)? MatrixWriter::RAW: MatrixWriter::NPY;
+		bool ok;
+
+		wxBusyCursor wait;
+		if( m_sel_to > m_sel_from )
+			ok = ExportMatrix(fileDlg.GetPath(), format, m_sel_from, m_sel_to);
+		else
+			ok = ExportMatrix(fileDlg.GetPath(), format);
+
+		if(!ok)
+			wxMessageBox(_T("Cannot export the spectrogram"), _T("Error"), wxICON_ERROR, this);
+	}
+}
+
+void DxViewFrame::OnExportImage(wxCommandEvent& WXUNUSED(event))
+{
+	wxFileDialog fileDlg(this, _T("Export image"), wxEmptyString, wxEmptyString,
+		_T("PPM image (*.ppm)|*.ppm|PNG tiles directory (*.*)|*.*"),
+		wxFD_SAVE|wxFD_OVERWRITE_PROMPT);
+
+	if( fileDlg.ShowModal() == wxID_OK )
+	{
+		const int format = (fileDlg.GetFilterIndex() == 1)? TileWriter::PNG: TileWriter::PPM;
+
+		wxBusyCursor wait;
+		if(!ExportImage(fileDlg.GetPath(), format))
+			wxMessageBox(_T("Cannot export the image"), _T("Error"), wxICON_ERROR, this);
+	}
+}
+
+void DxViewFrame::OnClose(wxCloseEvent& event)
+{
+	m_live_timer.Stop();
+	m_follow_timer.Stop();
+	m_index_timer.Stop();
+	m_capture.Stop();
+	CloseCompare();
+	m_engine.Close();
+	event.Skip(); // destroy the frame
+}
+
+void DxViewFrame::OnStart(wxCommandEvent& WXUNUSED(event))
+{
+	if( IsStart )
+		StopCapture();
+	else
+		StartCapture();
+}
 
-		SetFileFormat(fileDlg.GetFilterIndex());
+/*
+** Live mode: the captured samples are written into the default file and
+** shown as they come, the read-step can be changed while capturing.
+*/
+bool DxViewFrame::StartCapture()
+{
+	m_engine.Close();
+	SetCompare(SpectrumView::COMPARE_OFF);
 
-		if(!m_file.Open(fileDlg.GetPath()))
+	// the captured columns carry at most a frame of samples
+	if( m_rd_size > m_length ) SetReadStep(m_length);
+
+	if( !m_capture.Start(m_device, SAMPLE_RATE, m_length, m_engine.GetFrame(), m_rd_size,
+		m_engine.GetWindow(), file_name) ) {
+		wxMessageBox(wxString::Format(_T("Cannot capture from %s"), m_device.c_str()),
+			_T("Error"), wxICON_ERROR, this);
+		return false;
+	}
+
+	IsStart = true;
+	startButton->SetLabel(_T("&Stop"));
+	SetName(sWinName+file_name);
+
+	m_FilePosition = 0;
+	ClearSelection();
+	spectrumView->Clear();
+	spectrumView->RePaint();
+	ampView->Clear();
+	ampView->SetTime(m_FilePosition);
+	ampView->RePaint();
+
+	m_live_timer.Start(CAPTURE_TIMER);
+
+	return true;
+}
+
+void DxViewFrame::StopCapture()
+{
+	m_live_timer.Stop();
+	m_capture.Stop();
+
+	IsStart = false;
+	startButton->SetLabel(_T("&New"));
+
+	if( m_capture.IsWriteFailed() )
+		wxMessageBox(_T("Cannot write the captured samples"), _T("Error"), wxICON_ERROR, this);
+
+	// the recording is browsed from its end
+	if( OpenFile(file_name, AnalysisEngine::Signed16bit, SAMPLE_RATE) ) {
+		m_FilePosition = m_engine.GetCount();
+		RedrawAll();
+	}
+
+	wxString str;
+	str.Printf(_T("Captured %.1f s, %u columns not shown, %u overruns"),
+		double(m_FilePosition)/SAMPLE_RATE, m_capture.GetDropped(), m_capture.GetOverruns());
+	SetStatusText(str);
+}
+
+// the captured columns are drawn as in the forward scrolling
+void DxViewFrame::OnLiveTimer(wxTimerEvent& WXUNUSED(event))
+{
+	unsigned hop;
+	wxFileOffset pos;
+	bool drawn = false;
+
+	while( m_capture.GetColumn(pos, hop, m_samples, m_fdB) )
+	{
+		m_FilePosition = pos;
+		spectrumView->Draw(m_fdB, m_length, true);
+		DrawColumnPitch(true);
+		ampView->SetTime(pos);
+		ampView->Draw(m_samples, hop, hop, true);
+		drawn = true;
+	}
+
+	if( drawn ) {
+		spectrumView->Refresh(false);
+		ampView->Refresh(false);
+		afhView->Draw(m_fdB);
+	}
+
+	// the end of the input
+	if( !m_capture.IsRunning() )
+		StopCapture();
+}
+
+void DxViewFrame::OnFollow(wxCommandEvent& event)
+{
+	if( event.IsChecked() ) {
+		m_watch.Open(m_engine.GetPath());
+		m_follow_end = m_engine.GetCount();
+		m_follow_timer.Start(FOLLOW_TIMER);
+	}
+	else {
+		// the stream input is always followed
+		if( !m_engine.IsStream() ) m_follow_timer.Stop();
+		m_watch.Close();
+	}
+}
+
+/*
+** Follow mode: when the file grows only the data near the old end of
+** file is dropped from the caches, it was padded with zeros, and if the
+** view shows the end of file it is scrolled over the appended frames.
+** The work is proportional to the appended data, not to the file size.
+*/
+void DxViewFrame::OnFollowTimer(wxTimerEvent& WXUNUSED(event))
+{
+	if( IsStart || !m_engine.IsOpened() ) return;
+	if( !m_engine.IsStream() && !m_watch.Check() ) return;
+
+	const wxFileOffset nsamples = m_engine.GetCount();
+	if( nsamples == m_follow_end ) return;
+
+	if( nsamples < m_follow_end ) {
+		// the file is rewritten
+		m_engine.Reset();
+		IndexSpeech();
+		m_follow_end = nsamples;
+		m_FilePosition = std::min(m_FilePosition, nsamples);
+		RedrawAll();
+		return;
+	}
+
+	const wxFileOffset old_end = m_follow_end;
+	m_follow_end = nsamples;
+
+	m_engine.Truncate(old_end);
+	IndexSpeech();
+
+	// centers of the last complete frames, before and now
+	const wxFileOffset old_last = old_end - m_length/2;
+	const wxFileOffset last = nsamples - m_length/2;
+
+	// the user looks at some other place
+	if( m_FilePosition + m_rd_size <= old_last ) return;
+
+	if( m_FilePosition >= last ) return;
+
+	const wxFileOffset nsteps = (last - m_FilePosition)/m_rd_size;
+
+	if( m_FilePosition > old_last || nsteps > ampView->GetWorkWidth()/2 ) {
+		// partial frames are shown or the whole view is new
+		m_FilePosition += nsteps*m_rd_size;
+		RedrawAll();
+	}
+	else if( nsteps > 0 ) {
+		DxScroll(int(nsteps));
+	}
+}
+
+void DxViewFrame::OnOpen(wxCommandEvent& WXUNUSED(event))
+{
+	wxFileDialog fileDlg(this);
+
+	fileDlg.SetWildcard(sRawWildcard);
+
+	if( fileDlg.ShowModal() == wxID_OK )
+	{
+		if(!OpenFile(fileDlg.GetPath(), fileDlg.GetFilterIndex()))
 			wxMessageBox(_T("Cannot open the file"), _T("Error"), wxICON_ERROR, this);
 
 		m_FilePosition = 0;
@@ -914,6 +1651,346 @@ void DxViewFrame::OnOpen(wxCommandEvent& WXUNUSED(event))
 	}
 }
 
+/*
+** Open a raw audio file, format - index of the file dialog filter, rate -
+** its sample rate, 0 - m_input_rate: a multiple of SAMPLE_RATE, the input
+** is decimated to it. The standard input ("-") and named pipes are read as
+** they come and shown as a followed file, the last STREAM_HISTORY bytes
+** are kept.
+*/
+bool DxViewFrame::OpenFile(const wxString& path, int format, unsigned rate)
+{
+	if (!rate) rate = m_input_rate;
+
+	if (!m_engine.Open(path, format, STREAM_HISTORY, rate/SAMPLE_RATE))
+		return false;
+
+	if (m_engine.IsStream()) {
+		m_follow_end = 0;
+		m_follow_timer.Start(FOLLOW_TIMER);
+		return true;
+	}
+
+	if (!m_watch.IsOpened()) m_follow_timer.Stop();
+
+	if (m_watch.IsOpened()) {
+		m_watch.Open(path);
+		m_follow_end = m_engine.GetCount();
+	}
+
+	// a pass over the whole file unless its sidecar is there, far faster
+	// than real time, in the background
+	IndexSpeech();
+
+	return true;
+}
+
+/*
+** Open the second input to compare with the first one, format as in
+** OpenFile(), the sample rate of the opened files. It is analysed as the
+** first one at the same positions, side by side unless the difference is
+** shown already. Only a file: a stream has no positions in common.
+** Its engine and column task are created here, with the sizes and the
+** options of the first one, and released by CloseCompare().
+*/
+bool DxViewFrame::OpenCompare(const wxString& path, int format)
+{
+	if (StreamSource::IsStream(path))
+		return false;
+
+	const int mode = IsComparing()? spectrumView->GetCompare(): SpectrumView::COMPARE_SIDE;
+
+	CloseCompare();
+
+	m_engine_b = new AnalysisEngine;
+
+	if (!m_engine_b->Init(m_length, m_engine.GetFrame()) ||
+		!m_engine_b->Open(path, format, STREAM_HISTORY, m_input_rate/SAMPLE_RATE))
+	{
+		SetCompare(SpectrumView::COMPARE_OFF);
+		return false;
+	}
+
+	m_engine_b->SetWindow(m_engine.GetWindow(), 0.0, m_engine.GetTapers());
+	m_engine_b->SetReassigned(m_engine.IsReassigned());
+	m_engine_b->SetSlidingDft(m_engine.GetSlidingDft());
+
+	// without the thread the compared columns are read after the others
+	m_compare_task = new ColumnTask(*m_engine_b);
+	m_compare_task->Start();
+
+	SetCompare(mode);
+
+	return true;
+}
+
+// stop the comparison, its thread and buffers are freed
+void DxViewFrame::CloseCompare()
+{
+	spectrumView->SetCompare(SpectrumView::COMPARE_OFF);
+
+	if (m_compare_task) {
+		m_compare_task->Stop();
+		delete m_compare_task;
+		m_compare_task = NULL;
+	}
+
+	delete m_engine_b;
+	m_engine_b = NULL;
+}
+
+/*
+** SpectrumView::COMPARE_OFF, _SIDE or _DIFF; there is no comparison
+** without the second input, and COMPARE_OFF closes it.
+*/
+void DxViewFrame::SetCompare(int mode)
+{
+	if (!m_engine_b || !m_engine_b->IsOpened()) mode = SpectrumView::COMPARE_OFF;
+	if (mode == SpectrumView::COMPARE_OFF) CloseCompare();
+
+	spectrumView->SetCompare(mode);
+#if wxUSE_MENUS
+	GetMenuBar()->Check(ID_CompareOff + mode, true);
+#endif
+	SetStatusText(wxEmptyString, 1);
+
+	CacheView();
+	RedrawAll();
+}
+
+void DxViewFrame::OnOpenCompare(wxCommandEvent& WXUNUSED(event))
+{
+	wxFileDialog fileDlg(this);
+
+	fileDlg.SetWildcard(sRawWildcard);
+
+	if( fileDlg.ShowModal() == wxID_OK )
+	{
+		if( !OpenCompare(fileDlg.GetPath(), fileDlg.GetFilterIndex()) )
+			wxMessageBox(_T("Cannot open the file for comparison"), _T("Error"), wxICON_ERROR, this);
+		else
+			SetStatusText(_T("Compared with ") + fileDlg.GetFilename());
+	}
+}
+
+void DxViewFrame::OnCompare(wxCommandEvent& event)
+{
+	const int mode = event.GetId() - ID_CompareOff;
+
+	if( mode != SpectrumView::COMPARE_OFF && !m_engine_b )
+		SetStatusText(_T("Open a file for comparison first"));
+
+	SetCompare(mode);
+}
+
+// the headless export of a stream waits for its end
+void DxViewFrame::WaitForInput()
+{
+	while (m_engine.IsStream() && !m_engine.IsEnded())
+		wxThread::Sleep(50);
+}
+
+/*
+** Export the features of the whole file into a text file, one line per
+** read-step: the time in seconds followed by MEL_BANDS mel log-energies
+** in dB or by MFCC_COEFS cepstral coefficients. The silent read-steps are
+** left out in the speech only mode.
+*/
+bool DxViewFrame::ExportFeatures(const wxString& path, bool mfcc)
+{
+	if (!m_engine.IsOpened()) return false;
+	if (m_speech_only) TakeIndex(true);
+
+	if (!m_mel.IsSame(m_length, SAMPLE_RATE))
+		m_mel.Init(m_length, SAMPLE_RATE, MEL_BANDS, MFCC_COEFS);
+
+	FILE *file = fopen(path.fn_str(), "w");
+	if (!file) return false;
+
+	float *mel  = new float[m_mel.GetBands()];
+	float *coef = new float[m_mel.GetCoefs()];
+	const unsigned count = mfcc? m_mel.GetCoefs(): m_mel.GetBands();
+	const float *values = mfcc? coef: mel;
+
+	fprintf(file, "# %s, FFT size %u, read-step %u, sample rate %u\n",
+		mfcc? "MFCC": "mel log-energies (dB)", m_length, m_rd_size, SAMPLE_RATE);
+
+	const wxFileOffset nsamples = m_engine.GetCount();
+	bool ok = true;
+
+	for (wxFileOffset pos = 0; pos < nsamples; pos += m_rd_size)
+	{
+		if (IsSkipped(pos)) continue;
+
+		if (m_engine.ReadFrame(pos-m_length/2, NULL, m_fdB) < 0) {
+			ok = false;
+			break;
+		}
+
+		m_mel.Compute(m_fdB, mel, mfcc? coef: NULL);
+
+		fprintf(file, "%.4f", double(pos)/SAMPLE_RATE);
+		for (unsigned i = 0; i < count; i++)
+			fprintf(file, " %.3f", values[i]);
+		fprintf(file, "\n");
+	}
+
+	if (fclose(file) != 0) ok = false;
+
+	delete[] mel;
+	delete[] coef;
+
+	return ok;
+}
+
+/*
+** Export the spectrogram of the samples from..to (to < 0 - up to the end
+** of the file) as a float32 matrix, one row of m_length/2 dB values per
+** read-step, of the speech only in the speech only mode. Rows are streamed
+** to the file as they are computed, format is MatrixWriter::NPY or
+** MatrixWriter::RAW (with a JSON sidecar).
+*/
+bool DxViewFrame::ExportMatrix(const wxString& path, int format, wxFileOffset from, wxFileOffset to)
+{
+	if (!m_engine.IsOpened()) return false;
+	if (m_speech_only) TakeIndex(true);
+
+	const wxFileOffset nsamples = m_engine.GetCount();
+	if (to < 0 || to > nsamples) to = nsamples;
+	if (from < 0) from = 0;
+	if (from >= to) return false;
+
+	const unsigned rows = CountExported(from, to);
+	const bool speech = m_speech_only && m_engine.IsIndexed();
+
+	wxString info;
+	info.Printf(_T("\"unit\": \"dB\", \"fft\": %u, \"hop\": %u, \"rate\": %u, \"start\": %") wxLongLongFmtSpec _T("d, \"window\": \"%s\", \"speech_only\": %s"),
+		m_length, m_rd_size, SAMPLE_RATE, from, setFFTwindow->GetStringSelection().c_str(),
+		speech? _T("true"): _T("false"));
+
+	MatrixWriter writer;
+	bool ok = writer.Open(path.fn_str(), format, rows, m_length/2,
+		std::string(info.mb_str()));
+
+	for (wxFileOffset pos = from; ok && pos < to; pos += m_rd_size)
+	{
+		if (IsSkipped(pos)) continue;
+
+		ok = m_engine.ReadFrame(pos-m_length/2, NULL, m_fdB) >= 0 && writer.Write(m_fdB);
+	}
+
+	return writer.Close() && ok;
+}
+
+/*
+** Export the spectrogram of the whole file as an image colored as the
+** spectrum view, one column of m_length/2 rows per read-step (the silent
+** ones are left out in the speech only mode): a single PPM file or a
+** pyramid of PNG tiles in the path directory.
+*/
+bool DxViewFrame::ExportImage(const wxString& path, int format)
+{
+	if (!m_engine.IsOpened()) return false;
+	if (m_speech_only) TakeIndex(true);
+
+	const wxFileOffset nsamples = m_engine.GetCount();
+	const unsigned width  = CountExported(0, nsamples);
+	const unsigned height = m_length/2;
+
+	unsigned char palette[DB_LEVELS][3];
+	for (unsigned i = 0; i < DB_LEVELS; i++) {
+		palette[i][0] = dBtoColor[i].Red();
+		palette[i][1] = dBtoColor[i].Green();
+		palette[i][2] = dBtoColor[i].Blue();
+	}
+
+	TileWriter writer;
+	if (!writer.Open(path, format, width, height, palette, DB_LEVELS))
+		return false;
+
+	unsigned char *column = new unsigned char[height];
+	bool ok = true;
+
+	for (wxFileOffset pos = 0; ok && pos < nsamples; pos += m_rd_size)
+	{
+		if (IsSkipped(pos)) continue;
+
+		if (m_engine.ReadFrame(pos-m_length/2, NULL, m_fdB) < 0) {
+			ok = false;
+			break;
+		}
+
+		// the highest frequency at the top
+		for (unsigned i = 0; i < height; i++)
+			column[height-1-i] = (unsigned char)MapLevel(m_fdB[i]);
+
+		ok = writer.AddColumn(column);
+	}
+
+	delete[] column;
+
+	return writer.Close() && ok;
+}
+
+// the read-steps from..to that are exported
+unsigned DxViewFrame::CountExported(wxFileOffset from, wxFileOffset to)
+{
+	unsigned count = 0;
+
+	for (wxFileOffset pos = from; pos < to; pos += m_rd_size)
+		if (!IsSkipped(pos)) count++;
+
+	return count;
+}
+
+void DxViewFrame::SetSpeechOnly(bool only)
+{
+	m_speech_only = only;
+#if wxUSE_MENUS
+	GetMenuBar()->Check(ID_SpeechOnly, only);
+#endif
+}
+
+void DxViewFrame::OnSpeechOnly(wxCommandEvent& event)
+{
+	m_speech_only = event.IsChecked();
+}
+
+/*
+** The first pass of the speech index runs in the background: the jumps,
+** the marks and the skipping of the silence start when it is taken.
+*/
+void DxViewFrame::IndexSpeech()
+{
+	m_engine.IndexSpeech(VAD_BLOCK);
+
+	if( m_engine.IsIndexing() && !m_index_timer.IsRunning() )
+		m_index_timer.Start(INDEX_TIMER);
+}
+
+// wait - until the pass is done, the exports need the whole index
+bool DxViewFrame::TakeIndex(bool wait)
+{
+	if( !m_engine.FinishIndex(wait) ) return false;
+
+	m_index_timer.Stop();
+
+	// the columns shown were drawn without the marks
+	if( IsShown() && !IsStart ) RedrawAll();
+
+	return true;
+}
+
+void DxViewFrame::OnIndexTimer(wxTimerEvent& WXUNUSED(event))
+{
+	TakeIndex(false);
+}
+
+void DxViewFrame::OnUpdateSpeech(wxUpdateUIEvent& event)
+{
+	event.Enable(m_engine.IsIndexed());
+}
+
 void DxViewFrame::OnNext(wxCommandEvent& WXUNUSED(event))
 {
 	if( !IsStart )
@@ -946,46 +2023,170 @@ void DxViewFrame::OnPrev2(wxCommandEvent& WXUNUSED(event))
 	}
 }
 
-// Zoom in
-void DxViewFrame::OnBtZoomIn(wxCommandEvent& WXUNUSED(event))
+/*
+** The next/previous segment of the speech index is shown from 1/SPEECH_LEAD
+** of the view, the segments are counted from that point, so the repeated
+** jumps go through them one by one.
+*/
+void DxViewFrame::OnNextSpeech(wxCommandEvent& WXUNUSED(event))
+{
+	if( IsStart || !m_engine.IsIndexed() ) return;
+
+	const wxFileOffset span = wxFileOffset(ampView->GetWorkWidth()/2)*m_rd_size;
+	const wxFileOffset pos = m_engine.NextSpeech(m_FilePosition - span + span/SPEECH_LEAD);
+
+	if( pos < 0 ) {
+		wxBell();
+		SetStatusText(_T("No speech further on"));
+		return;
+	}
+
+	JumpTo(pos - span/SPEECH_LEAD + span);
+}
+
+void DxViewFrame::OnPrevSpeech(wxCommandEvent& WXUNUSED(event))
 {
-	if( m_rd_size > 8 )
+	if( IsStart || !m_engine.IsIndexed() ) return;
+
+	const wxFileOffset span = wxFileOffset(ampView->GetWorkWidth()/2)*m_rd_size;
+	const wxFileOffset pos = m_engine.PrevSpeech(m_FilePosition - span + span/SPEECH_LEAD);
+
+	if( pos < 0 ) {
+		wxBell();
+		SetStatusText(_T("No speech before"));
+		return;
+	}
+
+	JumpTo(pos - span/SPEECH_LEAD + span);
+}
+
+// the overview scrollbar shows the view in the whole file, its thumb
+// is the view: the position is the left edge in m_overview_unit units
+void DxViewFrame::OnOverview(wxScrollEvent& event)
+{
+	if( IsStart || !m_engine.IsOpened() ) return;
+
+	const wxEventType type = event.GetEventType();
+
+	if( type == wxEVT_SCROLL_LINEUP )
+		JumpTo(m_FilePosition - m_overview_unit);
+	else if( type == wxEVT_SCROLL_LINEDOWN )
+		JumpTo(m_FilePosition + m_overview_unit);
+	else {
+		const wxFileOffset span = wxFileOffset(ampView->GetWorkWidth()/2)*m_rd_size;
+		JumpTo(wxFileOffset(event.GetPosition())*m_overview_unit + span);
+	}
+}
+
+// [[hh:]mm:]ss.sss
+static bool ParseTime(const wxString& str, double& seconds)
+{
+	wxString rest(str);
+	rest.Trim().Trim(false);
+
+	seconds = 0.0;
+
+	for( int i = 0; i < 3; i++ )
 	{
-		m_rd_size /= 2;
+		double v;
+		if( !rest.BeforeFirst(_T(':')).ToDouble(&v) || v < 0.0 ) return false;
 
-		if( IsStart ) {
-			spectrumView->Clear();
-			ampView->Clear();
-		}
-		else {
-			RedrawAll();
-		}
+		seconds = seconds*60.0 + v;
 
-		wxString str;
-		str.Printf(_T("%d"), m_rd_size);
-		ShowScale->ChangeValue(str);
+		// the last field, an empty one after a ':' is not a number
+		if( rest.Find(_T(':')) == wxNOT_FOUND ) return true;
+		rest = rest.AfterFirst(_T(':'));
 	}
+
+	return false;
+}
+
+// the entered time is put under the cursor at the right edge of the view
+void DxViewFrame::OnGoTo(wxCommandEvent& WXUNUSED(event))
+{
+	if( IsStart ) return;
+
+	double seconds;
+	if( !ParseTime(GoToTime->GetValue(), seconds) ) {
+		wxBell();
+		SetStatusText(_T("Time format: [[hh:]mm:]ss.sss"));
+		return;
+	}
+
+	JumpTo(wxFileOffset(seconds*SAMPLE_RATE + 0.5));
+}
+
+void DxViewFrame::OnGoToMenu(wxCommandEvent& WXUNUSED(event))
+{
+	GoToTime->SetFocus();
+	GoToTime->SetSelection(-1, -1);
+}
+
+// zoom levels are half an octave apart: 8, 11, 16, 23, 32, 45...
+static unsigned ZoomLevel(int n)
+{
+	return unsigned(MIN_READ_STEP*pow(2.0, n/2.0) + 0.5);
+}
+
+// Zoom in
+void DxViewFrame::OnBtZoomIn(wxCommandEvent& WXUNUSED(event))
+{
+	int n = 0;
+	while( ZoomLevel(n+1) < m_rd_size ) n++;
+
+	SetReadStep(ZoomLevel(n));
 }
 
 // Zoom out
 void DxViewFrame::OnBtZoomOut(wxCommandEvent& WXUNUSED(event))
 {
-	if( m_rd_size < m_length )
-	{
-		m_rd_size *= 2;
+	int n = 0;
+	while( ZoomLevel(n) <= m_rd_size ) n++;
 
-		if( IsStart ) {
-			spectrumView->Clear();
-			ampView->Clear();
-		}
-		else {
-			RedrawAll();
-		}
+	SetReadStep(ZoomLevel(n));
+}
 
-		wxString str;
-		str.Printf(_T("%d"), m_rd_size);
-		ShowScale->ChangeValue(str);
+// any read-step typed in the scale field
+void DxViewFrame::OnScale(wxCommandEvent& WXUNUSED(event))
+{
+	long rd_size;
+
+	if( ShowScale->GetValue().ToLong(&rd_size) && rd_size > 0 )
+		SetReadStep(unsigned(std::min(rd_size, long(MAX_READ_STEP))));
+	else
+		wxBell();
+
+	wxString str;
+	str.Printf(_T("%u"), m_rd_size);
+	ShowScale->ChangeValue(str);
+}
+
+/*
+** Set the zoom, samples per view column. The live capture columns carry
+** at most a frame, the file view may be zoomed out up to MAX_READ_STEP.
+*/
+void DxViewFrame::SetReadStep(unsigned rd_size)
+{
+	rd_size = std::max(rd_size, MIN_READ_STEP);
+	rd_size = std::min(rd_size, IsStart? m_length: MAX_READ_STEP);
+
+	if( rd_size == m_rd_size ) return;
+
+	m_rd_size = rd_size;
+
+	if( IsStart ) {
+		m_capture.SetHop(m_rd_size);
+		spectrumView->Clear();
+		ampView->Clear();
+	}
+	else {
+		CacheView();
+		RedrawAll();
 	}
+
+	wxString str;
+	str.Printf(_T("%u"), m_rd_size);
+	ShowScale->ChangeValue(str);
 }
 
 // Mouse left button click handling
@@ -1005,8 +2206,15 @@ void DxViewFrame::OnLButtonDown(wxMouseEvent& event)
 		const wxPoint& point = event.GetPosition();
 		const wxRect& rect = ampView->GetWorkRect();
 
+		// shift+click selects the range from the cursor
+		if( event.ShiftDown() ) {
+			ShowWelch(m_ampl_x, point.x - rect.x);
+			return;
+		}
+
 		m_ampl_x = point.x - rect.x;
 		ampView->SetCursor(m_ampl_x, 0);
+		ClearSelection();
 		DxScroll(0);
 	}
 
@@ -1050,46 +2258,174 @@ void DxViewFrame::OnUpdateUI(wxUpdateUIEvent& event)
 	}
 }
 
-// redraw all drawing windows
-void DxViewFrame::RedrawAll()
+// redraw all drawing windows
+void DxViewFrame::RedrawAll()
+{
+	spectrumView->DrawScale();
+	ampView->DrawScale();
+	afhView->DrawScale();
+
+	// put the cursor in the utmost right position
+	m_ampl_x = ampView->GetWorkWidth()-1;
+	ampView->SetCursor(m_ampl_x, 0);
+	ClearSelection();
+	m_pitch_dir = 0;
+
+	if( !IsStart && m_engine.IsOpened())
+	{
+		unsigned int count = ampView->GetWorkWidth()/2;
+
+		//ampView->SetTime(m_FilePosition - (count-1)*m_rd_size);
+
+		// the compared columns are read by the other thread meanwhile
+		if( IsComparing() )
+			m_compare_task->Read(m_FilePosition - wxFileOffset(count-1)*m_rd_size,
+				long(m_rd_size), count, m_rd_size);
+
+		// the pyramid columns of the whole view at once
+		if( IsPooled() )
+			m_engine.Prepare(m_FilePosition - wxFileOffset(count)*m_rd_size,
+				m_FilePosition + m_rd_size/2);
+
+		while(count-->0)
+		{
+			const wxFileOffset pos = m_FilePosition - wxFileOffset(count)*m_rd_size;
+			const int res = ReadColumn(pos);
+
+			if( res < 0 ) break;
+
+			ampView->SetTime(pos);
+			ampView->DrawColumn(m_col_min, m_col_max, (res>0)? m_rd_size: 0, true, IsSpeech(pos));
+			DrawColumn(true);
+			DrawColumnPitch(true);
+		}
+
+		if( IsComparing() ) m_compare_task->Finish();
+
+		spectrumView->Refresh(false);//RePaint();
+		ampView->Refresh(false);//RePaint();
+		afhView->Refresh(false);//RePaint();
+
+		DxScroll(0);
+	}
+
+	UpdateOverview();
+}
+
+/*
+** Move the right edge of the view to pos. A short move is scrolled, any
+** other one costs as much as the visible window whatever the distance:
+** the missing frames of the new view are computed in parallel and the
+** cached ones are reused.
+*/
+void DxViewFrame::JumpTo(wxFileOffset pos)
+{
+	if( IsStart || !m_engine.IsOpened() ) return;
+
+	// the whole view of the stream input must be in its history
+	wxFileOffset first = 0;
+	if( m_engine.GetFirst() > 0 )
+		first = m_engine.GetFirst() +
+			wxFileOffset(ampView->GetWorkWidth()/2)*m_rd_size + m_length/2;
+
+	const wxFileOffset nsamples = m_engine.GetCount();
+	if( pos < first ) pos = first;
+	if( pos > nsamples ) pos = nsamples;
+
+	const wxFileOffset delta = pos - m_FilePosition;
+
+	if( delta % m_rd_size == 0 && delta/m_rd_size >= -wxFileOffset(JUMP_SCROLL) &&
+		delta/m_rd_size <= wxFileOffset(JUMP_SCROLL) ) {
+		DxScroll(int(delta/m_rd_size));
+		return;
+	}
+
+	m_FilePosition = pos;
+	CacheView();
+	RedrawAll();
+}
+
+/*
+** Compute the frames of the whole view that are not in the frame cache
+** yet by several threads, RedrawAll() takes them from the cache then.
+*/
+void DxViewFrame::CacheView()
 {
-	spectrumView->DrawScale();
-	ampView->DrawScale();
-	afhView->DrawScale();
+	// the zoomed out view is read from the pyramid
+	if( m_rd_size > m_engine.GetFrame() ) return;
 
-	// put the cursor in the utmost right position
-	m_ampl_x = ampView->GetWorkWidth()-1;
-	ampView->SetCursor(m_ampl_x, 0);
+	const unsigned count = ampView->GetWorkWidth()/2;
+	if( count < 2 ) return;
 
-	if( !IsStart && m_file.IsOpened())
-	{
-		unsigned int count = ampView->GetWorkWidth()/2;
+	const wxFileOffset first = m_FilePosition - wxFileOffset(count-1)*m_rd_size - m_length/2;
 
-		//ampView->SetTime(m_FilePosition - (count-1)*m_rd_size);
+	// both inputs at once, each one by several threads
+	if( IsComparing() )
+		m_compare_task->Cache(first, m_rd_size, count);
 
-		while(count-->0)
-		{
-			const int pos = m_FilePosition - count*m_rd_size;
-			const int res = ReadAndFft(pos-m_length/2);
+	m_engine.CacheFrames(first, m_rd_size, count);
+	if( IsComparing() ) m_compare_task->Finish();
+}
 
-			if( res < 0 ) break;
+// the thumb of the overview scrollbar is the view in the whole input
+void DxViewFrame::UpdateOverview()
+{
+	const wxFileOffset nsamples = m_engine.IsOpened()? m_engine.GetCount(): 0;
+	const wxFileOffset span = wxFileOffset(ampView->GetWorkWidth()/2)*m_rd_size;
 
-			ampView->SetTime(pos);
-			ampView->Draw(m_fbuffer, m_length, (res>0)? m_rd_size: 0, true);
-			spectrumView->Draw(m_fdB, m_length, true);
-		}
+	// a unit of several read-steps keeps the range within an int
+	m_overview_unit = m_rd_size*unsigned(1 + nsamples/m_rd_size/OVERVIEW_RANGE);
 
-		spectrumView->Refresh(false);//RePaint();
-		ampView->Refresh(false);//RePaint();
-		afhView->Refresh(false);//RePaint();
+	const int range = int((nsamples + m_overview_unit - 1)/m_overview_unit);
+	const int thumb = std::max(int(span/m_overview_unit), 1);
+	const wxFileOffset left = std::max(m_FilePosition - span, wxFileOffset(0));
 
-		DxScroll(0);
+	overviewBar->SetScrollbar(int(left/m_overview_unit), thumb, std::max(range, thumb), thumb);
+}
+
+/*
+** Show the Welch-averaged power spectrum of the range between the
+** amplitude view points x1 and x2 in the AFC view.
+*/
+void DxViewFrame::ShowWelch(int x1, int x2)
+{
+	if( !m_engine.IsOpened() || m_engine.IsStream() ) return;
+
+	if( x1 > x2 ) std::swap(x1, x2);
+
+	const int width = ampView->GetWorkWidth();
+	const wxFileOffset from = m_FilePosition - wxFileOffset(width-1-x1)*m_rd_size/2;
+	const wxFileOffset to   = m_FilePosition - wxFileOffset(width-1-x2)*m_rd_size/2;
+
+	float *psd = new float[m_length/2];
+	const unsigned nframes = m_engine.Welch(from, to, psd);
+
+	if( nframes ) {
+		m_sel_from = from;
+		m_sel_to   = to;
+		ampView->SetSelection(x1, x2);
+		ampView->RePaint();
+		afhView->Draw(psd);
+
+		wxString str;
+		str.Printf(_T("Welch PSD %.3f - %.3f s, %u frames, ENBW %.2f bins"),
+			double(from)/SAMPLE_RATE, double(to)/SAMPLE_RATE, nframes,
+			m_engine.GetEnbw());
+		SetStatusText(str);
 	}
+
+	delete[] psd;
+}
+
+void DxViewFrame::ClearSelection()
+{
+	m_sel_from = m_sel_to = 0;
+	ampView->SetSelection(-1, -1);
 }
 
 void DxViewFrame::DxScroll(int scroll)
 {
-	int      pos; // ATTENTION! 'pos' could be uninitialized
+	wxFileOffset pos; // ATTENTION! 'pos' could be uninitialized
 	unsigned nsteps;
 	bool     forward;
 
@@ -1099,58 +2435,95 @@ void DxViewFrame::DxScroll(int scroll)
 		forward = false; nsteps = -scroll;
 	}
 
+	// the pyramid columns of all the steps at once
+	if (IsPooled() && nsteps) {
+		const wxFileOffset span = wxFileOffset(nsteps)*m_rd_size;
+		const wxFileOffset from = (forward)? m_FilePosition:
+			m_FilePosition - wxFileOffset(ampView->GetWorkWidth()/2)*m_rd_size - span;
+
+		m_engine.Prepare(from, from + span + m_rd_size);
+	}
+
+	if (IsComparing() && nsteps) {
+		const wxFileOffset first = (forward)? m_FilePosition + m_rd_size:
+			m_FilePosition - wxFileOffset(ampView->GetWorkWidth())*m_rd_size/2;
+
+		m_compare_task->Read(first, forward? long(m_rd_size): -long(m_rd_size), nsteps, m_rd_size);
+	}
+
 	while (nsteps-->0) {
 		if (forward)
 			pos = m_FilePosition + m_rd_size;
 		else // work width should be an even number...
-			pos = m_FilePosition - ampView->GetWorkWidth()*m_rd_size/2;
+			pos = m_FilePosition - wxFileOffset(ampView->GetWorkWidth())*m_rd_size/2;
 
-		if (ReadAndFft(pos-m_length/2) <= 0) break;
+		if (ReadColumn(pos) <= 0) break;
 
-		// update the position only if ReadAndFft returned OK
-		m_FilePosition += (forward)? int(m_rd_size): -int(m_rd_size);
+		// update the position only if ReadColumn returned OK
+		m_FilePosition += (forward)? wxFileOffset(m_rd_size): -wxFileOffset(m_rd_size);
 
-		ampView->Draw(m_fbuffer, m_length, m_rd_size, forward);
-		spectrumView->Draw(m_fdB, m_length, forward);
+		ampView->DrawColumn(m_col_min, m_col_max, m_rd_size, forward, IsSpeech(pos));
+		DrawColumn(forward);
+		DrawColumnPitch(forward);
 	}
 
+	if (IsComparing()) m_compare_task->Finish();
+
 	if (scroll) {
+		Prefetch(forward, scroll > 0? scroll: -scroll);
+		ClearSelection();
+		UpdateOverview();
+
 		spectrumView->Refresh(false);
 		ampView->Refresh(false);
 	} else {
 		ampView->RePaint();
 	}
 
-	/* show data under the cursor */
+	/* show data under the cursor, it is usually drawn already
+	   so the frame is taken from the cache without reading the file */
+	float    *samples = m_samples;
+	float    *dB = m_fdB;
+	float    max_amp;
+	unsigned max_spec_amp; // index in the array
+
 	if( !IsStart ) {
-		pos = m_FilePosition - (ampView->GetWorkWidth()-1-m_ampl_x)*m_rd_size/2;
-		if( ReadAndFft(pos-m_length/2) < 0 ) return;
+		pos = m_FilePosition - wxFileOffset(ampView->GetWorkWidth()-1-m_ampl_x)*m_rd_size/2;
+		if( m_engine.ReadFrame(pos-m_length/2, m_samples, m_fdB) < 0 ) return;
 	}
 
+	max_amp = *std::max_element(m_samples, m_samples+m_length);
+	max_spec_amp = std::max_element(m_fdB, m_fdB+m_length/2)-m_fdB;
+
 	wxString str;
-	str.Printf(_T("%.3f s"), float(pos)/SAMPLE_RATE);
+	str.Printf(_T("%.3f s"), double(pos)/SAMPLE_RATE);
 	ShowTime->ChangeValue(str);
 
-	int max_amp = (*std::max_element(m_fbuffer, m_fbuffer+m_length))*100;
-	str.Printf(_T("%d %%"), max_amp);
+	str.Printf(_T("%d %%"), int(max_amp*100));
 	ShowAmplitude->ChangeValue(str);
 
 	str.Printf(_T("%d Hz"), SAMPLE_RATE*m_afc_freq/m_length);
 	ShowFreq->ChangeValue(str);
-	str.Printf(_T("%.2f dB"), m_fdB[m_afc_freq]);
+	str.Printf(_T("%.2f dB"), dB[m_afc_freq]);
 	ShowSpecAmp->ChangeValue(str);
 
-	// index in the array
-	int max_spec_amp = std::max_element(m_fdB, m_fdB+m_length/2)-m_fdB;
 	int freq_of_max = SAMPLE_RATE*max_spec_amp/m_length;
 
 	str.Printf(_T("%d Hz"), freq_of_max);
 	ShowFreqOfMax->ChangeValue(str);
-	str.Printf(_T("%.2f dB"), m_fdB[max_spec_amp]);
+	str.Printf(_T("%.2f dB"), dB[max_spec_amp]);
 	ShowMaxSpecAmp->ChangeValue(str);
 
-	waveView->Draw(m_fbuffer, m_length);
-	afhView->Draw(m_fdB);
+	// the compared input at the cursor
+	if( IsComparing() && !IsStart &&
+		m_engine_b->ReadFrame(pos-m_length/2, NULL, m_fdB_b) >= 0 ) {
+		str.Printf(_T("B %.2f dB, A-B %.2f dB"), m_fdB_b[m_afc_freq],
+			dB[m_afc_freq] - m_fdB_b[m_afc_freq]);
+		SetStatusText(str, 1);
+	}
+
+	waveView->Draw(samples, m_length);
+	afhView->Draw(dB);
 }
 
 // Thread
@@ -1174,146 +2547,83 @@ void* DxViewFrame::Entry()
 	return NULL;
 }
 
-
-void DxViewFrame::FFT()
-{
-	dsp_window_apply(m_fbuffer1, m_fbuffer, m_fwindow, m_length);
-	dsp_realfft(m_fbuffer1, m_fbuffer2, m_length, 1);
-	dsp_rect2polar(m_fbuffer1, m_fbuffer2, m_length);
-
-	const unsigned length2 = m_length/2;
-	const float    k = 1.0f/length2;
-
-	for(unsigned i = 0; i < length2; i++) {// something is wrong in the calculations...
-		float dB = 20.0f * (float)log10(m_fbuffer1[i] * k);
-		m_fdB[i] = (dB < -100.0f)? -100.0f: dB;
-	}
-}
-
-// Reading from a file + doing FFT
-// i.e. making all necessary data to show
-int DxViewFrame::ReadAndFft(int pos)
+/*
+** Give the read-ahead thread a hint where the next frames will be read.
+** The read-ahead size follows the scrolling speed: holding '>>' reads
+** further ahead than single clicks.
+*/
+void DxViewFrame::Prefetch(bool forward, unsigned nsteps)
 {
-	int res;
-
-	if (!m_file.IsOpened()) return 0;
-
-	/* a little complicated situation when pos is less than zero */
-	if( pos < 0 ) {
-		if( pos < -int(m_length) ) pos = -int(m_length);
-		int datapos = pos*m_ByPS; // position * bytes_per_sample
-
-		ENTER_FILE_CS();
-		res = m_file.Seek(0, wxFromStart);
-		if( res < 0 ) {
-			EXIT_FILE_CS();
-			return res;
-		}
-		res = m_file.Read(m_buffer - datapos, m_buf_size + datapos);
-		EXIT_FILE_CS();
-
-		if( res < 0 ) return res;
-
-		// fill empty space in buffer
-		for(int i = 0; i < -pos; i++) m_fbuffer[i] = 0.0f;
-		// convert/normalist samples
-		cbConvertSamples(m_fbuffer-pos, m_buffer-datapos, res);
-	}
-	else {
-		ENTER_FILE_CS();
-		int datapos = pos*m_ByPS; // position * bytes_per_sample
-
-		res = m_file.Seek(datapos, wxFromStart);
-		if( res < 0 ) {
-			EXIT_FILE_CS();
-			return res;
-		}
-		res = m_file.Read(m_buffer, m_buf_size);
-		EXIT_FILE_CS();
+	// the pyramid reads the file itself
+	if (IsPooled()) return;
 
-		if( res < 0 ) return res;
+	const long now   = m_scroll_watch.Time();
+	const long dt    = std::max(now - m_scroll_time, 1L);
+	const unsigned bps = m_engine.GetBytesPerSample();
+	const long bytes = nsteps*m_rd_size*bps;
 
-		if( IsStart && res < int(m_buf_size) ) return 0;
+	if (forward != m_scroll_fwd) m_scroll_rate = 0.0f;
 
-		if( res < int(m_buf_size) ) {
-			for(unsigned i = res/m_ByPS; i < m_length; i++)
-				m_fbuffer[i] = 0.0f;
-		}
-
-		// convert/normalist samples
-		cbConvertSamples(m_fbuffer, m_buffer, res);
-	}
+	m_scroll_rate = (m_scroll_rate + float(bytes)/dt)/2;
+	m_scroll_time = now;
+	m_scroll_fwd  = forward;
 
-	// FFT - analysis
-	FFT();
+	long ahead = long(m_scroll_rate*PREFETCH_TIME);
+	ahead = std::max(ahead, long((10*m_rd_size + m_length)*bps));
 
-	return res;
-}
+	// the next frame to be read is the right edge when moving forward
+	// and the left edge of the view when moving backward
+	wxFileOffset pos = m_FilePosition - m_length/2;
+	if (!forward) pos -= wxFileOffset(ampView->GetWorkWidth())*m_rd_size/2;
 
-// size - buffer length
-void DxViewFrame::ConvertU8(float dst[], unsigned char src[], unsigned size)
-{
-	for(unsigned i = 0; i < size; i++)
-		dst[i] = (float)(src[i]-128)/127.0f;
+	m_engine.Hint(pos, forward? ahead: -ahead);
+	if (IsComparing()) m_engine_b->Hint(pos, forward? ahead: -ahead);
 }
 
-void DxViewFrame::ConvertS16(float dst[], unsigned char src[], unsigned size)
+/*
+** Reading the view column centered at pos into m_fdB and the extrema of
+** its halves into m_col_min/m_col_max, see AnalysisEngine::ReadColumn().
+*/
+int DxViewFrame::ReadColumn(wxFileOffset pos)
 {
-	unsigned size2 = size/sizeof(short);
-	short    *src2 = (short*) src;
-
-	for(unsigned i = 0; i < size2; i++)
-		dst[i] = float(src2[i])/32767.0f;
+	return m_engine.ReadColumn(pos, m_rd_size, m_fdB, m_col_min, m_col_max);
 }
 
-void DxViewFrame::ConvertS16BE(float dst[], unsigned char src[], unsigned size)
+/*
+** The view column just read into m_fdB, with the compared one taken from
+** m_compare_task.
+*/
+void DxViewFrame::DrawColumn(bool forward)
 {
-	unsigned size2 = size/sizeof(short);
-	//short    *src2 = (short*) src;
-
-	for(unsigned i = 0; i < size2; i++)
-		dst[i] = float((short)((src[i*2] << 8) | src[i*2+1]))/32767.0f;
+	if( IsComparing() ) {
+		m_compare_task->Get(m_fdB_b);
+		spectrumView->Draw(m_fdB, m_fdB_b, m_length, forward);
+	}
+	else
+		spectrumView->Draw(m_fdB, m_length, forward);
 }
 
-void DxViewFrame::ConvertF32(float dst[], unsigned char src[], unsigned size)
+/*
+** The pitch contour over the column just drawn from m_fdB. The tracker
+** follows the columns as they come, it starts anew when the direction
+** changes. The pooled columns mix many frames, they are left out.
+*/
+void DxViewFrame::DrawColumnPitch(bool forward)
 {
-	unsigned size2 = size/sizeof(float);
-	float    *src2 = (float*) src;
-
-	for(unsigned i = 0; i < size2; i++)
-		dst[i] = src2[i];
-}
+	if( !m_show_pitch ) return;
 
-void DxViewFrame::SetFileFormat(int format)
-{
-	switch(format)
-	{
-	case Unsigned8bit:
-		m_BiPS = 8; // bits per sample
-		m_ByPS = 1;  // bytes per sample
-		cbConvertSamples = ConvertU8;
-		break;
+	const float *window = m_engine.GetWindowCoefs();
+	const int dir = forward? 1: -1;
 
-	case Signed16bit:
-		m_BiPS = 16; // bits per sample
-		m_ByPS = 2;  // bytes per sample
-		cbConvertSamples = ConvertS16;
-		break;
+	if( !m_pitch.IsSame(m_length, SAMPLE_RATE, window) )
+		m_pitch.Init(m_length, SAMPLE_RATE, PITCH_FMIN, PITCH_FMAX, window);
 
-	case Signed16bitBigEndian:
-		m_BiPS = 16; // bits per sample
-		m_ByPS = 2;  // bytes per sample
-		cbConvertSamples = ConvertS16BE;
-		break;
+	if( dir != m_pitch_dir ) m_pitch.Reset();
+	m_pitch_dir = dir;
 
-	case Float32bit:
-		m_BiPS = 32; // bits per sample
-		m_ByPS = 4;  // bytes per sample
-		cbConvertSamples = ConvertF32;
-		break;
-	}
+	const float f0 = (!IsStart && IsPooled())? 0.0f: m_pitch.Track(m_fdB);
 
-	m_buf_size = m_length * m_ByPS;
+	spectrumView->DrawPitch(f0, forward);
 }
 
 
@@ -1726,6 +3036,14 @@ const wxPen& MapPen(float dB)
     else              return dBtoPen[7];
 }
 
+// index of the MapColor() color
+unsigned MapLevel(float dB)
+{
+	unsigned i = 0;
+	while(i < DB_LEVELS-1 && dB >= i2dB[i]) i++;
+	return i;
+}
+
 const wxPen& MapPen2(const float dB)
 {
 	if(dB < i2dB[0]) return dBtoPen[0];
@@ -1738,6 +3056,46 @@ const wxPen& MapPen2(const float dB)
 	return dBtoPen[7];
 }
 
+// the bounds of the levels of a difference, dB
+const float i2delta[DELTA_LEVELS-1] =
+{
+	-9, -6, -3, -1, 1, 3, 6, 9
+};
+
+// difference to color mapping: the first input quieter - blue, louder - red
+const wxColour deltaToColor[DELTA_LEVELS] =
+{
+	wxColour(0,0,255),
+	wxColour(0,96,255),
+	wxColour(0,160,255),
+	wxColour(0,80,128),
+	wxColour(0,0,0),
+	wxColour(128,64,0),
+	wxColour(255,160,0),
+	wxColour(255,96,0),
+	wxColour(255,0,0)
+};
+
+const wxPen deltaToPen[DELTA_LEVELS] =
+{
+	wxPen(deltaToColor[0]),
+	wxPen(deltaToColor[1]),
+	wxPen(deltaToColor[2]),
+	wxPen(deltaToColor[3]),
+	wxPen(deltaToColor[4]),
+	wxPen(deltaToColor[5]),
+	wxPen(deltaToColor[6]),
+	wxPen(deltaToColor[7]),
+	wxPen(deltaToColor[8])
+};
+
+const wxPen& MapDeltaPen(float delta)
+{
+	unsigned i = 0;
+	while(i < DELTA_LEVELS-1 && delta >= i2delta[i]) i++;
+	return deltaToPen[i];
+}
+
 AfhView::AfhView(wxWindow* pParentWnd): BaseView(pParentWnd), m_points(NULL)
 {
 }
@@ -2020,7 +3378,7 @@ const int AmplitudeView::Amplitude2Db[][2] =
 };
 
 AmplitudeView::AmplitudeView(wxWindow* pParentWnd): BaseView(pParentWnd),
-	m_cursor(0,0), m_Time(0)
+	m_cursor(0,0), m_Time(0), m_sel_x1(-1), m_sel_x2(-1), m_speech_color(0,192,0)
 {
 }
 
@@ -2091,6 +3449,48 @@ void AmplitudeView::DrawScale()
 **              forward - time direction: forward/backward;
 ******************************************************************************/
 void AmplitudeView::Draw(float pBuf[], int size, int step, bool forward)
+{
+	// cut the step in half, each half - 1 pixel on X-axis
+	const int pixel = step/2;
+	float min[2], max[2];
+
+	// Drawing method: data block in center is divided by half,
+	// every half is displayed by one line. Line length is calulated
+	// by taking max and min amplitude values in the data block.
+	pBuf += size/2 - pixel;
+	for( int i = 0; i < 2; i++, pBuf += pixel )
+	{
+		min[i] = *std::min_element(pBuf, pBuf+pixel);
+		max[i] = *std::max_element(pBuf, pBuf+pixel);
+	}
+
+	DrawColumn(min, max, step, forward);
+}
+
+/*
+** The time scale steps for pixel samples per pixel: the numbered scale
+** points are p2 samples apart, p2 is the 1-2-5 series time at least 100
+** pixels wide, and the unnumbered ones p1 = p2/10 samples apart.
+*/
+static void TimeScaleSteps(int pixel, int sample_rate, int& p1, int& p2)
+{
+	const double min_ms = 100.0*pixel*1000.0/sample_rate;
+	double ms = 1.0;
+
+	while( ms < min_ms ) {
+		if( 2*ms >= min_ms ) { ms *= 2; break; }
+		if( 5*ms >= min_ms ) { ms *= 5; break; }
+		ms *= 10;
+	}
+
+	p2 = std::max(int(ms*sample_rate/1000), 1);
+	p1 = std::max(p2/10, 1);
+}
+
+// one column of step samples: min[]/max[] - the extrema of its halves,
+// speech - marked on the time scale
+void AmplitudeView::DrawColumn(const float min[2], const float max[2], int step, bool forward,
+	bool speech)
 {
 	// cut the step in half, each half - 1 pixel on X-axis
 	const int pixel = step/2;
@@ -2102,36 +3502,22 @@ void AmplitudeView::Draw(float pBuf[], int size, int step, bool forward)
 	const int height = GetHeight()-eTimeScaleHeight;
 
 	ClearRect(pos, 0, 2, height);
+
+	// the strip along the top of the time scale
+	if( speech ) FillRect(pos, height, 2, eSpeechHeight, m_speech_color);
+
 	SelectObject(wxWHITE_PEN);
 
 	// parameters for the time scale drawing, p1 represent the time
 	// interval for unnumbered scale points, p2 - time interval
 	// for the scale points with a number.
 	int p1, p2;
+	TimeScaleSteps(std::max(pixel, 1), m_sample_rate, p1, p2);
 
-	// these numbers actually depend on the sample rate (8kHz)
-	switch(pixel)
-	{
-		case 4:		p1 = 40,	p2 = 400;	break; // 0.5: 5 ,50 ms
-		case 8:		p1 = 80,	p2 = 800;	break; // 1  : 10,100 ms
-		case 16:	p1 = 160,	p2 = 1600;	break; // 2  : 20,200 ms
-		case 32:	p1 = 400,	p2 = 4000;	break; // 4  : 50,500 ms
-		case 64:	p1 = 800,	p2 = 8000;	break; // 8  :100,1000 ms
-		case 128:	p1 = 1600,	p2 = 16000;	break; // 16 :200,2000 ms
-		case 256:	p1 = 4000,	p2 = 32000;	break; // 32 :500,4000 ms
-		default:	p1 = 1,		p2 = 1;		break;
-	}
-
-	// Drawing method: data block in center is divided by half,
-	// every half is displayed by one line. Line length is calulated
-	// by taking max and min amplitude values in the data block.
-	pBuf += size/2 - pixel;
-	for( int i = 0; i < 2; i++, pBuf += pixel )
+	for( int i = 0; i < 2; i++ )
 	{
-		float min = *std::min_element(pBuf, pBuf+pixel);
-		float max = *std::max_element(pBuf, pBuf+pixel);
-		int view_min = height*(1.0f - min)/2;
-		int view_max = height*(1.0f - max)/2;
+		int view_min = height*(1.0f - min[i])/2;
+		int view_max = height*(1.0f - max[i])/2;
 
 		// if they are equal the line will not be drawn so we correct this
 		if (view_max == view_min) view_max += 1;
@@ -2142,9 +3528,9 @@ void AmplitudeView::Draw(float pBuf[], int size, int step, bool forward)
 		// --------- the time scale drawing  ---------
 
 		// time of the data block beginning
-		const int time1 = (forward)? m_Time+i*pixel: m_Time - (GetWorkWidth()+2-i)*pixel;
+		const wxFileOffset time1 = (forward)? m_Time+i*pixel: m_Time - wxFileOffset(GetWorkWidth()+2-i)*pixel;
 		// time of the data block end
-		const int time2 = time1 + pixel;
+		const wxFileOffset time2 = time1 + pixel;
 
 		// if during this block time it went across p1 boundary - draw scale point
 		if( time1 == 0 || (time2/p1 > time1/p1) )
@@ -2153,7 +3539,7 @@ void AmplitudeView::Draw(float pBuf[], int size, int step, bool forward)
 			if( time1 == 0 || (time2/p2 > time1/p2)) {
 				LineTo(pos+i, height+(eTimeScaleHeight/2));
 				wxString str;
-				str.Printf(_T("%.2f"), float(time2/p2)*p2/m_sample_rate);
+				str.Printf(_T("%.2f"), double(time2/p2)*p2/m_sample_rate);
 				TextOut(pos-10, height+(eTimeScaleHeight/3), str);
 			} else {
 				LineTo(pos+i, height+(eTimeScaleHeight/4));
@@ -2204,8 +3590,7 @@ void AmplitudeView::OnPaint(wxPaintEvent& event)
 	// scrolled left/right we cannot draw the cursor by BaseView
 	// methods. We add cursor after the whole picture is copied to screen -
 	// the result is that cursor is (unfortunately) blinking.
-	DC.SetPen(*wxWHITE_PEN);
-	DC.DrawLine(m_cursor.x, 0, m_cursor.x, GetHeight()-eTimeScaleHeight);
+	DrawCursor(DC);
 }
 
 
@@ -2215,8 +3600,22 @@ void AmplitudeView::RePaint(void)
 
 	BaseView::RePaint();
 
+	DrawCursor(DC);
+}
+
+// cursor and selection edges
+void AmplitudeView::DrawCursor(wxDC& DC)
+{
+	const int height = GetHeight()-eTimeScaleHeight;
+
+	if (m_sel_x1 >= 0) {
+		DC.SetPen(*wxCYAN_PEN);
+		DC.DrawLine(m_sel_x1, 0, m_sel_x1, height);
+		DC.DrawLine(m_sel_x2, 0, m_sel_x2, height);
+	}
+
 	DC.SetPen(*wxWHITE_PEN);
-	DC.DrawLine(m_cursor.x, 0, m_cursor.x, GetHeight()-eTimeScaleHeight);
+	DC.DrawLine(m_cursor.x, 0, m_cursor.x, height);
 }
 
 void AmplitudeView::OnLButtonDown(wxMouseEvent& event)
@@ -2256,8 +3655,9 @@ void AmplitudeView::OnSize(wxSizeEvent& event)
 **
 ******************************************************************************/
 SpectrumView::SpectrumView(wxWindow* pParentWnd): BaseView(pParentWnd),
-	m_strings(NULL),
-	PITCH_WIDTH(5),	FREQ_SCALE_WIDTH(40),
+	m_strings(NULL), m_scale(FilterBank::LINEAR), m_compare(COMPARE_OFF), m_rows(NULL),
+	m_nrows(0), m_f0_y(-1), m_f0_fwd(true),
+	m_f0_pen(wxColour(255,0,255)), PITCH_WIDTH(5),	FREQ_SCALE_WIDTH(40),
 	LEVL_SCALE_PITCH(8), LEVL_SCALE_WIDTH(50)
 {
 	m_num_pitch = LEVL_SCALE_PITCH;
@@ -2267,6 +3667,7 @@ SpectrumView::SpectrumView(wxWindow* pParentWnd): BaseView(pParentWnd),
 SpectrumView::~SpectrumView()
 {
 	if (m_strings) delete[] m_strings;
+	if (m_rows) delete[] m_rows;
 }
 
 
@@ -2351,23 +3752,147 @@ void SpectrumView::Draw(float *dB, int, bool forward)
 
 	DoScroll(forward? -2: 2);
 
-	const float d = float(m_length)/(2*(height-1));
+	if (!PrepareRows()) return;
+
+	MapRows(dB, m_rows);
+	DrawRows(m_rows, height-1, x, false);
+}
+
+/*
+** The columns of two inputs at once: side by side the first one is drawn
+** in the upper half and the second one in the lower half, otherwise their
+** difference dB - dB2 is drawn in the delta colors. Where both are below
+** the lowest dB level there is no difference, it would be only the noise.
+*/
+void SpectrumView::Draw(float *dB, float *dB2, int size, bool forward)
+{
+	if (m_compare == COMPARE_OFF) {
+		Draw(dB, size, forward);
+		return;
+	}
+
+	const int height = GetHeight();
+	const int x = forward? GetWidth()-(LEVL_SCALE_WIDTH+2): FREQ_SCALE_WIDTH;
+	const int rows = GetRows();
+
+	DoScroll(forward? -2: 2);
+
+	if (!PrepareRows()) return;
+
+	float *a = m_rows;
+	float *b = m_rows + rows;
+
+	MapRows(dB, a);
+	MapRows(dB2, b);
+
+	if (m_compare == COMPARE_SIDE) {
+		DrawRows(a, rows-1, x, false);
+		DrawRows(b, height-1, x, false);
+		return;
+	}
+
+	for(int i = 0; i < rows; i++)
+		a[i] = (a[i] < DELTA_FLOOR && b[i] < DELTA_FLOOR)? 0.0f: a[i] - b[i];
+
+	DrawRows(a, height-1, x, true);
+}
+
+// rows of one spectrogram: half of the view side by side
+int SpectrumView::GetRows() const
+{
+	return (m_compare == COMPARE_SIDE)? GetHeight()/2: GetHeight();
+}
+
+// m_rows for two columns of the view height
+bool SpectrumView::PrepareRows()
+{
+	const int height = GetHeight();
+
+	if (height < 2) return false;
+
+	if (m_nrows < 2*height) {
+		if (m_rows) delete[] m_rows;
+		m_rows  = new float[2*height];
+		m_nrows = 2*height;
+	}
+
+	return true;
+}
+
+/*
+** The values of GetRows() rows from the spectrum dB: the bands of the
+** filter bank on the log-frequency or mel axis, the nearest bins otherwise.
+*/
+void SpectrumView::MapRows(const float *dB, float rows[])
+{
+	const int n = GetRows();
+
+	if (m_scale != FilterBank::LINEAR && PrepareBank()) {
+		m_bank.Apply(dB, rows);
+		return;
+	}
+
+	const float d = (n > 1)? float(m_length)/(2*(n-1)): 0.0f;
+
+	for(int i = 0; i < n; i++) {
+		unsigned k = i*d;
+		rows[i] = dB[k];
+	}
+}
+
+// the rows up from the bottom y at x, dB levels or differences in dB
+void SpectrumView::DrawRows(const float rows[], int bottom, int x, bool delta)
+{
+	const int n = GetRows();
 
-	for(int i = 0; i < height; i++) {
-		unsigned n = i*d;
-		const wxPen& pen = MapPen(dB[n]);
-		int y = height-1 - i;
+	for(int i = 0; i < n; i++) {
+		const wxPen& pen = delta? MapDeltaPen(rows[i]): MapPen(rows[i]);
+		int y = bottom - i;
 
 		SetPixel(x,   y, pen);
 		SetPixel(x+1, y, pen);
 	}
 }
 
+/*
+** The pitch contour point of the column drawn last, connected to the one
+** of the previous column; f0 0 - unvoiced, no point.
+*/
+void SpectrumView::DrawPitch(float f0, bool forward)
+{
+	const int rows = GetRows();
+	const int x = forward? GetWidth()-(LEVL_SCALE_WIDTH+2): FREQ_SCALE_WIDTH;
+	float row;
+
+	if (f0 <= 0.0f || rows < 2) {
+		m_f0_y = -1;
+		return;
+	}
+
+	if (m_scale != FilterBank::LINEAR && PrepareBank())
+		row = m_bank.GetBand(f0);
+	else
+		row = f0*2*(rows-1)/m_sample_rate;
+
+	// over the first input side by side
+	const int y = rows-1 - int(row + 0.5f);
+
+	SelectObject(&m_f0_pen);
+	if (m_f0_y >= 0 && m_f0_fwd == forward)
+		DrawLine(forward? x-1: x+2, m_f0_y, x, y);
+	DrawLine(x, y, x+2, y);
+
+	m_f0_y   = y;
+	m_f0_fwd = forward;
+}
+
 void SpectrumView::DrawScale(int sample_rate, int points)
 {
+	m_f0_y = -1;
+
 	int width  = GetWidth();
 	int height = GetHeight();
-	int delta = (500*height*2)/sample_rate; // scale_step * height / (sample_rate/2)
+	int delta = (500*GetRows()*2)/sample_rate; // scale_step * height / (sample_rate/2)
 
 	ClearRect(GetWorkRect());
 
@@ -2382,9 +3907,14 @@ void SpectrumView::DrawScale(int sample_rate, int points)
 	int y = height - h * m_num_pitch;
 
 	// draw dB-color table at the right side
-	for(int i = 0; i < m_num_pitch; i++, y += h) {
-		TextOut(x+w, y, m_strings[i]);
-		FillRect(x, y, w, h, dBtoColor[i]);
+	if (m_compare == COMPARE_DIFF) {
+		DrawDeltaScale();
+	}
+	else {
+		for(int i = 0; i < m_num_pitch; i++, y += h) {
+			TextOut(x+w, y, m_strings[i]);
+			FillRect(x, y, w, h, dBtoColor[i]);
+		}
 	}
 
 	// draw frequency scale points
@@ -2392,15 +3922,103 @@ void SpectrumView::DrawScale(int sample_rate, int points)
 	wxString str(_T("   Hz"));
 	TextOut(PITCH_WIDTH, height-delta/2, str);
 
-	for(int i = delta, n = 1; n < 9; i+=delta, n++)
+	// side by side every half has its scale
+	if (m_compare == COMPARE_SIDE) DrawFreqScale(GetRows());
+	DrawFreqScale(height);
+
+	Refresh(false);
+}
+
+// the frequency scale points of the spectrogram above the bottom y
+void SpectrumView::DrawFreqScale(int bottom)
+{
+	if (m_scale != FilterBank::LINEAR) {
+		DrawBandScale(bottom);
+		return;
+	}
+
+	const int delta = (500*GetRows()*2)/m_sample_rate;
+	wxString str;
+
+	for(int i = delta, n = 1; n < 9 && delta > 0; i+=delta, n++)
 	{
 		str.Printf(_T("%d"), n*500);
-		TextOut(PITCH_WIDTH, height-i, str);
-		MoveTo(FREQ_SCALE_WIDTH-PITCH_WIDTH, height-i);
-		LineTo(FREQ_SCALE_WIDTH, height-i);
+		TextOut(PITCH_WIDTH, bottom-i, str);
+		MoveTo(FREQ_SCALE_WIDTH-PITCH_WIDTH, bottom-i);
+		LineTo(FREQ_SCALE_WIDTH, bottom-i);
 	}
+}
 
-	Refresh(false);
+// the delta-color table: the first input louder above, quieter below
+void SpectrumView::DrawDeltaScale()
+{
+	const int levels = DELTA_LEVELS;
+	const int height = GetHeight();
+	const int w = LEVL_SCALE_WIDTH / 3;
+	const int h = height / levels;
+	const int x = GetWidth() - LEVL_SCALE_WIDTH;
+	int y = height - h * levels;
+
+	for(int i = levels-1; i >= 0; i--, y += h) {
+		wxString str;
+
+		// the level of the difference from zero at least
+		if (i > levels/2)
+			str.Printf(_T(" +%g dB"), i2delta[i-1]);
+		else if (i < levels/2)
+			str.Printf(_T(" %g dB"), i2delta[i]);
+		else
+			str = _T(" 0 dB");
+
+		TextOut(x+w, y, str);
+		FillRect(x, y, w, h, deltaToColor[i]);
+	}
+}
+
+/*
+** The filter bank depends on the FFT size, the sample rate and the rows
+** of a spectrogram, it is rebuilt only when one of them is changed.
+*/
+bool SpectrumView::PrepareBank()
+{
+	const int rows = GetRows();
+
+	if (rows < 2 || m_length < 4) return false;
+
+	if (!m_bank.IsSame(m_length/2, rows, m_sample_rate, m_scale)) {
+		bool ok = (m_scale == FilterBank::MEL)?
+			m_bank.InitMel(m_length/2, rows, m_sample_rate, 0.0f, 0.5f*m_sample_rate):
+			m_bank.InitLog(m_length/2, rows, m_sample_rate, LOG_FREQ_MIN);
+
+		if (!ok) return false;
+	}
+
+	return true;
+}
+
+// log-frequency and mel scale points: 1, 2, 5 for every decade
+void SpectrumView::DrawBandScale(int bottom)
+{
+	static const int steps[] = { 1, 2, 5 };
+
+	if (!PrepareBank()) return;
+
+	for (int decade = 10; decade < m_sample_rate/2; decade *= 10)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			const int freq = steps[i]*decade;
+			if (freq < LOG_FREQ_MIN || freq > m_sample_rate/2) continue;
+
+			const int y = bottom-1 - int(m_bank.GetBand(float(freq)));
+			wxString str;
+
+			str.Printf(_T("%d"), freq);
+			TextOut(PITCH_WIDTH, y, str, Y);
+			MoveTo(FREQ_SCALE_WIDTH-PITCH_WIDTH, y);
+			LineTo(FREQ_SCALE_WIDTH, y);
+		}
+	}
 }
 
 void SpectrumView::DoScroll(int dx)
@@ -0,0 +1,173 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     streamsource.cpp
+** License:  GNU
+**
+** The StreamTask thread reads the stream as it comes and appends it to
+** the ring, dropping the oldest data when the ring is full. Read() takes
+** the data by the stream offset as if it were a file: the data not yet
+** received is a short read (the end of file so far), the data already
+** dropped is an error, so the backward scrolling stops there.
+******************************************************************************/
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+    #pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#ifndef __WXMSW__
+	#include <sys/stat.h>
+#endif
+
+#include <string.h>
+#include <algorithm>
+#include "streamsource.h"
+
+const unsigned STREAM_CHUNK = 64*1024; // bytes per read
+
+void* StreamTask::Entry()
+{
+	m_source.Receive();
+	return NULL;
+}
+
+StreamSource::StreamSource(): m_task(NULL), m_data(NULL), m_size(0),
+	m_first(0), m_end(0), m_run(false), m_ended(false), m_opened(false)
+{
+}
+
+StreamSource::~StreamSource()
+{
+	Close();
+}
+
+// "-" is the standard input, a named pipe can not seek either
+bool StreamSource::IsStream(const wxString& path)
+{
+	if (path == _T("-")) return true;
+
+#ifndef __WXMSW__
+	struct stat st;
+	if (stat(path.fn_str(), &st) == 0 && S_ISFIFO(st.st_mode))
+		return true;
+#endif
+
+	return false;
+}
+
+// history - bytes of the stream kept for the backward scrolling
+bool StreamSource::Open(const wxString& path, unsigned history)
+{
+	Close();
+
+	if (!m_input.Open(path, 0)) return false;
+
+	history = std::max(history, STREAM_CHUNK);
+
+	m_data  = new unsigned char[history];
+	m_size  = history;
+	m_first = m_end = 0;
+	m_ended = false;
+	m_run   = true;
+
+	m_task = new StreamTask(*this);
+
+	if (m_task->Create() != wxTHREAD_NO_ERROR || m_task->Run() != wxTHREAD_NO_ERROR) {
+		delete m_task;
+		m_task = NULL;
+		Close();
+		return false;
+	}
+
+	m_opened = true;
+
+	return true;
+}
+
+void StreamSource::Close()
+{
+	m_run = false;
+	if (m_task) {
+		m_task->Wait();
+		delete m_task;
+		m_task = NULL;
+	}
+
+	m_input.Close();
+
+	delete[] m_data;
+	m_data = NULL;
+	m_size = 0;
+	m_first = m_end = 0;
+	m_opened = false;
+}
+
+// bytes received so far
+wxFileOffset StreamSource::Length()
+{
+	wxCriticalSectionLocker lock(m_cs);
+	return m_end;
+}
+
+// the oldest offset still in the history
+wxFileOffset StreamSource::GetFirst()
+{
+	wxCriticalSectionLocker lock(m_cs);
+	return m_first;
+}
+
+/*
+** Copy size bytes from the stream offset into dst[]. Returns the number
+** of bytes copied, less than size past the received data, or -1 if the
+** data is not in the history any more.
+*/
+int StreamSource::Read(wxFileOffset offset, unsigned char dst[], unsigned size)
+{
+	wxCriticalSectionLocker lock(m_cs);
+
+	if (offset < m_first) return -1;
+	if (offset >= m_end) return 0;
+
+	const unsigned n = unsigned(std::min(wxFileOffset(size), m_end - offset));
+	const unsigned at = unsigned(offset % m_size);
+	const unsigned first = std::min(n, m_size - at);
+
+	memcpy(dst, m_data + at, first);
+	memcpy(dst + first, m_data, n - first);
+
+	return int(n);
+}
+
+void StreamSource::Receive()
+{
+	unsigned char *chunk = new unsigned char[STREAM_CHUNK];
+
+	while (m_run)
+	{
+		if (!m_input.Wait(100)) continue;
+
+		const int n = m_input.ReadRaw(chunk, STREAM_CHUNK);
+		if (n <= 0) break;
+
+		wxCriticalSectionLocker lock(m_cs);
+
+		// chunks are smaller than the ring, at most two parts
+		const unsigned at = unsigned(m_end % m_size);
+		const unsigned first = std::min(unsigned(n), m_size - at);
+
+		memcpy(m_data + at, chunk, first);
+		memcpy(m_data, chunk + first, n - first);
+
+		m_end += n;
+		if (m_end - m_first > m_size) m_first = m_end - m_size;
+	}
+
+	delete[] chunk;
+
+	m_ended = true;
+}
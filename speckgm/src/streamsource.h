@@ -0,0 +1,66 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     streamsource.h
+** License:  GNU
+**
+** Sequential input from the standard input or a named pipe. The data is
+** kept in a bounded history ring so the view can scroll back over it.
+******************************************************************************/
+#ifndef _STREAMSOURCE_H
+#define _STREAMSOURCE_H
+
+#include <wx/thread.h>
+#include <wx/file.h>
+#include "capture.h"
+
+class StreamSource;
+
+class StreamTask: public wxThread
+{
+public:
+	StreamTask(StreamSource& source): wxThread(wxTHREAD_JOINABLE), m_source(source) {}
+
+protected:
+	virtual void* Entry();
+
+private:
+	StreamSource& m_source;
+};
+
+class StreamSource
+{
+	friend class StreamTask;
+
+public:
+	StreamSource();
+	~StreamSource();
+
+	static bool IsStream(const wxString& path);
+
+	bool Open(const wxString& path, unsigned history);
+	void Close();
+
+	bool IsOpened() const { return m_opened; }
+	bool IsEnded() const { return m_ended; }
+
+	int  Read(wxFileOffset offset, unsigned char dst[], unsigned size);
+	wxFileOffset Length();
+	wxFileOffset GetFirst();
+
+private:
+	void Receive();
+
+	AudioInput     m_input;
+	StreamTask     *m_task;
+	wxCriticalSection m_cs; // guards the ring
+	unsigned char  *m_data; // history ring
+	unsigned       m_size;
+	wxFileOffset   m_first; // stream offset of the oldest byte kept
+	wxFileOffset   m_end;   // bytes received
+	volatile bool  m_run;
+	volatile bool  m_ended; // the writer has closed the stream
+	bool           m_opened;
+};
+
+#endif/*_STREAMSOURCE_H*/
@@ -0,0 +1,335 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     tileimage.cpp
+** License:  GNU
+**
+** Columns are palette indices, the first row is the top of the image.
+** A column goes into the tile of level 0 and, paired with its neighbour
+** by the maximum index, into the next levels: each level is half the
+** width of the previous one, the last level fits into a single tile.
+** A full tile is queued to the TileTask threads which convert it to RGB
+** and either compress it into <dir>/<zoom>/<index>.png (zoom 0 is the
+** smallest level) or write its rows into the place in the PPM file.
+** The queue is bounded, so the memory used does not depend on the image
+** width: a few tiles per thread plus one tile per level.
+******************************************************************************/
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+    #pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <wx/image.h>
+#include <string.h>
+#include "tileimage.h"
+
+const unsigned PNG_TILE_SIZE = 256;  // tile width of the pyramid
+const unsigned PPM_TILE_SIZE = 1024; // columns written into PPM at once
+const unsigned TILES_PER_TASK = 2;   // queued tiles per thread
+
+void* TileTask::Entry()
+{
+	wxFile file;
+
+	if (m_writer.m_format == TileWriter::PPM &&
+		!file.Open(m_writer.m_path, wxFile::read_write))
+	{
+		wxCriticalSectionLocker lock(m_writer.m_queueCS);
+		m_writer.m_ok = false;
+	}
+
+	unsigned char *rgb = new unsigned char[m_writer.m_tile*m_writer.m_height*3];
+
+	for (;;)
+	{
+		ImageTile *tile;
+
+		m_writer.m_ready.Wait();
+		{
+			wxCriticalSectionLocker lock(m_writer.m_queueCS);
+			tile = m_writer.m_queue.front();
+			m_writer.m_queue.pop_front();
+		}
+		if (!tile) break;
+
+		const bool ok = m_writer.WriteTile(*tile, rgb, file);
+
+		delete[] tile->pixels;
+		delete tile;
+
+		if (!ok) {
+			wxCriticalSectionLocker lock(m_writer.m_queueCS);
+			m_writer.m_ok = false;
+		}
+		m_writer.m_free.Post();
+	}
+
+	delete[] rgb;
+
+	return NULL;
+}
+
+TileWriter::TileWriter(): m_format(PPM), m_width(0), m_height(0), m_tile(0),
+	m_header(0), m_ok(false)
+{
+}
+
+TileWriter::~TileWriter()
+{
+	Close();
+}
+
+/*
+** path    - PPM file or the tiles directory, created if not exists;
+** format  - PPM or PNG;
+** width   - number of columns to be added;
+** height  - rows of a column;
+** palette - RGB colors of the palette indices.
+*/
+bool TileWriter::Open(const wxString& path, int format, unsigned width, unsigned height,
+	const unsigned char palette[][3], unsigned ncolors)
+{
+	Close();
+
+	if (!width || !height || !ncolors || ncolors > 256) return false;
+
+	m_path   = path;
+	m_format = format;
+	m_width  = width;
+	m_height = height;
+	m_tile   = (format == PNG)? PNG_TILE_SIZE: PPM_TILE_SIZE;
+	m_header = 0;
+
+	memset(m_palette, 0, sizeof(m_palette));
+	memcpy(m_palette, palette, ncolors*3);
+
+	unsigned nlevels = 1;
+
+	if (m_format == PPM) {
+		// the whole file is allocated at once, the tasks write into it
+		char header[64];
+		m_header = sprintf(header, "P6\n%u %u\n255\n", m_width, m_height);
+
+		wxFile file;
+		const char zero = 0;
+
+		if (!file.Create(m_path, true) || file.Write(header, m_header) != m_header ||
+			file.Seek(wxFileOffset(m_header) + wxFileOffset(m_width)*m_height*3 - 1) == wxInvalidOffset ||
+			file.Write(&zero, 1) != 1)
+			return false;
+	}
+	else {
+		if (!wxImage::FindHandler(wxBITMAP_TYPE_PNG))
+			wxImage::AddHandler(new wxPNGHandler);
+
+		for (unsigned w = m_width; w > m_tile; w = (w+1)/2)
+			nlevels++;
+
+		if (!wxDirExists(m_path) && !wxMkdir(m_path)) return false;
+
+		for (unsigned z = 0; z < nlevels; z++) {
+			wxString dir;
+			dir.Printf(_T("%s%c%u"), m_path.c_str(), wxFILE_SEP_PATH, z);
+			if (!wxDirExists(dir) && !wxMkdir(dir)) return false;
+		}
+	}
+
+	m_levels.resize(nlevels);
+	for (unsigned i = 0; i < nlevels; i++) {
+		m_levels[i].tile    = NULL;
+		m_levels[i].index   = 0;
+		m_levels[i].pending = new unsigned char[m_height];
+		m_levels[i].paired  = false;
+	}
+
+	int ntasks = wxThread::GetCPUCount();
+	if (ntasks < 1) ntasks = 1;
+
+	for (int i = 0; i < ntasks*int(TILES_PER_TASK); i++)
+		m_free.Post();
+
+	m_ok = true;
+
+	for (int t = 0; t < ntasks; t++)
+	{
+		TileTask *task = new TileTask(*this);
+
+		if (task->Create() != wxTHREAD_NO_ERROR || task->Run() != wxTHREAD_NO_ERROR) {
+			delete task;
+			m_ok = false;
+			break;
+		}
+		m_tasks.push_back(task);
+	}
+
+	if (m_tasks.empty()) {
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+// column - m_height palette indices, the top row first
+bool TileWriter::AddColumn(const unsigned char column[])
+{
+	if (m_levels.empty()) return false;
+
+	AddColumn(0, column);
+
+	wxCriticalSectionLocker lock(m_queueCS);
+	return m_ok;
+}
+
+void TileWriter::AddColumn(unsigned level, const unsigned char column[])
+{
+	Level& l = m_levels[level];
+
+	if (!l.tile) {
+		l.tile = GetTile();
+		l.tile->level = level;
+		l.tile->index = l.index;
+	}
+
+	unsigned char *dst = l.tile->pixels + l.tile->width;
+	for (unsigned y = 0; y < m_height; y++, dst += m_tile)
+		*dst = column[y];
+
+	if (++l.tile->width == m_tile)
+		Queue(level);
+
+	if (level+1 < m_levels.size()) {
+		if (l.paired) {
+			// a higher index is a higher level, the peaks are kept
+			for (unsigned y = 0; y < m_height; y++)
+				if (column[y] > l.pending[y]) l.pending[y] = column[y];
+			l.paired = false;
+			AddColumn(level+1, l.pending);
+		}
+		else {
+			memcpy(l.pending, column, m_height);
+			l.paired = true;
+		}
+	}
+}
+
+ImageTile* TileWriter::GetTile()
+{
+	ImageTile *tile = new ImageTile;
+
+	tile->level  = 0;
+	tile->index  = 0;
+	tile->width  = 0;
+	tile->pixels = new unsigned char[m_tile*m_height];
+
+	return tile;
+}
+
+// waits for a free slot if the tasks are behind
+void TileWriter::Queue(unsigned level)
+{
+	Level& l = m_levels[level];
+
+	m_free.Wait();
+	{
+		wxCriticalSectionLocker lock(m_queueCS);
+		m_queue.push_back(l.tile);
+	}
+	m_ready.Post();
+
+	l.tile = NULL;
+	l.index++;
+}
+
+// rgb - m_tile*m_height*3 buffer of the calling task
+bool TileWriter::WriteTile(const ImageTile& tile, unsigned char rgb[], wxFile& file)
+{
+	const unsigned row = tile.width*3;
+
+	for (unsigned y = 0; y < m_height; y++) {
+		const unsigned char *src = tile.pixels + y*m_tile;
+		unsigned char *dst = rgb + y*row;
+
+		for (unsigned x = 0; x < tile.width; x++, dst += 3)
+			memcpy(dst, m_palette[src[x]], 3);
+	}
+
+	if (m_format == PPM) {
+		if (!file.IsOpened()) return false;
+
+		const wxFileOffset x = wxFileOffset(tile.index)*m_tile;
+
+		for (unsigned y = 0; y < m_height; y++) {
+			const wxFileOffset offset = m_header + (wxFileOffset(y)*m_width + x)*3;
+
+			if (file.Seek(offset) == wxInvalidOffset ||
+				file.Write(rgb + y*row, row) != row)
+				return false;
+		}
+		return true;
+	}
+
+	wxString name;
+	name.Printf(_T("%s%c%u%c%u.png"), m_path.c_str(), wxFILE_SEP_PATH,
+		unsigned(m_levels.size()-1 - tile.level), wxFILE_SEP_PATH, tile.index);
+
+	// the image uses the buffer without copying
+	wxImage image(tile.width, m_height, rgb, true);
+
+	return image.SaveFile(name, wxBITMAP_TYPE_PNG);
+}
+
+// writes the partial tiles, returns false if anything has failed
+bool TileWriter::Close()
+{
+	if (m_levels.empty()) return false;
+
+	if (!m_tasks.empty()) {
+		for (unsigned level = 0; level < m_levels.size(); level++)
+		{
+			Level& l = m_levels[level];
+
+			// the odd last column goes to the next level as is
+			if (l.paired) {
+				l.paired = false;
+				AddColumn(level+1, l.pending);
+			}
+			if (l.tile) Queue(level);
+		}
+
+		// one stop mark per task
+		{
+			wxCriticalSectionLocker lock(m_queueCS);
+			for (unsigned t = 0; t < m_tasks.size(); t++)
+				m_queue.push_back(NULL);
+		}
+		for (unsigned t = 0; t < m_tasks.size(); t++)
+			m_ready.Post();
+
+		for (unsigned t = 0; t < m_tasks.size(); t++) {
+			m_tasks[t]->Wait();
+			delete m_tasks[t];
+		}
+		m_tasks.clear();
+	}
+
+	for (unsigned level = 0; level < m_levels.size(); level++) {
+		if (m_levels[level].tile) {
+			delete[] m_levels[level].tile->pixels;
+			delete m_levels[level].tile;
+		}
+		delete[] m_levels[level].pending;
+	}
+	m_levels.clear();
+
+	// drain the free slots left for the next Open()
+	while (m_free.TryWait() == wxSEMA_NO_ERROR) {}
+
+	wxCriticalSectionLocker lock(m_queueCS);
+	return m_ok;
+}
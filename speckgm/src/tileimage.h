@@ -0,0 +1,90 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     tileimage.h
+** License:  GNU
+**
+** Export of a spectrogram of any length as an image: a single PPM file
+** or a pyramid of PNG tiles. Columns are added one by one, finished
+** tiles are written by several threads.
+******************************************************************************/
+#ifndef _TILEIMAGE_H
+#define _TILEIMAGE_H
+
+#include <wx/thread.h>
+#include <wx/file.h>
+#include <list>
+#include <vector>
+
+class TileWriter;
+
+// a part of the image of one pyramid level, palette indices
+struct ImageTile
+{
+	unsigned level;  // pyramid level, 0 - the full resolution
+	unsigned index;  // tile number in the level
+	unsigned width;  // used columns
+	unsigned char *pixels; // TILE columns x height, row by row
+};
+
+class TileTask: public wxThread
+{
+public:
+	TileTask(TileWriter& writer): wxThread(wxTHREAD_JOINABLE), m_writer(writer) {}
+
+protected:
+	virtual void* Entry();
+
+private:
+	TileWriter& m_writer;
+};
+
+class TileWriter
+{
+	friend class TileTask;
+
+public:
+	enum { PPM, PNG };
+
+	TileWriter();
+	~TileWriter();
+
+	bool Open(const wxString& path, int format, unsigned width, unsigned height,
+		const unsigned char palette[][3], unsigned ncolors);
+	bool AddColumn(const unsigned char column[]);
+	bool Close();
+
+	unsigned GetLevels() const { return m_levels.size(); }
+
+private:
+	struct Level
+	{
+		ImageTile     *tile;    // tile being filled
+		unsigned      index;    // its number
+		unsigned char *pending; // unpaired column for the next level
+		bool          paired;   // pending[] is waiting for its pair
+	};
+
+	void AddColumn(unsigned level, const unsigned char column[]);
+	void Queue(unsigned level);
+	ImageTile* GetTile();
+	bool WriteTile(const ImageTile& tile, unsigned char rgb[], wxFile& file);
+
+	wxString       m_path;   // PPM file or tiles directory
+	int            m_format;
+	unsigned       m_width;  // columns of the full image
+	unsigned       m_height;
+	unsigned       m_tile;   // tile width
+	unsigned       m_header; // PPM header size
+	unsigned char  m_palette[256][3];
+	std::vector<Level>     m_levels;
+	std::vector<TileTask*> m_tasks;
+
+	std::list<ImageTile*>  m_queue; // tiles to write, NULL - stop
+	wxCriticalSection      m_queueCS;
+	wxSemaphore            m_ready; // tiles in m_queue
+	wxSemaphore            m_free;  // free queue slots
+	bool                   m_ok;    // no write errors
+};
+
+#endif/*_TILEIMAGE_H*/
@@ -0,0 +1,379 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     vadindex.cpp
+** License:  GNU
+**
+** The file is read sequentially by large chunks and every block of about
+** 10 ms is reduced to its level in dB. The noise floor follows the lowest
+** levels and slowly rises otherwise, a block well above it is loud: a few
+** loud blocks in a row start a segment, a short pre-roll is added before
+** them and the segment lasts for a hangover after the last loud block.
+** The detector state is kept, so the blocks appended to a growing file
+** are indexed by the next Update() without reading the file again. The
+** sidecar (path + ".vad") holds the segments and the state, it is checked
+** against the format and a hash of the block count, the first bytes and
+** the last indexed block of the file, so a file rewritten after its start
+** is indexed again.
+******************************************************************************/
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+    #pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "vadindex.h"
+
+const unsigned VAD_READ_BLOCKS = 4096;  // blocks per one read
+const unsigned VAD_HASH_BYTES = 65536;  // file bytes hashed at most
+const float    VAD_DB_MIN = -100.0f;    // level of the digital silence
+const float    VAD_DB_SILENCE = -70.0f; // quieter blocks are never loud
+const float    VAD_MARGIN = 10.0f;      // loud blocks above the floor, dB
+const float    VAD_FLOOR_RISE = 0.02f;  // floor rise per block, dB
+const unsigned VAD_ONSET = 3;           // loud blocks to start a segment
+const unsigned VAD_PREROLL = 5;         // blocks added before the onset
+const unsigned VAD_HANGOVER = 30;       // blocks kept after the last loud one
+
+static const char VAD_MAGIC[8] = { 'S', 'P', 'K', 'V', 'A', 'D', '2', '\n' };
+
+// the sidecar header, the segments follow it
+struct VadHeader {
+	char     magic[8];
+	unsigned block;
+	unsigned format;
+	unsigned nblocks;
+	unsigned nsegs;
+	unsigned hash;
+	float    floor;
+	unsigned run;
+	unsigned hang;
+	unsigned active;
+};
+
+SpeechIndex::SpeechIndex(): m_convert(NULL), m_bps(0), m_format(0),
+	m_block(0), m_nblocks(0), m_saved(0), m_floor(VAD_DB_MIN), m_run(0),
+	m_hang(0), m_active(false)
+{
+}
+
+/*
+** path, convert, bps - the raw audio file as read by the engine, format
+** - its format id; block - samples per block, about 10 ms. Nothing is
+** read until Update().
+*/
+void SpeechIndex::Open(const wxString& path, ConvertFunc convert, unsigned bps,
+	int format, unsigned block)
+{
+	Reset();
+
+	m_path    = path;
+	m_convert = convert;
+	m_bps     = bps;
+	m_format  = format;
+	m_block   = block;
+}
+
+void SpeechIndex::Close()
+{
+	Reset();
+	m_bps = 0;
+}
+
+// forget everything, e.g. the file is rewritten
+void SpeechIndex::Reset()
+{
+	m_segs.clear();
+	m_nblocks = 0;
+	m_saved   = 0;
+	m_floor   = VAD_DB_MIN;
+	m_run     = 0;
+	m_hang    = 0;
+	m_active  = false;
+}
+
+/*
+** Index the blocks of the file not indexed yet, the first call takes the
+** sidecar if it matches the file. cancel - set by another thread to stop
+** between the reads. Returns false on error or when cancelled.
+*/
+bool SpeechIndex::Update(const volatile bool *cancel)
+{
+	if (!IsOpened()) return false;
+
+	wxFile file;
+	if (!file.Open(m_path)) return false;
+
+	if (!m_nblocks) Load(file);
+
+	const unsigned size = m_block*m_bps;
+	const wxFileOffset nblocks = file.Length()/size;
+
+	if (nblocks <= m_nblocks) return true;
+	if (file.Seek(wxFileOffset(m_nblocks)*size, wxFromStart) == wxInvalidOffset)
+		return false;
+
+	unsigned char *raw = new unsigned char[VAD_READ_BLOCKS*size];
+	float *samples = new float[VAD_READ_BLOCKS*m_block];
+	bool ok = true;
+
+	while (m_nblocks < nblocks)
+	{
+		if (cancel && *cancel) {
+			ok = false;
+			break;
+		}
+
+		const unsigned n = unsigned(std::min(wxFileOffset(VAD_READ_BLOCKS), nblocks - m_nblocks));
+
+		if (file.Read(raw, n*size) != ssize_t(n*size)) {
+			ok = false;
+			break;
+		}
+
+		m_convert(samples, raw, n*size);
+
+		for (unsigned i = 0; i < n; i++)
+		{
+			const float *s = samples + i*m_block;
+			float sum = 0.0f;
+
+			for (unsigned j = 0; j < m_block; j++) sum += s[j]*s[j];
+
+			sum /= m_block;
+			Add((sum > 1e-10f)? 10.0f*log10f(sum): VAD_DB_MIN);
+		}
+	}
+
+	delete[] raw;
+	delete[] samples;
+
+	return ok;
+}
+
+// the next block level, the detector steps
+void SpeechIndex::Add(float level)
+{
+	const unsigned i = m_nblocks++;
+
+	if (i == 0 || level < m_floor)
+		m_floor = level;
+	else
+		m_floor += VAD_FLOOR_RISE;
+
+	if (level > m_floor + VAD_MARGIN && level > VAD_DB_SILENCE) {
+		m_hang = VAD_HANGOVER;
+
+		if (m_active) {
+			m_segs.back().to = i+1;
+			return;
+		}
+
+		if (++m_run < VAD_ONSET) return;
+
+		Segment seg;
+		seg.from = (i+1 > m_run + VAD_PREROLL)? i+1 - m_run - VAD_PREROLL: 0;
+		seg.to   = i+1;
+
+		// the pre-roll reaches the previous segment
+		if (!m_segs.empty() && m_segs.back().to >= seg.from)
+			m_segs.back().to = seg.to;
+		else
+			m_segs.push_back(seg);
+
+		m_active = true;
+		return;
+	}
+
+	m_run = 0;
+	if (!m_active) return;
+
+	if (m_hang > 0) {
+		m_hang--;
+		m_segs.back().to = i+1;
+	}
+	else
+		m_active = false;
+}
+
+// FNV-1a of the block count, the first bytes and the last block indexed
+unsigned SpeechIndex::Hash(wxFile& file, unsigned nblocks) const
+{
+	const unsigned size = m_block*m_bps;
+	const wxFileOffset first = std::min(wxFileOffset(nblocks)*size,
+		wxFileOffset(VAD_HASH_BYTES));
+	unsigned char *buf = new unsigned char[std::max(VAD_HASH_BYTES, size)];
+	unsigned hash = 2166136261u;
+
+	for (unsigned i = 0; i < sizeof(nblocks); i++)
+		hash = (hash ^ ((nblocks >> 8*i) & 0xff))*16777619u;
+
+	if (file.Seek(0, wxFromStart) != wxInvalidOffset &&
+		file.Read(buf, size_t(first)) == ssize_t(first)) {
+		for (unsigned i = 0; i < unsigned(first); i++)
+			hash = (hash ^ buf[i])*16777619u;
+	}
+
+	if (nblocks && file.Seek(wxFileOffset(nblocks - 1)*size, wxFromStart) != wxInvalidOffset &&
+		file.Read(buf, size) == ssize_t(size)) {
+		for (unsigned i = 0; i < size; i++)
+			hash = (hash ^ buf[i])*16777619u;
+	}
+
+	delete[] buf;
+
+	return hash;
+}
+
+// the sidecar of the file, false if there is none or it does not match
+bool SpeechIndex::Load(wxFile& file)
+{
+	const wxString path = m_path + _T(".vad");
+	if (!wxFile::Exists(path)) return false;
+
+	wxFile side;
+	if (!side.Open(path)) return false;
+
+	// the segments fill the rest of the sidecar, none is empty
+	VadHeader head;
+	if (side.Read(&head, sizeof(head)) != ssize_t(sizeof(head)) ||
+		memcmp(head.magic, VAD_MAGIC, sizeof(VAD_MAGIC)) != 0 ||
+		head.block != m_block || head.format != unsigned(m_format) ||
+		wxFileOffset(head.nblocks)*m_block*m_bps > file.Length() ||
+		head.nsegs > head.nblocks ||
+		side.Length() != wxFileOffset(sizeof(head)) + wxFileOffset(head.nsegs)*wxFileOffset(sizeof(Segment)) ||
+		head.hash != Hash(file, head.nblocks))
+		return false;
+
+	std::vector<Segment> segs(head.nsegs);
+	const ssize_t size = ssize_t(head.nsegs*sizeof(Segment));
+
+	if (head.nsegs && side.Read(&segs[0], size) != size)
+		return false;
+
+	m_segs.swap(segs);
+	m_nblocks = m_saved = head.nblocks;
+	m_floor   = head.floor;
+	m_run     = head.run;
+	m_hang    = head.hang;
+	m_active  = head.active != 0;
+
+	return true;
+}
+
+// write the sidecar if something was indexed since it was written
+bool SpeechIndex::Save()
+{
+	if (!IsOpened() || m_nblocks == m_saved) return true;
+
+	wxFile file;
+	if (!file.Open(m_path)) return false;
+
+	VadHeader head;
+	memcpy(head.magic, VAD_MAGIC, sizeof(VAD_MAGIC));
+	head.block   = m_block;
+	head.format  = unsigned(m_format);
+	head.nblocks = m_nblocks;
+	head.nsegs   = unsigned(m_segs.size());
+	head.hash    = Hash(file, m_nblocks);
+	head.floor   = m_floor;
+	head.run     = m_run;
+	head.hang    = m_hang;
+	head.active  = m_active;
+
+	wxFile side;
+	if (!side.Create(m_path + _T(".vad"), true)) return false;
+
+	const size_t size = m_segs.size()*sizeof(Segment);
+
+	if (side.Write(&head, sizeof(head)) != sizeof(head) ||
+		(size && side.Write(&m_segs[0], size) != size))
+		return false;
+
+	m_saved = m_nblocks;
+	return true;
+}
+
+// the first segment ending after the sample pos, m_segs.size() if none
+unsigned SpeechIndex::Find(wxFileOffset pos) const
+{
+	unsigned lo = 0, hi = unsigned(m_segs.size());
+
+	while (lo < hi)
+	{
+		const unsigned mid = (lo + hi)/2;
+
+		if (wxFileOffset(m_segs[mid].to)*m_block > pos)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return lo;
+}
+
+// the start of the first segment after the sample pos, -1 if none
+wxFileOffset SpeechIndex::Next(wxFileOffset pos) const
+{
+	unsigned i = Find(pos);
+
+	if (i < m_segs.size() && wxFileOffset(m_segs[i].from)*m_block <= pos) i++;
+
+	return (i < m_segs.size())? wxFileOffset(m_segs[i].from)*m_block: -1;
+}
+
+// the start of the last segment before the sample pos, -1 if none
+wxFileOffset SpeechIndex::Prev(wxFileOffset pos) const
+{
+	unsigned i = Find(pos);
+
+	if (i < m_segs.size() && wxFileOffset(m_segs[i].from)*m_block < pos)
+		return wxFileOffset(m_segs[i].from)*m_block;
+
+	return (i > 0)? wxFileOffset(m_segs[i-1].from)*m_block: -1;
+}
+
+// some speech in the samples from..to-1
+bool SpeechIndex::IsSpeech(wxFileOffset from, wxFileOffset to) const
+{
+	const unsigned i = Find(from);
+
+	return i < m_segs.size() && wxFileOffset(m_segs[i].from)*m_block < to;
+}
+
+/******************************************************************************
+**  SpeechTask class
+**  --------------------------------------------------------------------------
+**  The first pass over the whole file, the sidecar written after it. The
+**  caller polls IsDone() and takes the index, the navigation by the
+**  segments is enabled from then on.
+******************************************************************************/
+SpeechTask::SpeechTask(const wxString& path, ConvertFunc convert, unsigned bps, int format,
+	unsigned block): wxThread(wxTHREAD_JOINABLE), m_cancel(false), m_done(false)
+{
+	m_index.Open(path, convert, bps, format, block);
+}
+
+bool SpeechTask::Start()
+{
+	if (wxThread::Create() != wxTHREAD_NO_ERROR)
+		return false;
+
+	return wxThread::Run() == wxTHREAD_NO_ERROR;
+}
+
+void* SpeechTask::Entry()
+{
+	// may fail in a read-only directory, the index is still there
+	if (m_index.Update(&m_cancel)) m_index.Save();
+
+	m_done = true;
+
+	return NULL;
+}
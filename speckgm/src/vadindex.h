@@ -0,0 +1,86 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     vadindex.h
+** License:  GNU
+**
+** Voice activity index of a raw audio file: the speech segments found
+** from the energy of its short blocks, built in one pass over the file and
+** kept in a sidecar file next to it. SpeechTask makes the first pass in a
+** thread of its own.
+******************************************************************************/
+#ifndef _VADINDEX_H
+#define _VADINDEX_H
+
+#include <wx/thread.h>
+#include <vector>
+#include "welch.h"
+
+class SpeechIndex
+{
+public:
+	SpeechIndex();
+
+	void Open(const wxString& path, ConvertFunc convert, unsigned bps, int format,
+		unsigned block);
+	void Close();
+	void Reset();
+
+	bool IsOpened() const { return m_bps != 0; }
+
+	bool Update(const volatile bool *cancel = NULL);
+	bool Save();
+
+	wxFileOffset GetCount() const { return wxFileOffset(m_nblocks)*m_block; }
+	wxFileOffset Next(wxFileOffset pos) const;
+	wxFileOffset Prev(wxFileOffset pos) const;
+	bool IsSpeech(wxFileOffset from, wxFileOffset to) const;
+
+private:
+	struct Segment {
+		unsigned from; // blocks from..to-1
+		unsigned to;
+	};
+
+	bool Load(wxFile& file);
+	void Add(float level);
+	unsigned Find(wxFileOffset pos) const;
+	unsigned Hash(wxFile& file, unsigned nblocks) const;
+
+	wxString     m_path;
+	ConvertFunc  m_convert;
+	unsigned     m_bps;     // bytes per sample, 0 - not opened
+	int          m_format;  // sample format, checked against the sidecar
+	unsigned     m_block;   // samples per block
+	unsigned     m_nblocks; // blocks indexed
+	unsigned     m_saved;   // blocks in the sidecar
+	std::vector<Segment> m_segs; // speech, the last one may go on
+
+	// the detector state after the last block
+	float        m_floor;   // noise floor estimate, dB
+	unsigned     m_run;     // loud blocks in a row
+	unsigned     m_hang;    // blocks until the segment ends
+	bool         m_active;  // the last segment goes on
+};
+
+class SpeechTask: public wxThread
+{
+public:
+	SpeechTask(const wxString& path, ConvertFunc convert, unsigned bps, int format,
+		unsigned block);
+
+	bool Start();
+	void Cancel() { m_cancel = true; }
+	bool IsDone() const { return m_done; }
+	const SpeechIndex& GetIndex() const { return m_index; }
+
+protected:
+	virtual void* Entry();
+
+private:
+	SpeechIndex   m_index;  // read by the caller once IsDone()
+	volatile bool m_cancel; // the pass stops after its current chunk
+	volatile bool m_done;
+};
+
+#endif/*_VADINDEX_H*/
@@ -0,0 +1,63 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     welch.cpp
+** License:  GNU
+**
+** The range is covered by frames with 50% overlap, their power is summed
+** by the frame tasks of ComputeFrames() without keeping the spectra. The
+** positions are at the rate reduced by factor, see decimator.h.
+******************************************************************************/
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+    #pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <math.h>
+#include <vector>
+#include "frametask.h"
+#include "welch.h"
+
+/*
+** Welch PSD of the samples from..to of the file into dB[] (length/2 values),
+** in the same scale as the frame spectrum: 10*log10 of the mean power of
+** the bin magnitudes times the window scale. The window covers its frame
+** samples in the middle of the FFT buffer, the frames overlap by half of it.
+** Returns the number of averaged frames, 0 on error.
+*/
+unsigned WelchPsd(const wxString& path, ConvertFunc convert, unsigned bps, unsigned factor,
+	const FftWindow& window, wxFileOffset from, wxFileOffset to, float dB[])
+{
+	const unsigned length = window.GetLength();
+	const unsigned frame = window.GetFrame();
+	const unsigned hop = frame/2;
+	const unsigned pad = (length - frame)/2;
+
+	if (from < 0) from = 0;
+	if (to < from) return 0;
+
+	// the frame count is bounded by the caller's range, ~4G frames at most
+	unsigned nframes = 1;
+	if (to - from > wxFileOffset(frame))
+		nframes += unsigned((to - from - frame)/hop);
+
+	std::vector<double> sum(length/2, 0.0);
+
+	if (!ComputeFrames(path, convert, bps, factor, window, hop, from - pad, nframes,
+		NULL, NULL, NULL, &sum[0]))
+		return 0;
+
+	const double k = double(window.GetScale())*window.GetScale()/nframes;
+
+	for (unsigned i = 0; i < length/2; i++) {
+		float v = (float)(10.0*log10(sum[i]*k + 1e-20));
+		dB[i] = (v < -100.0f)? -100.0f: v;
+	}
+
+	return nframes;
+}
@@ -0,0 +1,22 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     welch.h
+** License:  GNU
+**
+** Welch-averaged power spectral density of a range of a raw audio file,
+** computed by several threads, see frametask.h.
+******************************************************************************/
+#ifndef _WELCH_H
+#define _WELCH_H
+
+#include <wx/file.h>
+#include "wincache.h"
+
+// samples conversion callback, size - src[] size in bytes
+typedef void (*ConvertFunc)(float dst[], unsigned char src[], unsigned size);
+
+unsigned WelchPsd(const wxString& path, ConvertFunc convert, unsigned bps, unsigned factor,
+	const FftWindow& window, wxFileOffset from, wxFileOffset to, float dB[]);
+
+#endif/*_WELCH_H*/
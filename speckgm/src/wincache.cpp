@@ -0,0 +1,187 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     wincache.cpp
+** License:  GNU
+**
+** A sine of amplitude A in the middle of a bin gives the FFT magnitude
+** A*sum(w)/2, so the magnitudes multiplied by GetScale() read the sine
+** amplitude whatever the window and the zero-padding are. ENBW tells how
+** much wider than a bin the window sees the noise, for the PSD.
+******************************************************************************/
+#include "wx/wxprec.h"
+
+#ifdef __BORLANDC__
+    #pragma hdrstop
+#endif
+
+#ifndef WX_PRECOMP
+    #include "wx/wx.h"
+#endif
+
+#include <math.h>
+#include "wincache.h"
+
+const unsigned WINDOW_ALIGN = 64; // bytes, a cache line
+
+FftWindow::FftWindow(): m_buffer(NULL), m_coefs(NULL), m_stride(0), m_tapers(1),
+	m_reassigned(false),
+	m_type(RECTANGULAR),
+	m_param(0.0), m_length(0), m_frame(0), m_gain(1.0), m_enbw(1.0), m_scale(0.0f),
+	m_rgain(1.0), m_plan(NULL), m_ownplan(NULL)
+{
+}
+
+FftWindow::~FftWindow()
+{
+	delete[] m_buffer;
+	dsp_plan_free(m_ownplan);
+}
+
+// frame 0 - the whole length; tapers > 1 - the DPSS tapers of the
+// orders 0..tapers-1 whatever the type, param is their NW; reassigned -
+// a single window with its derivative; plan - the FFT of length points,
+// NULL - the window makes its own
+bool FftWindow::Init(int type, unsigned length, unsigned frame, double param, unsigned tapers,
+	bool reassigned, const dsp_plan<dsp_sample>* plan)
+{
+	if (!frame || frame > length) frame = length;
+	if (!tapers || reassigned) tapers = 1;
+	if (tapers > 1) type = DPSS;
+
+	delete[] m_buffer;
+
+	const unsigned pad = WINDOW_ALIGN/sizeof(float);
+	m_stride = (length + pad - 1)/pad*pad;
+	m_buffer = new float[size_t(m_stride)*(tapers + reassigned) + pad];
+	if (!m_buffer) return false;
+
+	const size_t misalign = size_t(m_buffer) % WINDOW_ALIGN;
+	m_coefs = m_buffer + (misalign? (WINDOW_ALIGN - misalign)/sizeof(float): 0);
+
+	m_type   = type;
+	m_param  = param;
+	m_length = length;
+	m_frame  = frame;
+	m_tapers = tapers;
+	m_reassigned = reassigned;
+
+	if (!plan || dsp_plan_size(plan) != length) {
+		if (!m_ownplan || dsp_plan_size(m_ownplan) != length) {
+			dsp_plan_free(m_ownplan);
+			m_ownplan = dsp_plan_create<dsp_sample>(length);
+		}
+		plan = m_ownplan;
+	}
+	m_plan = plan;
+
+	dsp_window_padded(m_coefs, m_length, m_frame, m_type, m_param);
+
+	double sum = 0.0, sum2 = 0.0;
+	for (unsigned i = 0; i < m_length; i++) {
+		sum  += m_coefs[i];
+		sum2 += double(m_coefs[i])*m_coefs[i];
+	}
+
+	m_gain  = sum/m_frame;
+	m_enbw  = (sum != 0.0)? m_frame*sum2/(sum*sum): 1.0;
+	m_scale = (sum > 0.0)? float(2.0/sum): float(2.0/m_length);
+	m_rgain = (sum2 > 0.0)? sum*sum/(m_length*sum2): 1.0;
+
+	// the higher orders scaled to the energy of the first taper, so the
+	// noise floor of the mean power is that of the single DPSS window
+	for (unsigned k = 1; k < m_tapers; k++)
+	{
+		float *w = m_coefs + k*m_stride;
+		double sumk2 = 0.0;
+
+		dsp_dpss_padded(w, m_length, m_frame, m_param, k);
+		for (unsigned i = 0; i < m_length; i++) sumk2 += double(w[i])*w[i];
+
+		const float norm = (sumk2 > 0.0)? float(sqrt(sum2/sumk2)): 0.0f;
+		for (unsigned i = 0; i < m_length; i++) w[i] *= norm;
+	}
+
+	// the central differences, zeros around the coefs
+	if (m_reassigned) {
+		float *dw = m_coefs + m_stride;
+
+		for (unsigned i = 0; i < m_length; i++)
+			dw[i] = 0.5f*(((i+1 < m_length)? m_coefs[i+1]: 0.0f) - (i? m_coefs[i-1]: 0.0f));
+	}
+
+	return true;
+}
+
+bool FftWindow::IsSame(int type, unsigned length, unsigned frame, double param,
+	unsigned tapers, bool reassigned) const
+{
+	if (!frame || frame > length) frame = length;
+	if (!tapers || reassigned) tapers = 1;
+	if (tapers > 1) type = DPSS;
+
+	return m_coefs && type == m_type && length == m_length && frame == m_frame &&
+		param == m_param && tapers == m_tapers && reassigned == m_reassigned;
+}
+
+/*
+** size/2 magnitudes of src[] (m_length samples) windowed into mag[], the
+** multitaper ones if there are several tapers, the reassigned ones scaled
+** so a sine still reads its amplitude; rex[] & imx[] - the FFT buffers of
+** m_length+2 points, scratch[] - GetScratch() points, see dsp_spectrum().
+** The window is shared, every thread passes buffers of its own.
+*/
+void FftWindow::Spectrum(float mag[], const float src[], dsp_sample rex[], dsp_sample imx[],
+	dsp_sample scratch[]) const
+{
+	if (m_reassigned)
+		dsp_reassigned(mag, src, m_coefs, m_coefs + m_stride, m_plan, m_rgain, rex, imx, scratch);
+	else if (m_tapers > 1)
+		dsp_multitaper(mag, src, m_coefs, m_stride, m_tapers, m_plan, rex, imx, scratch);
+	else
+		dsp_spectrum(mag, src, m_coefs, m_plan, rex, imx, scratch);
+}
+
+WindowCache::~WindowCache()
+{
+	for (unsigned i = 0; i < m_windows.size(); i++)
+		delete m_windows[i];
+
+	for (unsigned i = 0; i < m_plans.size(); i++)
+		dsp_plan_free(m_plans[i]);
+}
+
+/*
+** The window of the type for the FFT size length, the window covers the
+** frame samples in the middle of it; computed on the first request only.
+** Returns NULL if out of memory.
+*/
+const FftWindow* WindowCache::Get(int type, unsigned length, unsigned frame, double param,
+	unsigned tapers, bool reassigned)
+{
+	for (unsigned i = 0; i < m_windows.size(); i++)
+		if (m_windows[i]->IsSame(type, length, frame, param, tapers, reassigned))
+			return m_windows[i];
+
+	dsp_plan<dsp_sample> *plan = NULL;
+
+	for (unsigned i = 0; i < m_plans.size() && !plan; i++)
+		if (dsp_plan_size(m_plans[i]) == length)
+			plan = m_plans[i];
+
+	if (!plan) {
+		plan = dsp_plan_create<dsp_sample>(length);
+		m_plans.push_back(plan);
+	}
+
+	FftWindow *window = new FftWindow;
+
+	if (!window->Init(type, length, frame, param, tapers, reassigned, plan)) {
+		delete window;
+		return NULL;
+	}
+
+	m_windows.push_back(window);
+
+	return window;
+}
@@ -0,0 +1,76 @@
+/******************************************************************************
+** Spectrogram Viewer
+** ---------------------------------------------------------------------------
+** File:     wincache.h
+** License:  GNU
+**
+** FFT windows computed once per type and size: the coefficients, 64-byte
+** aligned, with the constants that normalize the spectra made with them.
+** A DPSS window may hold several tapers for the multitaper spectra, any
+** window its derivative for the reassigned ones. The FFT plans are cached
+** by size and shared by the windows of that size.
+******************************************************************************/
+#ifndef _WINCACHE_H
+#define _WINCACHE_H
+
+#include <vector>
+#include "fft.h"
+
+class FftWindow
+{
+public:
+	FftWindow();
+	~FftWindow();
+
+	bool Init(int type, unsigned length, unsigned frame, double param, unsigned tapers = 1,
+		bool reassigned = false, const dsp_plan<dsp_sample>* plan = NULL);
+	bool IsSame(int type, unsigned length, unsigned frame, double param, unsigned tapers,
+		bool reassigned) const;
+
+	void Spectrum(float mag[], const float src[], dsp_sample rex[], dsp_sample imx[],
+		dsp_sample scratch[]) const;
+
+	const float* GetCoefs(unsigned taper = 0) const { return m_coefs + taper*m_stride; }
+	unsigned GetTapers() const { return m_tapers; }
+	bool     IsReassigned() const { return m_reassigned; }
+	int      GetType() const   { return m_type; }
+	unsigned GetLength() const { return m_length; }
+	unsigned GetFrame() const  { return m_frame; }
+	double   GetGain() const   { return m_gain; }
+	double   GetEnbw() const   { return m_enbw; }
+	float    GetScale() const  { return m_scale; }
+	unsigned GetScratch() const { return dsp_plan_scratch(m_plan); }
+
+private:
+	float    *m_buffer; // m_coefs storage
+	float    *m_coefs;  // m_length coefs per taper, the window in the middle m_frame
+	unsigned m_stride;  // floats between the tapers, aligned
+	unsigned m_tapers;  // DPSS orders 0..m_tapers-1, 1 - the single window
+	bool     m_reassigned; // the derivative of the window follows it
+	int      m_type;    // RECTANGULAR...DPSS
+	double   m_param;   // beta, sigma, NW; 0 - the default
+	unsigned m_length;  // FFT size
+	unsigned m_frame;   // window length
+	// of the first taper, the others have its energy
+	double   m_gain;    // coherent gain: the mean of the window over the frame
+	double   m_enbw;    // equivalent noise bandwidth, bins
+	float    m_scale;   // FFT magnitude to the sine amplitude: 2/sum of the coefs
+	double   m_rgain;   // reassigned powers to the peak power of a sine
+	const dsp_plan<dsp_sample> *m_plan; // FFT of m_length points
+	dsp_plan<dsp_sample> *m_ownplan;    // m_plan if not given to Init()
+};
+
+class WindowCache
+{
+public:
+	~WindowCache();
+
+	const FftWindow* Get(int type, unsigned length, unsigned frame, double param = 0.0,
+		unsigned tapers = 1, bool reassigned = false);
+
+private:
+	std::vector<FftWindow*> m_windows; // never dropped, pointers stay valid
+	std::vector<dsp_plan<dsp_sample>*> m_plans; // one per size, the same
+};
+
+#endif/*_WINCACHE_H*/